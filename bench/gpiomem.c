@@ -0,0 +1,100 @@
+/**
+ * @file gpiomem.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Compares the PiGPIO and the memory-mapped GPIO backends.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Usage: gpiomem [register file]
+ *
+ * Without arguments both backends are measured on the robot. GPIO 26 (the
+ * unused servo header) is toggled, so make sure nothing is connected to it.
+ * When a file is given only the memory-mapped backend is measured, using the
+ * file as a fake register page: this runs on any Linux machine. An empty file
+ * (e.g. created with `touch`) is grown to the size of the page. Built without
+ * PiGPIO (CB_NO_PIGPIO), the file is required.
+ */
+
+#ifndef CB_NO_PIGPIO
+#include <pigpio.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../include/cbdef.h"
+#include "../include/hal.h"
+#include "../examples/timespec.h"
+
+#define OPS 1000000 //< Operations per measurement
+#define TOGGLE_PIN 26 //< PIN_SERVO_2, unused by the library
+
+/**
+ * @brief Measures the cost of the operations of the backend in use.
+ * @param pin The pin to toggle.
+ */
+static void bench(unsigned int pin) {
+    timespec_t clock;
+    volatile uint32_t sink = 0;
+    cbHal->set_mode(pin, CB_GPIO_OUTPUT);
+    tsSet(&clock);
+    for (int i = 0; i < OPS; i++) cbHal->write(pin, i & 1);
+    printf("%s,write,%.1f\n", cbHal->name, (double)tsTickNs(&clock) / OPS);
+    for (int i = 0; i < OPS; i++) {
+        if (i & 1) cbHal->set_bank(1u << pin);
+        else cbHal->clear_bank(1u << pin);
+    }
+    printf("%s,write_bank,%.1f\n", cbHal->name,
+           (double)tsTickNs(&clock) / OPS);
+    for (int i = 0; i < OPS; i++) sink += cbHal->read(PIN_ENCODER_LEFT_A);
+    printf("%s,read,%.1f\n", cbHal->name, (double)tsTickNs(&clock) / OPS);
+    for (int i = 0; i < OPS; i++) sink += cbHal->read_bank();
+    printf("%s,read_bank,%.1f\n", cbHal->name,
+           (double)tsTickNs(&clock) / OPS);
+    cbHal->write(pin, 0);
+    cbHal->set_mode(pin, CB_GPIO_INPUT);
+    (void)sink;
+}
+
+int main(int argc, char* argv[]) {
+    const char* path = argc > 1 ? argv[1] : NULL;
+#ifdef CB_NO_PIGPIO
+    if (!path) {
+        fprintf(stderr, "Usage: %s <register file>\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+#endif
+    puts("backend,op,ns_per_op");
+#ifndef CB_NO_PIGPIO
+    if (!path) {
+        if (gpioInitialise() < 0) exit(EXIT_FAILURE);
+        cbHalSelect(&cbHalPigpio);
+        bench(TOGGLE_PIN);
+    }
+#endif
+    if (cbGpiomemOpen(path) != CB_SUCCESS) {
+        perror("main: cbGpiomemOpen");
+        exit(EXIT_FAILURE);
+    }
+    cbHalSelect(&cbHalGpiomem);
+    bench(TOGGLE_PIN);
+    cbGpiomemClose();
+#ifndef CB_NO_PIGPIO
+    if (!path) gpioTerminate();
+#endif
+    exit(EXIT_SUCCESS);
+}
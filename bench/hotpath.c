@@ -0,0 +1,511 @@
+/**
+ * @file hotpath.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Microbenchmarks of the hot paths of the library: encoder ISRs,
+ *        motor commands, snapshots and telemetry.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Everything runs on the simulation backend, so no robot is needed and the
+ * numbers only depend on the CPU: the ISRs are fed synthetic edge streams and
+ * the motor commands end up in the simulated GPIO port. The results are
+ * printed as CSV on stdout, one measurement per row:
+ *
+ *     bench,case,param,value,unit
+ *
+ * Each timed case is repeated REPS times and the median is reported.
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#include "../include/cbdef.h"
+#include "../include/encoder.h"
+#include "../include/hal.h"
+#include "../include/motor.h"
+#include "../include/telemetry.h"
+#include "../examples/timespec.h"
+
+#define REPS 7 //< Repetitions of each timed case
+#define STREAM_LEN 4096 //< Edges in a synthetic stream, replayed in a loop
+#define STREAM_EDGES (1 << 22) //< Edges fed to the ISRs per repetition
+#define MOTOR_CALLS 100000 //< cbMotorMove() calls per repetition
+#define SNAPSHOTS (1 << 20) //< Snapshots taken by each reader
+#define CHANNEL_EDGES (1 << 20) //< Edges fed to each ISR by its own thread
+#define MAX_READERS 4
+#define RATE_MIN 100000 //< Edges per second, first step of the sweep
+#define RATE_MAX 409600000 //< Edges per second, last step of the sweep
+#define RATE_WINDOW_NS 50000000 //< Duration of each step of the sweep
+#define LATENCY_BUDGET_US 1000 //< Later than this, an edge is considered lost
+#define BATCH 32 //< Edges handled between two clock reads
+#define SAMPLES_BATCH 64 //< Samples per call of the group callback
+#define RECORDS (1 << 20) //< Telemetry records written per repetition
+
+/**
+ * @brief An edge of a synthetic stream, as PiGPIO would report it.
+ */
+typedef struct {
+    uint8_t chan;  // 0 for Channel A, 1 for Channel B
+    uint8_t level;
+    uint32_t tick;
+} edge_t;
+
+/**
+ * @brief A synthetic edge stream.
+ */
+typedef struct {
+    const char* name;
+    edge_t edges[STREAM_LEN];
+} stream_t;
+
+static cbEncoder_t enc =
+    CB_ENCODER_INIT(PIN_ENCODER_LEFT_A, PIN_ENCODER_LEFT_B);
+static cbEncoderRing_t ring;
+static stream_t clean = {.name = "clean"}, bounce = {.name = "bounce"},
+                glitch = {.name = "glitch"};
+
+/**
+ * @brief Compares two latencies, for qsort().
+ */
+static int cmpNs(const void* a, const void* b) {
+    nsec_t x = *(const nsec_t*)a, y = *(const nsec_t*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Returns the median of the REPS samples of a case.
+ */
+static nsec_t median(nsec_t* samples) {
+    qsort(samples, REPS, sizeof(*samples), cmpNs);
+    return samples[REPS / 2];
+}
+
+static void row(const char* bench, const char* name, const char* param,
+                double value, const char* unit) {
+    printf("%s,%s,%s,%.3f,%s\n", bench, name, param, value, unit);
+}
+
+/**
+ * @brief Fills the synthetic streams, all moving forward with an edge every
+ *        10us: A rises, B rises, A falls, B falls.
+ *        - clean: the ideal quadrature signal.
+ *        - bounce: each edge is followed by two bounces of the same Channel.
+ *        - glitch: a short pulse on Channel A every 8 edges, with B stable.
+ */
+static void makeStreams(void) {
+    static const uint8_t chan[4] = {0, 1, 0, 1}, level[4] = {1, 1, 0, 0};
+    uint32_t tick = 0;
+    for (int i = 0; i < STREAM_LEN; i++) {
+        clean.edges[i] = (edge_t){chan[i & 3], level[i & 3], tick += 10};
+    }
+    tick = 0;
+    for (int i = 0, q = 0; i < STREAM_LEN; q++) {
+        bounce.edges[i++] = (edge_t){chan[q & 3], level[q & 3], tick += 10};
+        for (int b = 0; b < 2 && i < STREAM_LEN; b++) {
+            uint8_t l = level[q & 3] ^ !(b & 1);
+            bounce.edges[i++] = (edge_t){chan[q & 3], l, tick += 1};
+        }
+    }
+    tick = 0;
+    for (int i = 0, q = 0; i < STREAM_LEN; q++) {
+        glitch.edges[i++] = (edge_t){chan[q & 3], level[q & 3], tick += 10};
+        if ((q & 7) == 7 && i + 1 < STREAM_LEN) {  // B just fell, A is low
+            glitch.edges[i++] = (edge_t){0, 1, tick += 1};
+            glitch.edges[i++] = (edge_t){0, 0, tick += 1};
+        }
+    }
+}
+
+static inline void feed(const edge_t* e) {
+    if (e->chan) {
+        cbEncoderISRb(enc.pin_b, e->level, e->tick, &enc);
+    } else {
+        cbEncoderISRa(enc.pin_a, e->level, e->tick, &enc);
+    }
+}
+
+/**
+ * @brief Measures the cost of the ISRs per edge on a stream.
+ */
+static void benchIsr(const stream_t* s, bool with_ring) {
+    nsec_t samples[REPS];
+    timespec_t clock;
+    cbEncoderAttachRing(&enc, with_ring ? &ring : NULL);
+    for (int r = 0; r < REPS; r++) {
+        cbEncoderSync(&enc);
+        tsSet(&clock);
+        for (int i = 0; i < STREAM_EDGES; i++) {
+            feed(&s->edges[i & (STREAM_LEN - 1)]);
+            // Keep the ring from filling up, as a consumer would
+            if (with_ring && (i & (CB_ENCODER_RING_SIZE / 2 - 1)) == 0) {
+                const cbEncoderEdge_t* batch;
+                size_t n;
+                while ((n = cbEncoderDrain(&enc, &batch))) {
+                    cbEncoderRelease(&enc, n);
+                }
+            }
+        }
+        samples[r] = tsTickNs(&clock);
+    }
+    cbEncoderAttachRing(&enc, NULL);
+    row("isr", s->name, with_ring ? "ring" : "no_ring",
+        (double)median(samples) / STREAM_EDGES, "ns/edge");
+}
+
+/**
+ * @brief Measures the cost per edge of decoding a group of Encoders from
+ *        samples, all the Encoders moving in phase on the clean stream.
+ * @param n The number of Encoders in the group.
+ */
+static void benchGroup(unsigned int n) {
+    static cbEncoder_t encs[CB_ENCODER_GROUP_MAX];
+    static cbHalSample_t samples[STREAM_LEN];
+    cbEncoder_t* ptrs[CB_ENCODER_GROUP_MAX];
+    cbEncoderGroup_t group;
+    nsec_t elapsed[REPS];
+    timespec_t clock;
+    char param[32];
+    for (unsigned int e = 0; e < n; e++) {
+        encs[e] = (cbEncoder_t)CB_ENCODER_INIT((cbGPIO_t)(2 * e),
+                                               (cbGPIO_t)(2 * e + 1));
+        ptrs[e] = &encs[e];
+    }
+    if (cbEncoderGroupInit(&group, ptrs, n) != CB_SUCCESS) exit(EXIT_FAILURE);
+    uint32_t levels = 0;
+    for (int i = 0; i < STREAM_LEN; i++) {
+        const edge_t* edge = &clean.edges[i];
+        for (unsigned int e = 0; e < n; e++) {
+            uint32_t bit = 1u << (2 * e + edge->chan);
+            levels = edge->level ? levels | bit : levels & ~bit;
+        }
+        samples[i] = (cbHalSample_t){edge->tick, levels};
+    }
+    for (int r = 0; r < REPS; r++) {
+        group.levels = 0;
+        tsSet(&clock);
+        for (int i = 0; i < STREAM_EDGES; i += SAMPLES_BATCH) {
+            cbEncoderSamples(&samples[i & (STREAM_LEN - 1)], SAMPLES_BATCH,
+                             &group);
+        }
+        elapsed[r] = tsTickNs(&clock);
+    }
+    snprintf(param, sizeof(param), "group_%u", n);
+    row("isr", "clean", param, (double)median(elapsed) / STREAM_EDGES / n,
+        "ns/edge");
+}
+
+/**
+ * @brief Measures the cost of polling a group of two Encoders when none of
+ *        their pins changed, which is what the sampler pays on most samples.
+ */
+static void benchPoll(void) {
+    static cbEncoder_t left = CB_ENCODER_INIT(PIN_ENCODER_LEFT_A,
+                                              PIN_ENCODER_LEFT_B),
+                       right = CB_ENCODER_INIT(PIN_ENCODER_RIGHT_A,
+                                               PIN_ENCODER_RIGHT_B);
+    cbEncoder_t* ptrs[] = {&left, &right};
+    cbEncoderGroup_t group;
+    nsec_t elapsed[REPS];
+    timespec_t clock;
+    unsigned int moved = 0;
+    if (cbEncoderGroupInit(&group, ptrs, 2) != CB_SUCCESS) exit(EXIT_FAILURE);
+    cbEncoderGroupSync(&group);
+    for (int r = 0; r < REPS; r++) {
+        tsSet(&clock);
+        for (int i = 0; i < STREAM_EDGES; i++) {
+            moved += cbEncoderGroupPoll(&group);
+        }
+        elapsed[r] = tsTickNs(&clock);
+    }
+    if (moved) exit(EXIT_FAILURE);
+    row("poll", "idle", "group_2", (double)median(elapsed) / STREAM_EDGES,
+        "ns/sample");
+}
+
+/**
+ * @brief Measures the cost of appending a telemetry record, with the ring
+ *        wrapping around several times per repetition.
+ */
+static void benchTelemetry(void) {
+    char path[] = "/tmp/hotpath.tlmXXXXXX";
+    cbTelemetry_t tel;
+    cbTelemetryRecord_t rec = {.duty_l = .5f, .duty_r = .5f};
+    nsec_t elapsed[REPS];
+    timespec_t clock;
+    int fd = mkstemp(path);
+    if (fd < 0) exit(EXIT_FAILURE);
+    close(fd);
+    if (cbTelemetryOpen(&tel, path, 0) != CB_SUCCESS) exit(EXIT_FAILURE);
+    unlink(path);
+    for (int r = 0; r < REPS; r++) {
+        tsSet(&clock);
+        for (int i = 0; i < RECORDS; i++) {
+            rec.time_us = (uint64_t)i * 20000;
+            rec.ticks_l = rec.ticks_r = i;
+            cbTelemetryLog(&tel, &rec);
+        }
+        elapsed[r] = tsTickNs(&clock);
+    }
+    if (!cbTelemetryRead(&tel, tel.head - 1, &rec)) exit(EXIT_FAILURE);
+    cbTelemetryClose(&tel);
+    row("telemetry", "log", "record", (double)median(elapsed) / RECORDS,
+        "ns/record");
+}
+
+/**
+ * @brief Measures the latency of cbMotorMove(), alternating two duty cycles
+ *        so that every call changes the output.
+ * @param name The name of the case.
+ * @param motor The motor to move.
+ * @param dir_a, dir_b The directions to alternate every two calls, the same
+ *                     one to time a single pin.
+ */
+static void benchMotor(const char* name, cbMotor_t* motor, cbDir_t dir_a,
+                       cbDir_t dir_b) {
+    static nsec_t lat[MOTOR_CALLS];
+    nsec_t p50[REPS], p99[REPS];
+    timespec_t clock;
+    cbMotorGPIOinit(motor);
+    for (int r = 0; r < REPS; r++) {
+        for (int i = 0; i < MOTOR_CALLS; i++) {
+            float duty = .25f + .5f * (i & 1);
+            tsSet(&clock);
+            cbMotorMove(motor, (i & 2) ? dir_b : dir_a, duty);
+            lat[i] = tsTickNs(&clock);
+        }
+        qsort(lat, MOTOR_CALLS, sizeof(*lat), cmpNs);
+        p50[r] = lat[MOTOR_CALLS / 2];
+        p99[r] = lat[MOTOR_CALLS * 99 / 100];
+    }
+    cbMotorReset(motor);
+    row("motor_move", name, "p50", (double)median(p50), "ns");
+    row("motor_move", name, "p99", (double)median(p99), "ns");
+}
+
+static atomic_bool writing;
+
+static void* writer(void* arg) {
+    (void)arg;
+    for (unsigned int i = 0;
+         atomic_load_explicit(&writing, memory_order_relaxed);
+         i++) {
+        feed(&clean.edges[i & (STREAM_LEN - 1)]);
+    }
+    return NULL;
+}
+
+static void* reader(void* arg) {
+    nsec_t* elapsed = arg;
+    cbEncoderSnapshot_t snap;
+    int64_t sum = 0;
+    timespec_t clock;
+    tsSet(&clock);
+    for (int i = 0; i < SNAPSHOTS; i++) {
+        cbEncoderSnapshot(&enc, &snap);
+        sum += snap.ticks;
+    }
+    *elapsed = tsTickNs(&clock);
+    return sum == 42 ? arg : NULL;  // Keeps the loop from being optimized out
+}
+
+static atomic_int channels_left;
+static const bool channel_b[2] = {false, true};
+
+static void* channelWriter(void* arg) {
+    const bool chan_b = *(const bool*)arg;
+    for (uint32_t i = 0; i < CHANNEL_EDGES; i++) {
+        if (chan_b) cbEncoderISRb(enc.pin_b, (int)(i & 1), i, &enc);
+        else cbEncoderISRa(enc.pin_a, (int)(i & 1), i, &enc);
+    }
+    atomic_fetch_sub(&channels_left, 1);
+    return NULL;
+}
+
+/**
+ * @brief Feeds the ISRs of the two Channels from two threads, as PiGPIO does,
+ *        into the same ring, and checks every edge drained meanwhile. Each
+ *        edge carries its index as tick and its parity as level, so an edge
+ *        overwritten by the other Channel or published half-written shows up
+ *        as a level not matching its timestamp, or as a timestamp out of
+ *        order. The edges drained and dropped must add up to those fed.
+ * @return The number of errors.
+ */
+static uint64_t benchTwoWriters(void) {
+    nsec_t samples[REPS];
+    pthread_t w[2];
+    timespec_t clock;
+    uint64_t errors = 0;
+    for (int r = 0; r < REPS; r++) {
+        uint64_t drained = 0, next[2] = {0, 0};
+        cbEncoderAttachRing(&enc, &ring);
+        cbEncoderSync(&enc);
+        atomic_store(&channels_left, 2);
+        tsSet(&clock);
+        pthread_create(&w[0], NULL, channelWriter, (void*)&channel_b[0]);
+        pthread_create(&w[1], NULL, channelWriter, (void*)&channel_b[1]);
+        for (bool more = true; more;) {
+            more = atomic_load(&channels_left) > 0;
+            const cbEncoderEdge_t* batch;
+            size_t n;
+            while ((n = cbEncoderDrain(&enc, &batch))) {
+                for (size_t i = 0; i < n; i++) {
+                    const cbEncoderEdge_t* e = &batch[i];
+                    int c = e->gpio == enc.pin_b;
+                    uint64_t tick = (uint32_t)e->ts_us;
+                    errors += (e->gpio != enc.pin_a && !c) ||
+                              e->level != (tick & 1) || tick < next[c];
+                    next[c] = tick + 1;
+                }
+                drained += n;
+                cbEncoderRelease(&enc, n);
+            }
+        }
+        pthread_join(w[0], NULL);
+        pthread_join(w[1], NULL);
+        samples[r] = tsTickNs(&clock);
+        errors += drained + atomic_load(&ring.dropped) != 2 * CHANNEL_EDGES;
+        errors += atomic_load(&enc.seq) & 1;
+    }
+    cbEncoderAttachRing(&enc, NULL);
+    row("isr", "two_writers", "ring", (double)median(samples) /
+        (2 * CHANNEL_EDGES), "ns/edge");
+    row("isr", "two_writers", "errors", (double)errors, "edges");
+    return errors;
+}
+
+/**
+ * @brief Measures the cost of a snapshot with a number of concurrent readers,
+ *        with and without an ISR thread writing to the encoder.
+ */
+static void benchSnapshot(int readers, bool with_writer) {
+    nsec_t samples[REPS];
+    pthread_t w, rd[MAX_READERS];
+    nsec_t elapsed[MAX_READERS];
+    char param[32];
+    for (int r = 0; r < REPS; r++) {
+        cbEncoderSync(&enc);
+        atomic_store(&writing, true);
+        if (with_writer) pthread_create(&w, NULL, writer, NULL);
+        for (int i = 0; i < readers; i++) {
+            pthread_create(&rd[i], NULL, reader, &elapsed[i]);
+        }
+        samples[r] = 0;
+        for (int i = 0; i < readers; i++) {
+            pthread_join(rd[i], NULL);
+            samples[r] += elapsed[i];
+        }
+        atomic_store(&writing, false);
+        if (with_writer) pthread_join(w, NULL);
+        samples[r] /= readers;
+    }
+    snprintf(param, sizeof(param), "%d_readers_%d_writer", readers,
+             with_writer);
+    row("snapshot", "clean", param, (double)median(samples) / SNAPSHOTS,
+        "ns/op");
+}
+
+/**
+ * @brief Replays the clean stream at a given rate on the wall clock, the way
+ *        PiGPIO's alert thread would call the ISRs. Edges due more than
+ *        LATENCY_BUDGET_US ago are skipped, as the sampling buffer would have
+ *        overflowed by then, and their ticks are lost.
+ * @param rate Edges per second.
+ * @return The number of ticks lost.
+ */
+static int64_t replayAt(uint64_t rate) {
+    uint64_t total = RATE_WINDOW_NS / 1000 * rate / 1000000;
+    uint64_t budget = LATENCY_BUDGET_US * rate / 1000000 + 1;
+    uint64_t done = 0;
+    timespec_t start;
+    cbEncoderSync(&enc);
+    int64_t ticks0 = enc.ticks;
+    tsSet(&start);
+    nsec_t t0 = tsToNs(&start);
+    while (done < total) {
+        timespec_t now;
+        tsSet(&now);
+        uint64_t due = (tsToNs(&now) - t0) * rate / NSEC_PER_SEC;
+        if (due > total) due = total;
+        if (due > done + budget) done = due - budget;  // Dropped
+        for (int b = 0; b < BATCH && done < due; b++, done++) {
+            feed(&clean.edges[done & (STREAM_LEN - 1)]);
+        }
+    }
+    // Only the A edges, one every two, are counted going forward
+    return (int64_t)(total + 1) / 2 - (enc.ticks - ticks0);
+}
+
+/**
+ * @brief Sweeps the edge rate, doubling it, and reports the ticks lost at
+ *        each step and the highest rate with none lost.
+ */
+static void benchMaxRate(void) {
+    uint64_t best = 0;
+    for (uint64_t rate = RATE_MIN; rate <= RATE_MAX; rate *= 2) {
+        char param[32];
+        int64_t lost = replayAt(rate);
+        snprintf(param, sizeof(param), "%llu", (unsigned long long)rate);
+        row("max_rate", "clean", param, (double)lost, "ticks_lost");
+        if (lost != 0) break;
+        best = rate;
+    }
+    row("max_rate", "clean", "sustained", (double)best, "edges/s");
+}
+
+int main(void) {
+    struct utsname host;
+    uname(&host);
+    cbHalSelect(&cbHalSim);
+    if (cbHal->init() != 0) exit(EXIT_FAILURE);
+    cbEncoderGPIOinit(&enc);
+    makeStreams();
+    puts("bench,case,param,value,unit");
+    printf("meta,machine,%s,0,\n", host.machine);
+    printf("meta,hal,%s,0,\n", cbHal->name);
+    benchIsr(&clean, false);
+    benchIsr(&clean, true);
+    benchIsr(&bounce, false);
+    benchIsr(&glitch, false);
+    uint64_t errors = benchTwoWriters();
+    for (unsigned int n = 1; n <= 4; n *= 2) benchGroup(n);
+    benchPoll();
+    benchTelemetry();
+    cbMotor_t soft = {.pin_fw = PIN_LEFT_FORWARD,
+                      .pin_bw = PIN_LEFT_BACKWARD,
+                      .direction = forward,
+                      .pwm_mode = CB_PWM_SOFT};
+    cbMotor_t hard = {.pin_fw = PIN_LEFT_FORWARD,
+                      .pin_bw = PIN_LEFT_BACKWARD,
+                      .direction = forward,
+                      .pwm_mode = CB_PWM_AUTO};
+    benchMotor("soft", &soft, forward, backward);
+    // Of the two pins only PIN_LEFT_BACKWARD can do hardware PWM
+    benchMotor("hardware", &hard, backward, backward);
+    for (int readers = 1; readers <= MAX_READERS; readers *= 2) {
+        benchSnapshot(readers, false);
+        benchSnapshot(readers, true);
+    }
+    benchMaxRate();
+    cbHal->terminate();
+    exit(errors ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -0,0 +1,105 @@
+/**
+ * @file pwm.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Compares soft and hardware PWM: cbMotorMove() latency and CPU load.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pigpio.h>
+#include <stdlib.h>
+
+#include "../include/cbdef.h"
+#include "../include/motor.h"
+#include "../examples/timespec.h"
+
+#define CALLS 100000 //< Number of cbMotorMove() calls per mode
+#define LOAD_WINDOW_MSEC 5000 //< Time over which the CPU load is measured
+#define HW_PWM_FREQ 20000 //< Above the audible range
+
+/**
+ * @brief Compares two latencies, for qsort().
+ */
+static int cmpNs(const void* a, const void* b) {
+    nsec_t x = *(const nsec_t*)a, y = *(const nsec_t*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Reads the CPU time consumed by the whole process, which includes
+ *        PiGPIO's threads.
+ * @return The CPU time in ns.
+ */
+static nsec_t cpuTimeNs(void) {
+    timespec_t ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return tsToNs(&ts);
+}
+
+/**
+ * @brief Benchmarks a motor configuration. The motor is driven backwards as
+ *        the left backward pin (GPIO18) is the only one of the shield wired to
+ *        a hardware PWM channel.
+ * @param name The name of the configuration.
+ * @param motor A pointer to the handle of the motor.
+ * @param lat A buffer for CALLS latencies.
+ */
+static void bench(const char* name, cbMotor_t* motor, nsec_t* lat) {
+    timespec_t clock;
+    cbMotorGPIOinit(motor);
+    for (int i = 0; i < CALLS; i++) {
+        float duty = .25f + .5f * (i & 1);
+        tsSet(&clock);
+        cbMotorMove(motor, backward, duty);
+        lat[i] = tsTickNs(&clock);
+    }
+    qsort(lat, CALLS, sizeof(*lat), cmpNs);
+    // CPU load with the motor running at constant duty and the caller idle
+    cbMotorMove(motor, backward, .5f);
+    nsec_t cpu = cpuTimeNs();
+    tsSet(&clock);
+    struct timespec idle = {LOAD_WINDOW_MSEC / MSEC_PER_SEC, 0};
+    nanosleep(&idle, NULL);
+    nsec_t wall = tsTickNs(&clock);
+    cpu = cpuTimeNs() - cpu;
+    cbMotorReset(motor);
+    printf("%s,%u,%u,%llu,%llu,%llu,%.2f\n", name, motor->pwm_freq,
+           cbMotorResolution(motor, backward),
+           (unsigned long long)lat[CALLS / 2],
+           (unsigned long long)lat[CALLS * 99 / 100],
+           (unsigned long long)lat[CALLS - 1], 100.0 * cpu / wall);
+}
+
+int main(void) {
+    static nsec_t lat[CALLS];
+    if (gpioInitialise() < 0) exit(EXIT_FAILURE);
+    cbMotor_t soft = {.pin_fw = PIN_LEFT_FORWARD,
+                      .pin_bw = PIN_LEFT_BACKWARD,
+                      .direction = forward,
+                      .pwm_mode = CB_PWM_SOFT};
+    cbMotor_t hard = {.pin_fw = PIN_LEFT_FORWARD,
+                      .pin_bw = PIN_LEFT_BACKWARD,
+                      .direction = forward,
+                      .pwm_mode = CB_PWM_AUTO,
+                      .pwm_freq = HW_PWM_FREQ};
+    puts("mode,freq_hz,steps,p50_ns,p99_ns,max_ns,cpu_pct");
+    bench("soft", &soft, lat);
+    bench("hardware", &hard, lat);
+    gpioTerminate();
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,170 @@
+/**
+ * @file sampler.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Compares the CPU load of the encoder ISRs and of the sampler.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Both wheels are driven at increasing duty cycles, and for each one the
+ * encoders are decoded in turn by the ISRs, by the group callback and by the
+ * sampler at a few rates, measuring the edges per second and the CPU load of
+ * the whole process, PiGPIO's threads included. The cost of the ISRs grows
+ * with the edge rate while the cost of the sampler does not: the last rows
+ * report the edge rate at which each sampler rate becomes the cheaper mode,
+ * -1 if it does not within the range of speeds of the robot.
+ */
+
+#include <pigpio.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../include/cbdef.h"
+#include "../include/encoder.h"
+#include "../include/motor.h"
+#include "../include/sampler.h"
+#include "../examples/timespec.h"
+
+#define LOAD_WINDOW_MSEC 2000 //< Time over which the CPU load is measured
+#define SAMPLER_CPU 3 //< The CPU the sampler is pinned to
+#define DUTIES 5
+#define MODES 5
+
+static const float duty[DUTIES] = {0.f, .25f, .5f, .75f, 1.f};
+static const char* const mode[MODES] = {"isr", "group", "poll", "poll",
+                                        "poll"};
+static const uint64_t poll_hz[MODES] = {0, 0, 10000, 50000, 200000};
+
+cbMotor_t cbMotorLeft = CB_MOTOR_INIT(PIN_LEFT_FORWARD, PIN_LEFT_BACKWARD);
+cbMotor_t cbMotorRight = CB_MOTOR_INIT(PIN_RIGHT_FORWARD, PIN_RIGHT_BACKWARD);
+cbEncoder_t cbEncoderLeft =
+    CB_ENCODER_INIT(PIN_ENCODER_LEFT_A, PIN_ENCODER_LEFT_B);
+cbEncoder_t cbEncoderRight =
+    CB_ENCODER_INIT(PIN_ENCODER_RIGHT_A, PIN_ENCODER_RIGHT_B);
+cbEncoderGroup_t cbEncoders;
+
+/**
+ * @brief Reads the CPU time consumed by the whole process, which includes
+ *        PiGPIO's threads.
+ * @return The CPU time in ns.
+ */
+static nsec_t cpuTimeNs(void) {
+    timespec_t ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return tsToNs(&ts);
+}
+
+static int64_t edges(void) {
+    cbEncoderSnapshot_t l, r;
+    cbEncoderSnapshot(&cbEncoderLeft, &l);
+    cbEncoderSnapshot(&cbEncoderRight, &r);
+    return llabs(l.ticks) + llabs(r.ticks);  // x4: one tick per edge
+}
+
+/**
+ * @brief Measures a decoding mode at the current speed.
+ * @param m The index of the mode.
+ * @param rate Set to the edges per second.
+ * @return The CPU load in percent.
+ */
+static double measure(int m, double* rate) {
+    cbEncoderSampler_t sampler = {.group = &cbEncoders, .cpu = SAMPLER_CPU};
+    switch (m) {
+        case 0:
+            cbEncoderSync(&cbEncoderLeft);
+            cbEncoderSync(&cbEncoderRight);
+            cbEncoderRegisterISRs(&cbEncoderLeft, 0);
+            cbEncoderRegisterISRs(&cbEncoderRight, 0);
+            break;
+        case 1:
+            cbEncoderGroupRegister(&cbEncoders);
+            break;
+        default:
+            sampler.period_ns = NSEC_PER_SEC / poll_hz[m];
+            if (cbEncoderSamplerStart(&sampler) != CB_SUCCESS) {
+                exit(EXIT_FAILURE);
+            }
+    }
+    timespec_t clock;
+    struct timespec window = {LOAD_WINDOW_MSEC / MSEC_PER_SEC,
+                              LOAD_WINDOW_MSEC % MSEC_PER_SEC * NSEC_PER_MSEC};
+    int64_t edges0 = edges();
+    nsec_t cpu = cpuTimeNs();
+    tsSet(&clock);
+    nanosleep(&window, NULL);
+    nsec_t wall = tsTickNs(&clock);
+    cpu = cpuTimeNs() - cpu;
+    *rate = (edges() - edges0) * 1e9 / wall;
+    switch (m) {
+        case 0:
+            cbEncoderCancelISRs(&cbEncoderLeft);
+            cbEncoderCancelISRs(&cbEncoderRight);
+            break;
+        case 1:
+            cbEncoderGroupCancel(&cbEncoders);
+            break;
+        default:
+            cbEncoderSamplerStop(&sampler);
+    }
+    return 100.0 * cpu / wall;
+}
+
+int main(void) {
+    double load[DUTIES][MODES], rate[DUTIES][MODES];
+    cbEncoder_t* encoders[] = {&cbEncoderLeft, &cbEncoderRight};
+    struct timespec settle = {1, 0};
+    if (gpioInitialise() < 0) exit(EXIT_FAILURE);
+    cbMotorGPIOinit(&cbMotorLeft);
+    cbMotorGPIOinit(&cbMotorRight);
+    cbEncoderSetResolution(&cbEncoderLeft, CB_ENCODER_X4);
+    cbEncoderSetResolution(&cbEncoderRight, CB_ENCODER_X4);
+    cbEncoderGPIOinit(&cbEncoderLeft);
+    cbEncoderGPIOinit(&cbEncoderRight);
+    if (cbEncoderGroupInit(&cbEncoders, encoders, 2) != CB_SUCCESS) {
+        exit(EXIT_FAILURE);
+    }
+    puts("mode,sample_hz,duty,edges_per_s,cpu_pct");
+    for (int d = 0; d < DUTIES; d++) {
+        cbMotorMove(&cbMotorLeft, forward, duty[d]);
+        cbMotorMove(&cbMotorRight, forward, duty[d]);
+        nanosleep(&settle, NULL);  // Let the wheels reach their speed
+        for (int m = 0; m < MODES; m++) {
+            load[d][m] = measure(m, &rate[d][m]);
+            printf("%s,%llu,%.2f,%.0f,%.2f\n", mode[m],
+                   (unsigned long long)poll_hz[m], duty[d], rate[d][m],
+                   load[d][m]);
+        }
+    }
+    cbMotorReset(&cbMotorLeft);
+    cbMotorReset(&cbMotorRight);
+    // Where the ISRs become more expensive than each sampler rate
+    for (int m = 2; m < MODES; m++) {
+        double crossover = -1.;
+        for (int d = 1; d < DUTIES && crossover < 0.; d++) {
+            double a = load[d - 1][0] - load[d - 1][m];
+            double b = load[d][0] - load[d][m];
+            if (a < 0. && b >= 0.) {
+                crossover = rate[d - 1][0] +
+                            (rate[d][0] - rate[d - 1][0]) * -a / (b - a);
+            }
+        }
+        printf("crossover,%llu,,%.0f,\n", (unsigned long long)poll_hz[m],
+               crossover);
+    }
+    gpioTerminate();
+    exit(EXIT_SUCCESS);
+}
@@ -2,7 +2,7 @@
  * @file control.c
  * @author Jacopo Maltagliati
  * @date 19 Mag 2023
- * @brief Trivial P-I controller for the CoderBot platform.
+ * @brief P-I controller for the CoderBot platform.
  * @copyright Copyright (c) 2022-23, Jacopo Maltagliati.
  *
  * This file is part of libcoderbot.
@@ -30,14 +30,24 @@
 #include "../include/cbdef.h"
 #include "../include/motor.h"
 #include "../include/encoder.h"
+#include "../include/odometry.h"
+#include "../include/pid.h"
+#include "../include/profile.h"
+#include "../include/speed.h"
+#include "../include/telemetry.h"
+#include "../include/timebase.h"
+#include "../include/periodic.h"
 #include "timespec.h"
 
 /* PID PARAMETERS ---------------------------------------------------------- */
 
-#define KP 0.005
-#define KI 0.0005
+#define KP 0.005f
+#define KI 0.025f //< Per second
+#define KB 5.f //< Anti-windup, per second
+#define KX 2.f //< Position error to speed setpoint, per second
 
 #define PI_INTERVAL_MSEC 20 // 50Hz
+#define PI_SPIN_USEC 100 //< Final part of each period spent spinning
 
 #define LEFT_WHEEL_RAY_MM 33.f
 #define RIGHT_WHEEL_RAY_MM 33.f
@@ -45,49 +55,52 @@
 #define TICKS_PER_REVOLUTION 16 //< Ticks per motor revolution
 #define TRANSMISSION_RATIO 120
 
-#define PWM_CLAMPING_EVENTS_MAX 10 //< Clamping events after which the
-                                   //  controller should yield.
+#define ACCELERATION_MM_S2 100.f
+#define JERK_MM_S3 500.f //< 0 for a trapezoidal profile
+#define SETTLE_PERIODS 50 //< Periods allowed to settle after the profile
 
-/* TYPEDEFS ---------------------------------------------------------------- */
+#define SPEED_WINDOW_USEC 5000 //< Minimum span of the speed estimate
+#define SPEED_TIMEOUT_USEC 200000 //< No ticks for this long means stopped
 
-/**
- * @brief A structure holding the parameters for the P-I controller.
- */
-typedef struct {
-    int ticks, //< The ticks read from the encoder.
-        prevTicks; //< The ticks read the last time the structure was updated.
-    float dutyCyc, //< The duty cycle of the motor in percentage.
-          travel_mm, //< The distance the wheel has traveled in mm.
-          speed_mm_s, //< The speed of the wheel in mm.
-          targetSpeed_mm_s, //< The desired speed in mm/s.
-          error_mm_s, //< The error in speed in mm/s.
-          integralError_mm_s, //< The sum of the errors in mm/s.
-          controlAction; //< The correction factor in duty cycle percentage.
-    const float mmsPerTick; //< The distance traveled by the wheel per each
-                            //  tick in mm.
-} ctrlParams_t;
+#define TELEMETRY_PATH "control.tlm" //< Decode with tools/telemetry_dump
+
+#define PWM_CLAMPING_EVENTS_MAX 10 //< Consecutive saturated updates after
+                                   //  which the controller should yield.
 
 /* GLOBALS ----------------------------------------------------------------- */
 
-cbMotor_t cbMotorLeft = {PIN_LEFT_FORWARD, PIN_LEFT_BACKWARD, forward};
-cbMotor_t cbMotorRight = {PIN_RIGHT_FORWARD, PIN_RIGHT_BACKWARD, forward};
-cbEncoder_t cbEncoderLeft = {
-    PIN_ENCODER_LEFT_A, PIN_ENCODER_LEFT_B, GPIO_PIN_NC, 0, 0, 0};
-cbEncoder_t cbEncoderRight = {
-    PIN_ENCODER_RIGHT_A, PIN_ENCODER_RIGHT_B, GPIO_PIN_NC, 0, 0, 0};
+cbMotor_t cbMotorLeft = CB_MOTOR_INIT(PIN_LEFT_FORWARD, PIN_LEFT_BACKWARD);
+cbMotor_t cbMotorRight = CB_MOTOR_INIT(PIN_RIGHT_FORWARD, PIN_RIGHT_BACKWARD);
+cbDrivePair_t cbDrive;
+cbEncoder_t cbEncoderLeft =
+    CB_ENCODER_INIT(PIN_ENCODER_LEFT_A, PIN_ENCODER_LEFT_B);
+cbEncoder_t cbEncoderRight =
+    CB_ENCODER_INIT(PIN_ENCODER_RIGHT_A, PIN_ENCODER_RIGHT_B);
+cbTelemetry_t cbTelemetry; //< One record per period of the controller
+cbProfile_t cbProfile;
 
 /* FUNCTIONS --------------------------------------------------------------- */
 
 void init() {
     if (gpioInitialise() < 0) exit(EXIT_FAILURE);
+    cbTimeInit();
+    if (cbTelemetryOpen(&cbTelemetry, TELEMETRY_PATH, 0) != CB_SUCCESS) {
+        exit(EXIT_FAILURE);
+    }
     // Left
     cbMotorGPIOinit(&cbMotorLeft);
     cbEncoderGPIOinit(&cbEncoderLeft);
+    cbEncoderSync(&cbEncoderLeft);
     cbEncoderRegisterISRs(&cbEncoderLeft, 50);
     // Right
     cbMotorGPIOinit(&cbMotorRight);
     cbEncoderGPIOinit(&cbEncoderRight);
+    cbEncoderSync(&cbEncoderRight);
     cbEncoderRegisterISRs(&cbEncoderRight, 50);
+    // Both
+    if (cbDrivePairInit(&cbDrive, &cbMotorLeft, &cbMotorRight) != CB_SUCCESS) {
+        exit(EXIT_FAILURE);
+    }
 }
 
 void terminate() {
@@ -95,129 +108,133 @@ void terminate() {
     cbMotorReset(&cbMotorRight);
     cbEncoderCancelISRs(&cbEncoderLeft);
     cbEncoderCancelISRs(&cbEncoderRight);
+    cbTelemetryClose(&cbTelemetry);
+    cbTimeTerminate();
     gpioTerminate();
 }
 
-void sleep(int ms) {
-    timespec_t clock;
-    nsec_t delta = 0;
-    tsSet(&clock);
-    while(delta < (ms * NSEC_PER_MSEC)) {
-        delta += tsTickNs(&clock);
-    }
-}
-
 /**
- * @brief Updates the Controller parameters for one of the sides.
- *
- * @param p The structure containing the parameters of the Controller at the
- *          current iteration.
+ * @brief Measures the speed of a wheel.
+ * @param speed The speed estimator of the wheel.
+ * @param snap A snapshot of the encoder of the wheel.
+ * @param now_us The current time in the time base of the encoder.
+ * @return The signed speed in mm/s, Q16.16.
  */
-void update(ctrlParams_t* p) {
-    p->travel_mm = (p->ticks - p->prevTicks) * p->mmsPerTick;
-    p->prevTicks = p->ticks;
-    p->speed_mm_s = (p->travel_mm / PI_INTERVAL_MSEC) * MSEC_PER_SEC;
-    /* TODO
-     * This only works if you go forward! The controller does not account for
-     * the direction in which the wheel is supposed to rotate.
-     */
-    p->error_mm_s = (p->targetSpeed_mm_s - p->speed_mm_s);
-    p->controlAction = (p->error_mm_s * KP) + (p->integralError_mm_s * KI);
-    p->integralError_mm_s += p->error_mm_s;
+int32_t measure(cbSpeed_t* speed, const cbEncoderSnapshot_t* snap,
+                uint64_t now_us) {
+    return CB_PID_FIX(cbSpeedUpdate(speed, snap, now_us));
 }
 
 /**
- * @brief Clamps the controlAction to a value in the range (0,1]. To avoid
- * overloading the motors in the event of a lockup, the control loop
- * is terminated after a number of Clamping events.
+ * @brief Proportional-Integral controller for the CoderBot Platform. Both
+ *        wheels follow a motion profile: the speed setpoint of each wheel
+ *        is the velocity of the profile, corrected by the distance between
+ *        the wheel and the position of the profile. The output of each
+ *        wheel is a signed duty cycle, so a wheel that got ahead can be
+ *        slowed down, and a negative distance drives the robot backwards.
  *
- * @param p The structure containing the parameters of the Controller at the
- *          current iteration.
+ * @param dist_mm The distance from the goal in millimiters.
+ * @param maxSpeed_mm_s The cruise speed in mm/s.
+ * @return CB_SUCCESS once at the goal, CB_FAILURE if a motor stalled,
+ *         CB_ERANGE if the move could not be planned.
  */
-int clamp(ctrlParams_t* p) {
-    // Quando il motore è in STALLO, passa il massimo della corrente... questo
-    // può essere problematico! Il cavo infatti si scalda, e gli avvolgimenti
-    // sul motore si scaldano e la cosa può portare alla rottura dello smalto
-    // e alla conseguente rottura del motore.
-    static unsigned int events = 0;
-    if(p->controlAction > 1.f) {
-        p->controlAction = 1.f;
-	    events++;
-    } else if(p->controlAction <= 0.f) {
-	    p->controlAction = 0.1f;
-	    events++;
+int control(float dist_mm, float maxSpeed_mm_s) {
+    const float mmsPerTick_L = cbOdoMmPerTick(
+        LEFT_WHEEL_RAY_MM, TICKS_PER_REVOLUTION, TRANSMISSION_RATIO);
+    const float mmsPerTick_R = cbOdoMmPerTick(
+        RIGHT_WHEEL_RAY_MM, TICKS_PER_REVOLUTION, TRANSMISSION_RATIO);
+    const int32_t kx = CB_PID_FIX(KX);
+    cbSpeed_t speedLeft, speedRight;
+    cbPid_t pid;
+    int32_t meas[CB_PID_LANES] = {0};
+    int32_t pos, vel, goal, travel[2];
+    int settle = SETTLE_PERIODS;
+
+    if (cbProfileInit(&cbProfile, dist_mm, maxSpeed_mm_s, ACCELERATION_MM_S2,
+                      JERK_MM_S3, PI_INTERVAL_MSEC * 1000) != CB_SUCCESS) {
+        return CB_ERANGE;
     }
-    return(events > PWM_CLAMPING_EVENTS_MAX);
-}
+    goal = cbProfile.pos[cbProfile.steps - 1];
 
-/**
- * @brief Trivial Proportional-Integral controller for the CoderBot Platform.
- *
- * @param distFromGoal_mm The distance from the goal in millimiters.
- * @param targetSpeed_mm_s_L The target speed of the left wheel in mm/s.
- * @param targetSpeed_mm_s_R The target speed of the right wheel in mm/s.
- * @param dutyCycL The initial duty cycle of the left motor.
- * @param dutyCycR The initial duty cycle of the right motor.
- */
-void control(float distFromGoal_mm, float targetSpeed_mm_s_L,
-             float targetSpeed_mm_s_R, float dutyCyc_L, float dutyCyc_R) {
-
-    ctrlParams_t left = {
-        .ticks = 0,
-        .prevTicks = 0,
-        .dutyCyc = dutyCyc_L,
-        .travel_mm = 0.f,
-        .speed_mm_s = 0.f,
-        .targetSpeed_mm_s = targetSpeed_mm_s_L,
-        .error_mm_s = 0,
-        .integralError_mm_s = 0,
-        .controlAction = 0,
-        .mmsPerTick = (LEFT_WHEEL_RAY_MM * 2 * M_PI) /
-                      (TICKS_PER_REVOLUTION * TRANSMISSION_RATIO)
-    };
-
-    ctrlParams_t right = {
-        .ticks = 0,
-        .prevTicks = 0,
-        .dutyCyc = dutyCyc_R,
-        .travel_mm = 0.f,
-        .speed_mm_s = 0.f,
-        .targetSpeed_mm_s = targetSpeed_mm_s_R,
-        .error_mm_s = 0,
-        .integralError_mm_s = 0,
-        .controlAction = 0,
-        .mmsPerTick = (RIGHT_WHEEL_RAY_MM * 2 * M_PI) /
-                      (TICKS_PER_REVOLUTION * TRANSMISSION_RATIO)
-    };
-
-    cbMotorMove(&cbMotorLeft, forward, left.dutyCyc);
-    cbMotorMove(&cbMotorRight, forward, right.dutyCyc);
-
-    while (distFromGoal_mm > 0.f) {
-        /* Copying the ticks should be done as quickly as possible to avoid an
-         * ISR interrupt from happening in between the copies. Consider
-         * disabling the encoder callback temporarily if problems arise.
-         */
-        left.ticks = cbEncoderLeft.ticks;
-        right.ticks = cbEncoderRight.ticks;
-        //printf("dT_L: %d, dT_R: %d\n", left.ticks - left.prevTicks, right.ticks - right.prevTicks);
-        update(&left);
-        update(&right);
-    	//printf("t_L: %f, t_R: %f\n", left.travel_mm, right.travel_mm);
-        //printf("dFG: %f, cA_L: %f, cA_R: %f\n", distFromGoal_mm, left.controlAction, right.controlAction);
-	    //printf("tS: %f, cS_L: %f, cS_L: %f\n", targetSpeed_mm_s_L, left.speed_mm_s, right.speed_mm_s);
-        if(clamp(&left)) return;
-        if(clamp(&right)) return;
-        cbMotorMove(&cbMotorLeft, forward, left.controlAction);
-       	cbMotorMove(&cbMotorRight, forward, right.controlAction);
-        distFromGoal_mm -= (left.travel_mm + right.travel_mm) / 2;
-        sleep(PI_INTERVAL_MSEC);
+    cbSpeedInit(&speedLeft, mmsPerTick_L, SPEED_WINDOW_USEC,
+                SPEED_TIMEOUT_USEC);
+    cbSpeedInit(&speedRight, mmsPerTick_R, SPEED_WINDOW_USEC,
+                SPEED_TIMEOUT_USEC);
+
+    cbPidInit(&pid, PI_INTERVAL_MSEC * 1000);
+    for (unsigned int i = 0; i < 2; i++) {
+        cbPidSetGains(&pid, i, KP, KI, 0.f, KB);
+        cbPidSetLimits(&pid, i, -1.f, 1.f);
+    }
+
+    cbEncoderSnapshot_t snapLeft, snapRight;
+    int64_t startTicks_L, startTicks_R;
+    uint64_t now_us;
+
+    cbEncoderSnapshot(&cbEncoderLeft, &snapLeft);
+    cbEncoderSnapshot(&cbEncoderRight, &snapRight);
+    startTicks_L = snapLeft.ticks;
+    startTicks_R = snapRight.ticks;
+    travel[0] = travel[1] = 0;
+
+    cbPeriodic_t timer;
+    cbPeriodicInit(&timer, PI_INTERVAL_MSEC * NSEC_PER_MSEC,
+                   PI_SPIN_USEC * NSEC_PER_USEC);
+
+    while (cbProfileNext(&cbProfile, &pos, &vel) || settle-- > 0) {
+        // Stop as soon as the goal is reached, so the robot never overshoots
+        int64_t sum = (int64_t)travel[0] + travel[1];
+        if (goal >= 0 ? sum >= 2 * (int64_t)goal : sum <= 2 * (int64_t)goal) {
+            break;
+        }
+        for (unsigned int i = 0; i < 2; i++) {
+            pid.setpoint[i] =
+                vel + (int32_t)(((int64_t)kx * (pos - travel[i])) >>
+                                CB_PID_FRAC_BITS);
+        }
+        int32_t out_L = pid.output[0], out_R = pid.output[1];
+        cbDrivePairMove(&cbDrive, out_L < 0 ? backward : forward,
+                        CB_PID_FLOAT(abs(out_L)),
+                        out_R < 0 ? backward : forward,
+                        CB_PID_FLOAT(abs(out_R)));
+        cbPeriodicWait(&timer);
+        cbEncoderSnapshot(&cbEncoderLeft, &snapLeft);
+        cbEncoderSnapshot(&cbEncoderRight, &snapRight);
+        now_us = cbTimeNowUs();
+        meas[0] = measure(&speedLeft, &snapLeft, now_us);
+        meas[1] = measure(&speedRight, &snapRight, now_us);
+        cbPidUpdate(&pid, meas);
+        travel[0] =
+            CB_PID_FIX((snapLeft.ticks - startTicks_L) * mmsPerTick_L);
+        travel[1] =
+            CB_PID_FIX((snapRight.ticks - startTicks_R) * mmsPerTick_R);
+        cbTelemetryLog(&cbTelemetry,
+                       &(cbTelemetryRecord_t){
+                           .time_us = now_us,
+                           .ticks_l = snapLeft.ticks,
+                           .ticks_r = snapRight.ticks,
+                           .duty_l = CB_PID_FLOAT(out_L),
+                           .duty_r = CB_PID_FLOAT(out_R),
+                           .setpoint = CB_PID_FLOAT(vel),
+                           .error = CB_PID_FLOAT(
+                               (pid.setpoint[0] - meas[0] +
+                                pid.setpoint[1] - meas[1]) / 2)});
+        // Quando il motore è in STALLO, passa il massimo della corrente...
+        // questo può essere problematico! Il cavo infatti si scalda, e gli
+        // avvolgimenti sul motore si scaldano e la cosa può portare alla
+        // rottura dello smalto e alla conseguente rottura del motore.
+        if (pid.saturated[0] > PWM_CLAMPING_EVENTS_MAX ||
+            pid.saturated[1] > PWM_CLAMPING_EVENTS_MAX) {
+            cbDrivePairReset(&cbDrive);
+            return CB_FAILURE;
+        }
     }
+    cbDrivePairReset(&cbDrive);
+    return CB_SUCCESS;
 }
 
 int main(void) {
     init();
     atexit(terminate);
-    control(500.f, 50.0f, 50.0f, .75f, .75f);
-    exit(EXIT_SUCCESS);
+    exit(control(500.f, 50.0f) == CB_SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE);
 }
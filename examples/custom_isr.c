@@ -3,32 +3,28 @@
 
 #include "../include/cbdef.h"
 #include "../include/encoder.h"
+#include "../include/periodic.h"
 
 #include "timespec.h"
 
-cbEncoder_t cbEncoderLeft = {PIN_ENCODER_LEFT_A, PIN_ENCODER_LEFT_B, GPIO_PIN_NC, 0, 0, 0};
-cbEncoder_t cbEncoderRight = {PIN_ENCODER_RIGHT_A, PIN_ENCODER_RIGHT_B, GPIO_PIN_NC, 0, 0, 0};
+cbEncoder_t cbEncoderLeft = CB_ENCODER_INIT(PIN_ENCODER_LEFT_A, PIN_ENCODER_LEFT_B);
+cbEncoder_t cbEncoderRight = CB_ENCODER_INIT(PIN_ENCODER_RIGHT_A, PIN_ENCODER_RIGHT_B);
 
+/* A minimal x1 decoder: one tick per quadrature cycle, on the edges of A,
+ * with the direction given by the level of B. */
 void myISRa(int gpio, int level, uint32_t tick, void* userdata) {
     cbEncoder_t* enc = (cbEncoder_t*)userdata;
-    if (gpio == enc->last_gpio) return;  // Debounce
-    enc->last_gpio = gpio;
-    enc->level_a = level;
-    if (level ^ enc->level_b) {  // Either one of A or B is 1
-        enc->direction = forward;
-        enc->ticks += enc->direction;
-    }
+    if (level > 1) return;  // Watchdog timeout
+    enc->state = (uint8_t)(level << 1 | (enc->state & 1));
+    if (enc->state & 1) return;  // Only count while B is low
+    enc->direction = level ? forward : backward;
+    enc->ticks += enc->direction;
 }
 
 void myISRb(int gpio, int level, uint32_t tick, void* userdata) {
     cbEncoder_t* enc = (cbEncoder_t*)userdata;
-    if (gpio == enc->last_gpio) return;  // Debounce
-    enc->last_gpio = gpio;
-    enc->level_b = level;
-    if (level ^ enc->level_a) {  // Either one of A or B is 1
-        enc->direction = backward;
-        enc->ticks += enc->direction;
-    }
+    if (level > 1) return;  // Watchdog timeout
+    enc->state = (uint8_t)((enc->state & 2) | level);
 }
 
 void init() {
@@ -47,19 +43,10 @@ void terminate() {
     gpioTerminate();
 }
 
-void sleep(int ms) {
-    timespec_t clock;
-    nsec_t delta = 0;
-    tsSet(&clock);
-    while(delta < (ms * NSEC_PER_MSEC)) {
-        delta += tsTickNs(&clock);
-    }
-}
-
 void printEncoderData(const cbEncoder_t* l, const cbEncoder_t* r) {
-    printf("          L         R\nD %10d%10d\nT %10d%10d\nE %10d%10d\n\n",
+    printf("          L         R\nD %10d%10d\nT %10lld%10lld\nE %10d%10d\n\n",
         l->direction, r->direction,
-        l->ticks, r->ticks,
+        (long long)l->ticks, (long long)r->ticks,
         l->bad_ticks, r->bad_ticks
     );
 }
@@ -77,9 +64,11 @@ int main(void) {
     atexit(terminate);
     int delta_ms = 500;
     printf("Every %dms:\n", delta_ms);
+    cbPeriodic_t timer;
+    cbPeriodicInit(&timer, (uint64_t)delta_ms * NSEC_PER_MSEC, 0);
     for(int i = 0; i < 20; i++) {
         printEncoderData(&cbEncoderLeft, &cbEncoderRight);
-        sleep(delta_ms);
+        cbPeriodicWait(&timer);
     }
     exit(EXIT_SUCCESS);
 }
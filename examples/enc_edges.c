@@ -0,0 +1,50 @@
+#include <pigpio.h>
+#include <stdlib.h>
+
+#include "../include/cbdef.h"
+#include "../include/encoder.h"
+#include "../include/periodic.h"
+
+#include "timespec.h"
+
+cbEncoder_t cbEncoderLeft = CB_ENCODER_INIT(PIN_ENCODER_LEFT_A, PIN_ENCODER_LEFT_B);
+cbEncoderRing_t cbRingLeft;
+
+void init() {
+    if (gpioInitialise() < 0) exit(EXIT_FAILURE);
+    cbEncoderGPIOinit(&cbEncoderLeft);
+    cbEncoderSync(&cbEncoderLeft);
+    cbEncoderAttachRing(&cbEncoderLeft, &cbRingLeft);
+    cbEncoderRegisterISRs(&cbEncoderLeft, 50);
+}
+
+void terminate() {
+    cbEncoderCancelISRs(&cbEncoderLeft);
+    gpioTerminate();
+}
+
+int main(void) {
+    init();
+    atexit(terminate);
+    int delta_ms = 500;
+    printf("Every %dms:\n", delta_ms);
+    cbPeriodic_t timer;
+    cbPeriodicInit(&timer, (uint64_t)delta_ms * NSEC_PER_MSEC, 0);
+    for(int i = 0; i < 20; i++) {
+        const cbEncoderEdge_t* edges;
+        size_t n, total = 0;
+        uint64_t first_us = 0, last_us = 0;
+        // Drain until empty, the ring may hand the edges back in two batches
+        while((n = cbEncoderDrain(&cbEncoderLeft, &edges)) > 0) {
+            if(!total) first_us = edges[0].ts_us;
+            last_us = edges[n - 1].ts_us;
+            total += n;
+            cbEncoderRelease(&cbEncoderLeft, n);
+        }
+        printf("%zu edges in %lluus, %u dropped\n", total,
+               (unsigned long long)(last_us - first_us),
+               atomic_load(&cbRingLeft.dropped));
+        cbPeriodicWait(&timer);
+    }
+    exit(EXIT_SUCCESS);
+}
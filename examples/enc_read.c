@@ -3,19 +3,22 @@
 
 #include "../include/cbdef.h"
 #include "../include/encoder.h"
+#include "../include/periodic.h"
 
 #include "timespec.h"
 
-cbEncoder_t cbEncoderLeft = {PIN_ENCODER_LEFT_A, PIN_ENCODER_LEFT_B, GPIO_PIN_NC, 0, 0, 0};
-cbEncoder_t cbEncoderRight = {PIN_ENCODER_RIGHT_A, PIN_ENCODER_RIGHT_B, GPIO_PIN_NC, 0, 0, 0};
+cbEncoder_t cbEncoderLeft = CB_ENCODER_INIT(PIN_ENCODER_LEFT_A, PIN_ENCODER_LEFT_B);
+cbEncoder_t cbEncoderRight = CB_ENCODER_INIT(PIN_ENCODER_RIGHT_A, PIN_ENCODER_RIGHT_B);
 
 void init() {
     if (gpioInitialise() < 0) exit(EXIT_FAILURE);
     // Left
     cbEncoderGPIOinit(&cbEncoderLeft);
+    cbEncoderSync(&cbEncoderLeft);
     cbEncoderRegisterISRs(&cbEncoderLeft, 50);
     // Right
     cbEncoderGPIOinit(&cbEncoderRight);
+    cbEncoderSync(&cbEncoderRight);
     cbEncoderRegisterISRs(&cbEncoderRight, 50);
 }
 
@@ -25,20 +28,16 @@ void terminate() {
     gpioTerminate();
 }
 
-void sleep(int ms) {
-    timespec_t clock;
-    nsec_t delta = 0;
-    tsSet(&clock);
-    while(delta < (ms * NSEC_PER_MSEC)) {
-        delta += tsTickNs(&clock);
-    }
-}
-
 void printEncoderData(const cbEncoder_t* l, const cbEncoder_t* r) {
-    printf("          L         R\nD %10d%10d\nT %10d%10d\nE %10d%10d\n\n",
-        l->direction, r->direction,
-        l->ticks, r->ticks,
-        l->bad_ticks, r->bad_ticks
+    cbEncoderSnapshot_t sl, sr;
+    cbEncoderSnapshot(l, &sl);
+    cbEncoderSnapshot(r, &sr);
+    printf("          L         R\nD %10d%10d\nT %10lld%10lld\nE %10u%10u\n"
+           "I %10u%10u\n\n",
+        sl.direction, sr.direction,
+        (long long)sl.ticks, (long long)sr.ticks,
+        sl.bad_ticks, sr.bad_ticks,
+        sl.illegal, sr.illegal
     );
 }
 
@@ -55,9 +54,11 @@ int main(void) {
     atexit(terminate);
     int delta_ms = 500;
     printf("Every %dms:\n", delta_ms);
+    cbPeriodic_t timer;
+    cbPeriodicInit(&timer, (uint64_t)delta_ms * NSEC_PER_MSEC, 0);
     for(int i = 0; i < 20; i++) {
         printEncoderData(&cbEncoderLeft, &cbEncoderRight);
-        sleep(delta_ms);
+        cbPeriodicWait(&timer);
     }
     exit(EXIT_SUCCESS);
 }
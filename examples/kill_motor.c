@@ -6,8 +6,8 @@
 
 #include "timespec.h"
 
-cbMotor_t cbMotorLeft = {PIN_LEFT_FORWARD, PIN_LEFT_BACKWARD, forward};
-cbMotor_t cbMotorRight = {PIN_RIGHT_FORWARD, PIN_RIGHT_BACKWARD, forward};
+cbMotor_t cbMotorLeft = CB_MOTOR_INIT(PIN_LEFT_FORWARD, PIN_LEFT_BACKWARD);
+cbMotor_t cbMotorRight = CB_MOTOR_INIT(PIN_RIGHT_FORWARD, PIN_RIGHT_BACKWARD);
 
 void init() {
     if (gpioInitialise() < 0) exit(EXIT_FAILURE);
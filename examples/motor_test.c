@@ -3,11 +3,12 @@
 
 #include "../include/cbdef.h"
 #include "../include/motor.h"
+#include "../include/periodic.h"
 
 #include "timespec.h"
 
-cbMotor_t cbMotorLeft = {PIN_LEFT_FORWARD, PIN_LEFT_BACKWARD, forward};
-cbMotor_t cbMotorRight = {PIN_RIGHT_FORWARD, PIN_RIGHT_BACKWARD, forward};
+cbMotor_t cbMotorLeft = CB_MOTOR_INIT(PIN_LEFT_FORWARD, PIN_LEFT_BACKWARD);
+cbMotor_t cbMotorRight = CB_MOTOR_INIT(PIN_RIGHT_FORWARD, PIN_RIGHT_BACKWARD);
 
 void init() {
     if (gpioInitialise() < 0) exit(EXIT_FAILURE);
@@ -21,15 +22,6 @@ void terminate() {
     gpioTerminate();
 }
 
-void sleep(int ms) {
-    timespec_t clock;
-    nsec_t delta = 0;
-    tsSet(&clock);
-    while(delta < (ms * NSEC_PER_MSEC)) {
-        delta += tsTickNs(&clock);
-    }
-}
-
 typedef struct {
     cbDir_t left, right;
 } pattern_t;
@@ -41,13 +33,15 @@ int main(void) {
     atexit(terminate);
     int delta_ms = 5000;
     printf("Every %dms:\n", delta_ms);
+    cbPeriodic_t timer;
+    cbPeriodicInit(&timer, (uint64_t)delta_ms * NSEC_PER_MSEC, 0);
     int pat_idx = 0;
     for(int i = 0; i < 4; i++) {
         printf("%d:%d:%d\n", pat_idx,
                              cbMotorMove(&cbMotorLeft, patterns[pat_idx].left, 0.5),
                              cbMotorMove(&cbMotorRight, patterns[pat_idx].right, 0.5));
         pat_idx = (++pat_idx) % 4;
-        sleep(delta_ms);
+        cbPeriodicWait(&timer);
     }
     exit(EXIT_SUCCESS);
 }
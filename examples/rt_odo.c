@@ -22,17 +22,9 @@
  */
 
 #include <pigpio.h>
-#include <pthread.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
-#include <errno.h>
-
-#include <linux/sched.h>
-#include <sched.h>
-#include <signal.h>
-#include <sys/syscall.h>
-#include <sys/types.h>
-#include <unistd.h>
 
 #define _USE_MATH_DEFINES
 #include <math.h>
@@ -40,14 +32,14 @@
 #include "../include/cbdef.h"
 #include "../include/motor.h"
 #include "../include/encoder.h"
+#include "../include/odometry.h"
+#include "../include/rt.h"
+#include "../include/telemetry.h"
+#include "../include/timebase.h"
 #include "timespec.h"
 
 /* RT SCHEDULING PARAMETERS ------------------------------------------------ */
 
-#define UPTICK_RUNTIME 5 * NSEC_PER_MSEC //< Expected task runtime in ns
-#define UPTICK_PERIOD 7 * NSEC_PER_MSEC //< Task period in ns
-#define UPTICK_DEADLINE 6 * NSEC_PER_MSEC //< Task deadline in ns
-
 #define ODO_RUNTIME 30 * NSEC_PER_MSEC //< Expected task runtime in ns
 #define ODO_PERIOD 40 * NSEC_PER_MSEC //< Task period in ns
 #define ODO_DEADLINE 31 * NSEC_PER_MSEC //< Task deadline in ns
@@ -58,292 +50,154 @@
 #define RIGHT_WHEEL_RAY_MM 33.f
 #define TICKS_PER_REVOLUTION 16 //< Ticks per motor revolution
 #define TRANSMISSION_RATIO 120
+#define WHEEL_TRACK_MM 120.f //< Distance between the wheels
 
 #define DISTANCE_FROM_GOAL 500.f //< Distance from goal in mm
 
 #define DUTY_CYC_L .5f //< Duty cycle for the left wheel
 #define DUTY_CYC_R DUTY_CYC_L //< Duty cycle for the right wheel
 
-/* TYPEDEFS ---------------------------------------------------------------- */
-
-/**
- * @brief Struct used by the task to communicate parameters to the scheduler
- * @see https://man7.org/linux/man-pages/man2/sched_getattr.2.html
- * @see https://www.i-programmer.info/programming/cc/13002-applying-c-deadline-scheduling.html?start=1
- */
-struct sched_attr {
-    uint32_t size;           /* Size of this structure */
-    uint32_t sched_policy;   /* Policy (SCHED_*) */
-    uint64_t sched_flags;    /* Flags */
-    int32_t sched_nice;      /* Nice value (SCHED_OTHER, SCHED_BATCH) */
-    uint32_t sched_priority; /* Static priority (SCHED_FIFO, SCHED_RR) */
-    /* The following fields are for SCHED_DEADLINE */
-    uint64_t sched_runtime;
-    uint64_t sched_deadline;
-    uint64_t sched_period;
-};
-
-/**
- * @brief A structure representing a task
- * @var worker::tid The POSIX Thread ID
- * @var worker::entry The entry point of the thread associated with the task
- */
-typedef struct task {
-    pthread_t tid;
-    void* (*entry)(void*);
-} task_t;
+#define TELEMETRY_PATH "rt_odo.tlm" //< Decode with tools/telemetry_dump
 
 /* GLOBALS ----------------------------------------------------------------- */
 
-cbMotor_t cbMotorLeft = {PIN_LEFT_FORWARD, PIN_LEFT_BACKWARD, forward};
-cbMotor_t cbMotorRight = {PIN_RIGHT_FORWARD, PIN_RIGHT_BACKWARD, forward};
-
-cbEncoder_t cbEncoderLeft = {
-    PIN_ENCODER_LEFT_A, PIN_ENCODER_LEFT_B, GPIO_PIN_NC, 0, 0, 0};
-cbEncoder_t cbEncoderRight = {
-    PIN_ENCODER_RIGHT_A, PIN_ENCODER_RIGHT_B, GPIO_PIN_NC, 0, 0, 0};
+cbMotor_t cbMotorLeft = CB_MOTOR_INIT(PIN_LEFT_FORWARD, PIN_LEFT_BACKWARD);
+cbMotor_t cbMotorRight = CB_MOTOR_INIT(PIN_RIGHT_FORWARD, PIN_RIGHT_BACKWARD);
 
-volatile int ticks_L, ticks_R;
-volatile int halt = 0;
-
-pthread_mutex_t ticksMutex;
+cbEncoder_t cbEncoderLeft =
+    CB_ENCODER_INIT(PIN_ENCODER_LEFT_A, PIN_ENCODER_LEFT_B);
+cbEncoder_t cbEncoderRight =
+    CB_ENCODER_INIT(PIN_ENCODER_RIGHT_A, PIN_ENCODER_RIGHT_B);
+cbEncoderGroup_t cbEncoders; //< Both encoders, decoded by one callback
+cbTelemetry_t cbTelemetry; //< Written by taskOdo only
 
 /* FUNCTIONS --------------------------------------------------------------- */
 
 void cbInit() {
+    cbEncoder_t* encoders[] = {&cbEncoderLeft, &cbEncoderRight};
     if (gpioInitialise() < 0) exit(EXIT_FAILURE);
+    cbTimeInit();
+    if (cbTelemetryOpen(&cbTelemetry, TELEMETRY_PATH, 0) != CB_SUCCESS) {
+        exit(EXIT_FAILURE);
+    }
     // Left
     cbMotorGPIOinit(&cbMotorLeft);
     cbEncoderGPIOinit(&cbEncoderLeft);
-    cbEncoderRegisterISRs(&cbEncoderLeft, 50);
     // Right
     cbMotorGPIOinit(&cbMotorRight);
     cbEncoderGPIOinit(&cbEncoderRight);
-    cbEncoderRegisterISRs(&cbEncoderRight, 50);
+    // Both
+    if (cbEncoderGroupInit(&cbEncoders, encoders, 2) != CB_SUCCESS ||
+        cbEncoderGroupRegister(&cbEncoders) != CB_SUCCESS) {
+        exit(EXIT_FAILURE);
+    }
 }
 
 void cbTerminate() {
     cbMotorReset(&cbMotorLeft);
     cbMotorReset(&cbMotorRight);
-    cbEncoderCancelISRs(&cbEncoderLeft);
-    cbEncoderCancelISRs(&cbEncoderRight);
+    cbEncoderGroupCancel(&cbEncoders);
+    cbTelemetryClose(&cbTelemetry);
+    cbTimeTerminate();
     gpioTerminate();
 }
 
 /**
- * @brief Wrapper for the __NR_sched_setattr kernel call
+ * @brief Odometry Task, called once per period by cbrt.
  *
- * @param pid The PID of the process whose parameters are going to be modified
- * @param attr A pointer to a sched_attr structure used to specify attributes
- * @param flags ???
+ * @param args A pointer to the odometry engine.
  *
- * @return On success, 0; on failure -1. The error code is stored in errno
+ * @return true until the goal has been reached.
  */
-static inline int sched_setattr(pid_t pid,
-								const struct sched_attr* attr,
-								unsigned int flags) {
-    // TODO who knows what "flags" does? Is
-    // it the same as "sched_attr.flags"?
-    return syscall(__NR_sched_setattr, pid, attr, flags);
-}
-
-/**
- * @brief Handler to be called when a `SIGXCPU` signal is generated by the
- * scheduler when missing a deadline and `SCHED_FLAG_DL_OVERRUN` is on.
- *
- * @param sig The number of the received signal.
- */
-void cbrtDlMissHandler(int sig) {
-    // BEGIN User handler
-    puts("Deadline miss!");
-    gpioTerminate();
-    // END User handler
-    (void) signal(SIGXCPU, SIG_DFL);
-}
-
-/**
- * @brief A task dedicated to updating the ticks.
- *
- * @param args A pointer to a memory area representing arguments. By default,
- * `NULL` is passed: this parameter is mostly useful if you have a thread
- * pool or a worker that needs some specific parameters.
- * @see https://computing.llnl.gov/tutorials/pthreads/
- *
- * @return In our case, nothing is returned, but having the function signature
- * return `void*` lets the programmer return arbitrary data from the thread.
- */
-void* cbrtUpdateTicksEntryPoint(void* args) {
-    struct sched_attr attr = {.size = sizeof(attr),
-                              .sched_flags = 0 | SCHED_FLAG_DL_OVERRUN,
-                              .sched_policy = SCHED_DEADLINE,
-                              .sched_runtime = UPTICK_RUNTIME, // ns
-                              .sched_period = UPTICK_PERIOD, // ns
-                              .sched_deadline = UPTICK_DEADLINE}; // ns
-    (void) signal(SIGXCPU, cbrtDlMissHandler);  // Register signal handler
-    if (sched_setattr(0, &attr, 0)) {
-        perror("cbrtUpdateTicksEntryPoint: sched_setattr");
-        exit(EXIT_FAILURE);
+bool cbrtOdoJob(void* args) {
+    cbOdometry_t* odo = args;
+    cbEncoderSnapshot_t snap_L, snap_R;
+    cbPose_t pose;
+    cbEncoderSnapshot(&cbEncoderLeft, &snap_L);
+    cbEncoderSnapshot(&cbEncoderRight, &snap_R);
+    cbOdoUpdate(odo, &snap_L, &snap_R);
+    cbOdoPose(odo, &pose);
+    cbTelemetryLog(&cbTelemetry,
+                   &(cbTelemetryRecord_t){.time_us = cbTimeNowUs(),
+                                          .ticks_l = snap_L.ticks,
+                                          .ticks_r = snap_R.ticks,
+                                          .x_nm = pose.x_nm,
+                                          .y_nm = pose.y_nm,
+                                          .theta = pose.theta,
+                                          .duty_l = DUTY_CYC_L,
+                                          .duty_r = DUTY_CYC_R,
+                                          .setpoint = DISTANCE_FROM_GOAL,
+                                          .error = DISTANCE_FROM_GOAL -
+                                                   pose.x_nm / 1e6f});
+    if (pose.x_nm >= (int64_t)(DISTANCE_FROM_GOAL * 1e6)) {
+        cbMotorReset(&cbMotorLeft);
+        cbMotorReset(&cbMotorRight);
+        return false;
     }
-    // BEGIN Worker variables
-    // END Worker variables
+    return true;
+}
 
-    for (;;) {
-        // BEGIN Worker code
-        if (pthread_mutex_trylock(&ticksMutex) != 0) {
-    		if (errno == EBUSY) {
-    			// The mutex was busy, yielding...
-      			sched_yield();
-    		} else {
-      			perror("cbrtUpdateTicksEntryPoint: pthread_mutex_trylock");
-      			exit(EXIT_FAILURE);
-    		}
-    	} else {
-			// CRITICAL SECTION
-    		// We have the lock on the mutex and we can update the ticks
+cbOdometry_t odometry;
 
-        	ticks_L = cbEncoderLeft.ticks;
-        	ticks_R = cbEncoderRight.ticks;
-        	if (pthread_mutex_unlock(&ticksMutex) != 0) {
-    			perror("cbrtUpdateTicksEntryPoint: pthread_mutex_unlock");
-    			exit(EXIT_FAILURE);
-  			}
-    	}
-    	pthread_testcancel();
-        // END Worker code
-        sched_yield();
-    };
-    pthread_exit(EXIT_SUCCESS);
-    return (NULL);
-}
+cbRtTask_t taskOdo = {.name = "taskOdo",
+                      .job = cbrtOdoJob,
+                      .args = &odometry,
+                      .runtime_ns = ODO_RUNTIME,
+                      .deadline_ns = ODO_DEADLINE,
+                      .period_ns = ODO_PERIOD};
 
 /**
- * @brief Odometry Task.
+ * @brief Prints the summary of a timing histogram.
  *
- * @param args A pointer to a memory area representing arguments. By default,
- * `NULL` is passed: this parameter is mostly useful if you have a thread
- * pool or a worker that needs some specific parameters.
- * @see https://computing.llnl.gov/tutorials/pthreads/
- *
- * @return In our case, nothing is returned, but having the function signature
- * return `void*` lets the programmer return arbitrary data from the thread.
+ * @param name The name of the histogram.
+ * @param hist A pointer to the histogram.
  */
-void* cbrtOdoEntryPoint(void* args) {
-    struct sched_attr attr = {.size = sizeof(attr),
-                              .sched_flags = 0 | SCHED_FLAG_DL_OVERRUN,
-                              .sched_policy = SCHED_DEADLINE,
-                              .sched_runtime = ODO_RUNTIME, // ns
-                              .sched_period = ODO_PERIOD, // ns
-                              .sched_deadline = ODO_DEADLINE}; // ns
-    (void) signal(SIGXCPU, cbrtDlMissHandler);  // Register signal handler
-    if (sched_setattr(0, &attr, 0)) {
-        perror("cbrtEntryPoint: sched_setattr");
-        exit(EXIT_FAILURE);
-    }
-    // BEGIN Worker variables
-    const float mmsPerTick_L = (LEFT_WHEEL_RAY_MM * 2 * M_PI) /
-                      (TICKS_PER_REVOLUTION * TRANSMISSION_RATIO);
-
-    const float mmsPerTick_R = (RIGHT_WHEEL_RAY_MM * 2 * M_PI) /
-                      (TICKS_PER_REVOLUTION * TRANSMISSION_RATIO);
-    float distFromGoal_mm = DISTANCE_FROM_GOAL;
-    int myTicks_L, myTicks_R;
-    int prevTicks_L = 0, prevTicks_R = 0;
-    float travel_mm_L, travel_mm_R;
-    //timespec_t clock;
-    //tsSet(&clock);
-    cbMotorMove(&cbMotorLeft, forward, DUTY_CYC_L);
-    cbMotorMove(&cbMotorRight, forward, DUTY_CYC_R);
-    // END Worker variables
-
-    for (;;) {
-        // BEGIN Worker code
-        if (pthread_mutex_trylock(&ticksMutex) != 0) {
-    		if (errno == EBUSY) {
-    			// The mutex was busy, yielding...
-      			sched_yield();
-    		} else {
-      			perror("cbrtUpdateTicksEntryPoint: pthread_mutex_trylock");
-      			exit(EXIT_FAILURE);
-    		}
-    	} else {
-			// CRITICAL SECTION
-    		// We have the lock on the mutex and we can update the ticks
-        	myTicks_L = ticks_L;
-        	myTicks_R = ticks_R;
-        	if (pthread_mutex_unlock(&ticksMutex) != 0) {
-    			perror("cbrtUpdateTicksEntryPoint: pthread_mutex_unlock");
-    			exit(EXIT_FAILURE);
-  			}
-    	}
-    	travel_mm_L = (myTicks_L - prevTicks_L) * mmsPerTick_L;
-    	prevTicks_L = myTicks_L;
-    	// speed_mm_s_L = (travel_mm_L / tsTickNs(&clock)) * NSEC_PER_MSEC;
-    	travel_mm_R = (myTicks_R - prevTicks_R) * mmsPerTick_R;
-    	prevTicks_R = myTicks_R;
-        distFromGoal_mm -= (travel_mm_L + travel_mm_R) / 2;
-		// Takes A LOT of CPU time. Do not use with low sched values.
-        //printf("TL: %f, TR: %f, DfG: %f\n", travel_mm_L, travel_mm_R, distFromGoal_mm);
-        if(distFromGoal_mm < .0f) {
-    		cbMotorReset(&cbMotorLeft);
-    		cbMotorReset(&cbMotorRight);
-        	break;
-        }
-        // END Worker code
-        sched_yield();
-    };
-    pthread_exit(EXIT_SUCCESS);
-    return (NULL);
+void printHist(const char* name, const cbHist_t* hist) {
+    cbHistSummary_t sum;
+    cbHistSummarize(hist, &sum);
+    printf("main: taskOdo: %-6s p50 %lluns, p99 %lluns, max %lluns\n", name,
+           (unsigned long long)sum.p50, (unsigned long long)sum.p99,
+           (unsigned long long)sum.max);
 }
 
-task_t taskOdo = { .tid = 0, .entry = cbrtOdoEntryPoint };
-task_t taskUpdateTicks = { .tid = 0, .entry = cbrtUpdateTicksEntryPoint };
-
 int main(void) {
     cbInit();
-    // Initialize the mutex
-    if (pthread_mutex_init(&ticksMutex, NULL) != 0) {
-    	perror("main: pthread_mutex_init");
-    	exit(EXIT_FAILURE);
-  	}
-  	{ // Create the tasks
-		if(pthread_create(&(taskOdo.tid), NULL, taskOdo.entry, NULL) != 0) {
-			perror("main: pthread_create: taskOdo");
-			exit(EXIT_FAILURE);
-		} else {
-	    	puts("main: taskOdo: Created.");
-		}
-
-		if(pthread_create(&(taskUpdateTicks.tid), NULL,
-						  taskUpdateTicks.entry, NULL) != 0) {
-			perror("main: pthread_create: taskUpdateTicks");
-			exit(EXIT_FAILURE);
-		} else {
-			puts("main: taskUpdateTicks: Created.");
-		}
-	}
-	{ // Wait for task completion
-	    if(pthread_join(taskOdo.tid, NULL) != 0) {
-	    	perror("main: pthread_join");
-	    	exit(EXIT_FAILURE);
-	    } else {
-	    	puts("main: taskOdo: Completed!");
-	    	if(pthread_cancel(taskUpdateTicks.tid) != 0) {
-   				perror("main: pthread_cancel");
-   				exit(EXIT_FAILURE);
- 			}
-	    }
-
-	    if(pthread_join(taskUpdateTicks.tid, NULL) != 0) {
-	    	perror("main: pthread_join");
-	    	exit(EXIT_FAILURE);
-	    } else {
-	    	puts("main: taskUpdateTicks: Completed!");
-	    }
-	}
-    if (pthread_mutex_destroy(&ticksMutex) != 0) {
-    	perror("main: pthread_mutex_destroy");
-    	exit(EXIT_FAILURE);
-  	}
-  	cbTerminate();
+    cbOdoInit(&odometry,
+              cbOdoMmPerTick(LEFT_WHEEL_RAY_MM, TICKS_PER_REVOLUTION,
+                             TRANSMISSION_RATIO),
+              cbOdoMmPerTick(RIGHT_WHEEL_RAY_MM, TICKS_PER_REVOLUTION,
+                             TRANSMISSION_RATIO),
+              WHEEL_TRACK_MM);
+    cbMotorMove(&cbMotorLeft, forward, DUTY_CYC_L);
+    cbMotorMove(&cbMotorRight, forward, DUTY_CYC_R);
+    // Create the task
+    if (cbRtTaskStart(&taskOdo) != CB_SUCCESS) {
+        puts("main: taskOdo: Could not be started.");
+        cbTerminate();
+        exit(EXIT_FAILURE);
+    } else {
+        printf("main: taskOdo: Created, %s.\n",
+               cbRtPolicyName(atomic_load(&taskOdo.policy)));
+    }
+    // Wait for task completion
+    if (cbRtTaskJoin(&taskOdo) != CB_SUCCESS) {
+        puts("main: taskOdo: Could not be joined.");
+        exit(EXIT_FAILURE);
+    } else {
+        cbRtStats_t* stats = taskOdo.stats;
+        printf("main: taskOdo: Completed! %llu cycles, %llu overruns, "
+               "%llu deadline misses.\n",
+               (unsigned long long)atomic_load(&stats->cycles),
+               (unsigned long long)atomic_load(&stats->overruns),
+               (unsigned long long)atomic_load(&stats->misses));
+        printHist("wakeup", &stats->wakeup);
+        printHist("exec", &stats->exec);
+        printHist("jitter", &stats->jitter);
+        cbPose_t pose;
+        cbOdoPose(&odometry, &pose);
+        printf("main: taskOdo: x %.1fmm, y %.1fmm, heading %.3frad\n",
+               pose.x_nm / 1e6, pose.y_nm / 1e6, cbOdoBamToRad(pose.theta));
+    }
+    cbTerminate();
     exit(EXIT_SUCCESS);
 }
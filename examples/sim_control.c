@@ -0,0 +1,221 @@
+/**
+ * @file sim_control.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief The P-I controller of control.c, running on the simulator.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * No robot is needed: the motors, gearboxes and encoders are simulated and the
+ * control loop advances the simulated time by one period per iteration, so
+ * the program runs as fast as the host allows. The exit status is non-zero if
+ * the robot ends up farther than SIM_TOLERANCE_MM from the goal, which makes
+ * it usable as a regression test. Unlike control.c, the speed estimates run
+ * through the alpha-beta filter, see cbSpeedSetFilter(). If a path is given,
+ * a telemetry record is written to it every period, see
+ * tools/telemetry_dump.c.
+ */
+
+#include <stdlib.h>
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+#include "../include/cbdef.h"
+#include "../include/encoder.h"
+#include "../include/hal.h"
+#include "../include/motor.h"
+#include "../include/odometry.h"
+#include "../include/pid.h"
+#include "../include/profile.h"
+#include "../include/sim.h"
+#include "../include/speed.h"
+#include "../include/telemetry.h"
+#include "../include/timebase.h"
+#include "timespec.h"
+
+#define KP 0.005f
+#define KI 0.025f //< Per second
+#define KB 5.f //< Anti-windup, per second
+
+#define PI_INTERVAL_USEC 20000 // 50Hz
+
+#define WHEEL_RAY_MM 33.f
+#define TICKS_PER_REVOLUTION 16
+#define TRANSMISSION_RATIO 120
+#define WHEEL_TRACK_MM 120.f //< Distance between the wheels
+
+#define KX 2.f //< Position error to speed setpoint, per second
+
+#define FILTER_ALPHA .5f //< Position gain of the speed filter
+#define FILTER_BETA .1f //< Speed gain of the speed filter
+
+#define DISTANCE_FROM_GOAL_MM 500.f
+#define TARGET_SPEED_MM_S 50.f
+#define ACCELERATION_MM_S2 100.f
+#define JERK_MM_S3 500.f
+#define SETTLE_PERIODS 50 //< Periods allowed to settle after the profile
+#define SIM_TOLERANCE_MM 10.f //< Maximum error on the traveled distance
+
+cbMotor_t cbMotorLeft = CB_MOTOR_INIT(PIN_LEFT_FORWARD, PIN_LEFT_BACKWARD);
+cbMotor_t cbMotorRight = CB_MOTOR_INIT(PIN_RIGHT_FORWARD, PIN_RIGHT_BACKWARD);
+cbDrivePair_t cbDrive;
+cbEncoder_t cbEncoderLeft =
+    CB_ENCODER_INIT(PIN_ENCODER_LEFT_A, PIN_ENCODER_LEFT_B);
+cbEncoder_t cbEncoderRight =
+    CB_ENCODER_INIT(PIN_ENCODER_RIGHT_A, PIN_ENCODER_RIGHT_B);
+cbSimWheel_t cbSimLeft, cbSimRight;
+cbProfile_t cbProfile;
+
+void init() {
+    cbHalSelect(&cbHalSim);
+    if (cbHal->init() != 0) exit(EXIT_FAILURE);
+    cbSimWheelInit(&cbSimLeft, PIN_LEFT_FORWARD, PIN_LEFT_BACKWARD,
+                   PIN_ENCODER_LEFT_A, PIN_ENCODER_LEFT_B);
+    cbSimWheelInit(&cbSimRight, PIN_RIGHT_FORWARD, PIN_RIGHT_BACKWARD,
+                   PIN_ENCODER_RIGHT_A, PIN_ENCODER_RIGHT_B);
+    cbSimRight.noload_rps *= .95f; // The wheels are never identical
+    cbSimAttachWheel(&cbSimLeft);
+    cbSimAttachWheel(&cbSimRight);
+    cbTimeInit();
+    // Left
+    cbMotorGPIOinit(&cbMotorLeft);
+    cbEncoderGPIOinit(&cbEncoderLeft);
+    cbEncoderSync(&cbEncoderLeft);
+    cbEncoderRegisterISRs(&cbEncoderLeft, 50);
+    // Right
+    cbMotorGPIOinit(&cbMotorRight);
+    cbEncoderGPIOinit(&cbEncoderRight);
+    cbEncoderSync(&cbEncoderRight);
+    cbEncoderRegisterISRs(&cbEncoderRight, 50);
+    // Both
+    if (cbDrivePairInit(&cbDrive, &cbMotorLeft, &cbMotorRight) != CB_SUCCESS) {
+        exit(EXIT_FAILURE);
+    }
+}
+
+void terminate() {
+    cbDrivePairReset(&cbDrive);
+    cbEncoderCancelISRs(&cbEncoderLeft);
+    cbEncoderCancelISRs(&cbEncoderRight);
+    cbTimeTerminate();
+    cbHal->terminate();
+}
+
+/**
+ * @brief Measures the speed of a wheel.
+ * @param speed The speed estimator of the wheel.
+ * @param snap Set to a snapshot of the encoder of the wheel.
+ * @param enc The encoder of the wheel.
+ * @return The speed in mm/s, Q16.16.
+ */
+int32_t measure(cbSpeed_t* speed, cbEncoderSnapshot_t* snap,
+                const cbEncoder_t* enc) {
+    cbEncoderSnapshot(enc, snap);
+    return CB_PID_FIX(cbSpeedUpdate(speed, snap, cbTimeNowUs()));
+}
+
+int main(int argc, char* argv[]) {
+    const float mmsPerTick =
+        cbOdoMmPerTick(WHEEL_RAY_MM, TICKS_PER_REVOLUTION, TRANSMISSION_RATIO);
+    const int32_t kx = CB_PID_FIX(KX);
+    cbSpeed_t speedLeft, speedRight;
+    cbPid_t pid;
+    int32_t meas[CB_PID_LANES] = {0};
+    int32_t pos, vel, goal;
+    int settle = SETTLE_PERIODS;
+    cbOdometry_t odo;
+    cbEncoderSnapshot_t snapLeft = {0}, snapRight = {0};
+    cbPose_t pose;
+    timespec_t clock;
+    cbTelemetry_t tel = {0};
+    init();
+    if (argc > 1 && cbTelemetryOpen(&tel, argv[1], 0) != CB_SUCCESS) {
+        exit(EXIT_FAILURE);
+    }
+    if (cbProfileInit(&cbProfile, DISTANCE_FROM_GOAL_MM, TARGET_SPEED_MM_S,
+                      ACCELERATION_MM_S2, JERK_MM_S3,
+                      PI_INTERVAL_USEC) != CB_SUCCESS) {
+        exit(EXIT_FAILURE);
+    }
+    goal = cbProfile.pos[cbProfile.steps - 1];
+    cbSpeedInit(&speedLeft, mmsPerTick, 5000, 200000);
+    cbSpeedInit(&speedRight, mmsPerTick, 5000, 200000);
+    cbSpeedSetFilter(&speedLeft, FILTER_ALPHA, FILTER_BETA);
+    cbSpeedSetFilter(&speedRight, FILTER_ALPHA, FILTER_BETA);
+    cbOdoInit(&odo, mmsPerTick, mmsPerTick, WHEEL_TRACK_MM);
+    cbPidInit(&pid, PI_INTERVAL_USEC);
+    for (unsigned int i = 0; i < 2; i++) {
+        cbPidSetGains(&pid, i, KP, KI, 0.f, KB);
+        cbPidSetLimits(&pid, i, 0.f, 1.f);
+    }
+    tsSet(&clock);
+    // Each period, follow the velocity of the profile and correct the
+    // position error of each wheel, stopping as soon as the goal is reached
+    while (cbProfileNext(&cbProfile, &pos, &vel) || settle-- > 0) {
+        int32_t travel[2] = {CB_PID_FIX(snapLeft.ticks * mmsPerTick),
+                             CB_PID_FIX(snapRight.ticks * mmsPerTick)};
+        if (travel[0] + travel[1] >= 2 * goal) break;
+        for (unsigned int i = 0; i < 2; i++) {
+            pid.setpoint[i] =
+                vel + (int32_t)(((int64_t)kx * (pos - travel[i])) >>
+                                CB_PID_FRAC_BITS);
+        }
+        cbDrivePairMove(&cbDrive, forward, CB_PID_FLOAT(pid.output[0]),
+                        forward, CB_PID_FLOAT(pid.output[1]));
+        cbSimStep(PI_INTERVAL_USEC);
+        meas[0] = measure(&speedLeft, &snapLeft, &cbEncoderLeft);
+        meas[1] = measure(&speedRight, &snapRight, &cbEncoderRight);
+        cbPidUpdate(&pid, meas);
+        cbOdoUpdate(&odo, &snapLeft, &snapRight);
+        if (!tel.header) continue;
+        cbOdoPose(&odo, &pose);
+        cbTelemetryLog(&tel, &(cbTelemetryRecord_t){
+                                 .time_us = cbTimeNowUs(),
+                                 .ticks_l = snapLeft.ticks,
+                                 .ticks_r = snapRight.ticks,
+                                 .x_nm = pose.x_nm,
+                                 .y_nm = pose.y_nm,
+                                 .theta = pose.theta,
+                                 .duty_l = CB_PID_FLOAT(pid.output[0]),
+                                 .duty_r = CB_PID_FLOAT(pid.output[1]),
+                                 .setpoint = CB_PID_FLOAT(vel),
+                                 .error = CB_PID_FLOAT(
+                                     (pid.setpoint[0] - meas[0] +
+                                      pid.setpoint[1] - meas[1]) / 2)});
+    }
+    cbDrivePairReset(&cbDrive);
+    nsec_t wall_ns = tsTickNs(&clock);
+    uint64_t sim_us = cbSimNowUs() - CB_SIM_EPOCH_US;
+    double travel_mm = (cbSimWheelTravelMm(&cbSimLeft) +
+                        cbSimWheelTravelMm(&cbSimRight)) / 2;
+    printf("Simulated %.3fs in %.3fms (%.0fx real time)\n", sim_us / 1e6,
+           wall_ns / 1e6, sim_us * 1e3 / wall_ns);
+    printf("Traveled %.1fmm (L: %.1fmm, R: %.1fmm), goal %.1fmm\n",
+           travel_mm, cbSimWheelTravelMm(&cbSimLeft),
+           cbSimWheelTravelMm(&cbSimRight), DISTANCE_FROM_GOAL_MM);
+    cbOdoPose(&odo, &pose);
+    printf("Odometry: x %.1fmm, y %.1fmm, heading %.4frad (actual %.4frad)\n",
+           pose.x_nm / 1e6, pose.y_nm / 1e6, cbOdoBamToRad(pose.theta),
+           (cbSimWheelTravelMm(&cbSimRight) - cbSimWheelTravelMm(&cbSimLeft)) /
+               WHEEL_TRACK_MM);
+    cbTelemetryClose(&tel);
+    terminate();
+    exit(fabs(travel_mm - DISTANCE_FROM_GOAL_MM) <= SIM_TOLERANCE_MM
+             ? EXIT_SUCCESS
+             : EXIT_FAILURE);
+}
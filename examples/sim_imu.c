@@ -0,0 +1,133 @@
+/**
+ * @file sim_imu.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief FIFO burst reads from the LSM9DS1, on the simulator.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * The simulated IMU replays a recording of FIFO slots: the raw slots in the
+ * file given as argument, e.g. recorded with tools/imu_record.c, or else a
+ * synthetic recording of the robot turning on the spot at YAW_DPS. The
+ * control loop polls the FIFO once per period and integrates the yaw rate
+ * from the samples. With the synthetic recording the exit status is
+ * non-zero if the integrated heading is off by more than SIM_TOLERANCE_DEG,
+ * which makes it usable as a regression test.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../include/cbdef.h"
+#include "../include/hal.h"
+#include "../include/imu.h"
+#include "../include/sim.h"
+#include "../include/timebase.h"
+
+#define CONTROL_PERIOD_US 20000 // 50Hz
+#define SIM_SECONDS 2
+#define SIM_TOLERANCE_DEG 1.
+#define YAW_DPS 90.
+
+#define RECORDING_MAX 65536 //< Slots
+
+cbImu_t cbImu = CB_IMU_INIT;
+cbSimImu_t cbSimImu;
+uint8_t cbRecording[RECORDING_MAX][CB_IMU_SLOT_SIZE];
+
+/**
+ * @brief Stores a little endian 16-bit value.
+ * @param p A pointer to the low byte.
+ * @param value The value.
+ */
+void le16(uint8_t* p, int value) {
+    p[0] = (uint8_t)(value & 0xFF);
+    p[1] = (uint8_t)((value >> 8) & 0xFF);
+}
+
+/**
+ * @brief Fills the recording with the robot turning at YAW_DPS, at rest
+ *        otherwise, with some noise on the accelerometer.
+ * @return The number of slots.
+ */
+size_t synthesize(void) {
+    int yaw = (int)lround(YAW_DPS / .0175); // At 500deg/s
+    int g = (int)lround(1. / .000122); // At 4g
+    for (size_t i = 0; i < 256; i++) {
+        int noise = (int)(i * 37 % 11) - 5;
+        le16(&cbRecording[i][0], 0);
+        le16(&cbRecording[i][2], 0);
+        le16(&cbRecording[i][4], yaw);
+        le16(&cbRecording[i][6], noise);
+        le16(&cbRecording[i][8], -noise);
+        le16(&cbRecording[i][10], g + noise);
+    }
+    return 256;
+}
+
+int main(int argc, char* argv[]) {
+    size_t slots;
+    if (argc > 1) {
+        FILE* file = fopen(argv[1], "rb");
+        if (!file) {
+            perror(argv[1]);
+            exit(EXIT_FAILURE);
+        }
+        slots = fread(cbRecording, CB_IMU_SLOT_SIZE, RECORDING_MAX, file);
+        fclose(file);
+        if (!slots) exit(EXIT_FAILURE);
+    } else {
+        slots = synthesize();
+    }
+    cbHalSelect(&cbHalSim);
+    if (cbHal->init() != 0) exit(EXIT_FAILURE);
+    cbSimImuInit(&cbSimImu, cbRecording[0], slots);
+    cbSimAttachImu(&cbSimImu);
+    cbTimeInit();
+    if (cbImuOpen(&cbImu) != CB_SUCCESS) exit(EXIT_FAILURE);
+    double heading_deg = 0., accel_z = 0.;
+    unsigned long samples = 0;
+    for (int i = 0; i < SIM_SECONDS * 1000000 / CONTROL_PERIOD_US; i++) {
+        cbSimStep(CONTROL_PERIOD_US);
+        if (cbImuPoll(&cbImu) < 0) exit(EXIT_FAILURE);
+        const cbImuSample_t* batch;
+        size_t count;
+        while ((count = cbImuDrain(&cbImu, &batch)) > 0) {
+            for (size_t k = 0; k < count; k++) {
+                heading_deg += batch[k].gyro[2] * cbImu.gyro_dps *
+                               cbImu.period_us / 1e6;
+                accel_z += batch[k].accel[2] * cbImu.accel_g;
+            }
+            samples += count;
+            cbImuRelease(&cbImu, count);
+        }
+    }
+    printf("%lu samples in %u I2C operations (%.2f per sample), "
+           "%u overruns\n",
+           samples, cbImu.transfers, (double)cbImu.transfers / samples,
+           cbImu.overruns);
+    printf("Heading %.2fdeg, mean acceleration on Z %.3fg\n", heading_deg,
+           accel_z / samples);
+    cbImuClose(&cbImu);
+    cbTimeTerminate();
+    cbHal->terminate();
+    if (argc > 1) exit(EXIT_SUCCESS);
+    exit(fabs(heading_deg - YAW_DPS * SIM_SECONDS) <= SIM_TOLERANCE_DEG
+             ? EXIT_SUCCESS
+             : EXIT_FAILURE);
+}
@@ -0,0 +1,231 @@
+/**
+ * @file sim_mailbox.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief A controller driven by another process through the mailbox.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * The controller creates the mailbox and forks a front-end, which attaches
+ * to it like a separate program would. The front-end drives the robot
+ * forward by posting speed setpoints, watches the published state until
+ * the robot has traveled TRAVEL_MM, then stops it. The controller runs on
+ * the simulator, paced at SPEEDUP times real time.
+ */
+
+#define _POSIX_C_SOURCE 200809L  // nanosleep()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/cbdef.h"
+#include "../include/encoder.h"
+#include "../include/hal.h"
+#include "../include/mailbox.h"
+#include "../include/motor.h"
+#include "../include/odometry.h"
+#include "../include/periodic.h"
+#include "../include/pid.h"
+#include "../include/sim.h"
+#include "../include/speed.h"
+#include "../include/timebase.h"
+#include "timespec.h"
+
+#define KP 0.005f
+#define KI 0.025f //< Per second
+#define KB 5.f //< Anti-windup, per second
+
+#define PI_INTERVAL_USEC 20000 // 50Hz
+#define SPEEDUP 10 //< Simulated time runs this much faster than real time
+
+#define WHEEL_RAY_MM 33.f
+#define TICKS_PER_REVOLUTION 16
+#define TRANSMISSION_RATIO 120
+#define WHEEL_TRACK_MM 120.f
+
+#define SPEED_MM_S 80.f
+#define TRAVEL_MM 200.f
+#define MAX_PERIODS 2000 //< Gives up if no stop command comes
+
+#define MAILBOX_PATH "/dev/shm/coderbot-sim" //< Not to clash with a robot
+
+cbMotor_t cbMotorLeft = CB_MOTOR_INIT(PIN_LEFT_FORWARD, PIN_LEFT_BACKWARD);
+cbMotor_t cbMotorRight = CB_MOTOR_INIT(PIN_RIGHT_FORWARD, PIN_RIGHT_BACKWARD);
+cbDrivePair_t cbDrive;
+cbEncoder_t cbEncoderLeft =
+    CB_ENCODER_INIT(PIN_ENCODER_LEFT_A, PIN_ENCODER_LEFT_B);
+cbEncoder_t cbEncoderRight =
+    CB_ENCODER_INIT(PIN_ENCODER_RIGHT_A, PIN_ENCODER_RIGHT_B);
+cbSimWheel_t cbSimLeft, cbSimRight;
+
+void init() {
+    cbHalSelect(&cbHalSim);
+    if (cbHal->init() != 0) exit(EXIT_FAILURE);
+    cbSimWheelInit(&cbSimLeft, PIN_LEFT_FORWARD, PIN_LEFT_BACKWARD,
+                   PIN_ENCODER_LEFT_A, PIN_ENCODER_LEFT_B);
+    cbSimWheelInit(&cbSimRight, PIN_RIGHT_FORWARD, PIN_RIGHT_BACKWARD,
+                   PIN_ENCODER_RIGHT_A, PIN_ENCODER_RIGHT_B);
+    cbSimAttachWheel(&cbSimLeft);
+    cbSimAttachWheel(&cbSimRight);
+    cbTimeInit();
+    cbMotorGPIOinit(&cbMotorLeft);
+    cbEncoderGPIOinit(&cbEncoderLeft);
+    cbEncoderSync(&cbEncoderLeft);
+    cbEncoderRegisterISRs(&cbEncoderLeft, 50);
+    cbMotorGPIOinit(&cbMotorRight);
+    cbEncoderGPIOinit(&cbEncoderRight);
+    cbEncoderSync(&cbEncoderRight);
+    cbEncoderRegisterISRs(&cbEncoderRight, 50);
+    if (cbDrivePairInit(&cbDrive, &cbMotorLeft, &cbMotorRight) != CB_SUCCESS) {
+        exit(EXIT_FAILURE);
+    }
+}
+
+void terminate() {
+    cbDrivePairReset(&cbDrive);
+    cbEncoderCancelISRs(&cbEncoderLeft);
+    cbEncoderCancelISRs(&cbEncoderRight);
+    cbTimeTerminate();
+    cbHal->terminate();
+}
+
+/**
+ * @brief The front-end, in its own process. It only knows the mailbox.
+ * @return The exit status of the process.
+ */
+int frontEnd(void) {
+    const float mmsPerTick =
+        cbOdoMmPerTick(WHEEL_RAY_MM, TICKS_PER_REVOLUTION, TRANSMISSION_RATIO);
+    const struct timespec poll = {0, 5 * NSEC_PER_MSEC};
+    cbMailbox_t mb;
+    cbMailboxState_t state;
+    if (cbMailboxAttach(&mb, MAILBOX_PATH, 0) != CB_SUCCESS)
+        return EXIT_FAILURE;
+    uint32_t id = cbMailboxPost(&mb, CB_MAILBOX_SPEED, SPEED_MM_S, SPEED_MM_S);
+    do {
+        nanosleep(&poll, NULL);
+        cbMailboxRead(&mb, &state);
+    } while (state.command_id != id);
+    printf("front-end: Command %u applied at cycle %llu.\n", id,
+           (unsigned long long)state.cycles);
+    do {
+        nanosleep(&poll, NULL);
+        cbMailboxRead(&mb, &state);
+    } while ((state.ticks_l + state.ticks_r) * mmsPerTick / 2 < TRAVEL_MM);
+    id = cbMailboxPost(&mb, CB_MAILBOX_STOP, 0.f, 0.f);
+    printf("front-end: Stop at cycle %llu, x %.1fmm, health %#x.\n",
+           (unsigned long long)state.cycles, state.x_nm / 1e6, state.health);
+    cbMailboxClose(&mb);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Measures the speed of a wheel.
+ * @param speed The speed estimator of the wheel.
+ * @param snap Set to a snapshot of the encoder of the wheel.
+ * @param enc The encoder of the wheel.
+ * @return The speed in mm/s, Q16.16.
+ */
+int32_t measure(cbSpeed_t* speed, cbEncoderSnapshot_t* snap,
+                const cbEncoder_t* enc) {
+    cbEncoderSnapshot(enc, snap);
+    return CB_PID_FIX(cbSpeedUpdate(speed, snap, cbTimeNowUs()));
+}
+
+int main(void) {
+    const float mmsPerTick =
+        cbOdoMmPerTick(WHEEL_RAY_MM, TICKS_PER_REVOLUTION, TRANSMISSION_RATIO);
+    cbMailbox_t mb;
+    cbMailboxCommand_t cmd = {.mode = CB_MAILBOX_STOP};
+    cbMailboxState_t state = {0};
+    cbSpeed_t speedLeft, speedRight;
+    cbPid_t pid;
+    int32_t meas[CB_PID_LANES] = {0};
+    cbOdometry_t odo;
+    cbEncoderSnapshot_t snapLeft, snapRight;
+    cbPose_t pose;
+    cbPeriodic_t timer;
+    int status;
+    if (cbMailboxCreate(&mb, MAILBOX_PATH) != CB_SUCCESS) exit(EXIT_FAILURE);
+    fflush(stdout);
+    pid_t child = fork();
+    if (child < 0) exit(EXIT_FAILURE);
+    if (child == 0) exit(frontEnd());
+    init();
+    cbSpeedInit(&speedLeft, mmsPerTick, 5000, 200000);
+    cbSpeedInit(&speedRight, mmsPerTick, 5000, 200000);
+    cbOdoInit(&odo, mmsPerTick, mmsPerTick, WHEEL_TRACK_MM);
+    cbPidInit(&pid, PI_INTERVAL_USEC);
+    for (unsigned int i = 0; i < 2; i++) {
+        cbPidSetGains(&pid, i, KP, KI, 0.f, KB);
+        cbPidSetLimits(&pid, i, -1.f, 1.f);
+    }
+    cbPeriodicInit(&timer, PI_INTERVAL_USEC * NSEC_PER_USEC / SPEEDUP, 0);
+    for (int i = 0; i < MAX_PERIODS; i++) {
+        // No syscalls here: the commands and the state go through memory
+        if (cbMailboxTake(&mb, &cmd)) {
+            state.command_id = cmd.id;
+            if (cmd.mode == CB_MAILBOX_STOP) break;
+            if (cmd.mode == CB_MAILBOX_SPEED) {
+                pid.setpoint[0] = CB_PID_FIX(cmd.left);
+                pid.setpoint[1] = CB_PID_FIX(cmd.right);
+            }
+        }
+        if (cmd.mode == CB_MAILBOX_SPEED) {
+            int32_t out_L = pid.output[0], out_R = pid.output[1];
+            cbDrivePairMove(&cbDrive, out_L < 0 ? backward : forward,
+                            CB_PID_FLOAT(abs(out_L)),
+                            out_R < 0 ? backward : forward,
+                            CB_PID_FLOAT(abs(out_R)));
+        } else if (cmd.mode == CB_MAILBOX_DUTY) {
+            cbDrivePairMove(&cbDrive, cmd.left < 0 ? backward : forward,
+                            cmd.left < 0 ? -cmd.left : cmd.left,
+                            cmd.right < 0 ? backward : forward,
+                            cmd.right < 0 ? -cmd.right : cmd.right);
+        }
+        cbSimStep(PI_INTERVAL_USEC);
+        meas[0] = measure(&speedLeft, &snapLeft, &cbEncoderLeft);
+        meas[1] = measure(&speedRight, &snapRight, &cbEncoderRight);
+        if (cmd.mode == CB_MAILBOX_SPEED) cbPidUpdate(&pid, meas);
+        cbOdoUpdate(&odo, &snapLeft, &snapRight);
+        cbOdoPose(&odo, &pose);
+        cbMailboxFill(&state, &snapLeft, &snapRight, &pose);
+        state.time_us = cbTimeNowUs();
+        state.health = cbPeriodicWait(&timer) ? CB_MAILBOX_LATE : 0;
+        if (snapLeft.illegal || snapRight.illegal) {
+            state.health |= CB_MAILBOX_ILLEGAL;
+        }
+        cbMailboxPublish(&mb, &state);
+    }
+    cbDrivePairReset(&cbDrive);
+    waitpid(child, &status, 0);
+    printf("controller: Stopped by command %u after %llu cycles, traveled "
+           "%.1fmm.\n", cmd.id, (unsigned long long)mb.shm->state.cycles,
+           (cbSimWheelTravelMm(&cbSimLeft) + cbSimWheelTravelMm(&cbSimRight)) /
+               2);
+    cbMailboxClose(&mb);
+    unlink(MAILBOX_PATH);
+    terminate();
+    exit(cmd.mode == CB_MAILBOX_STOP && WIFEXITED(status) &&
+                 WEXITSTATUS(status) == EXIT_SUCCESS
+             ? EXIT_SUCCESS
+             : EXIT_FAILURE);
+}
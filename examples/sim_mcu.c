@@ -0,0 +1,109 @@
+/**
+ * @file sim_mcu.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief The SPI link to the MCU of the shield, on the simulator.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * A simulated ATMega328P counts the encoder ticks while the link exchanges
+ * a frame with it every millisecond, some of them corrupted on the wire.
+ * Then the link falls silent long enough to trip the watchdog of the MCU,
+ * and finally a link on a channel with no MCU sees its own commands come
+ * back. The exit status is non-zero if the counts or the errors detected
+ * differ from the simulated ones, which makes it usable as a regression
+ * test.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../include/cbdef.h"
+#include "../include/hal.h"
+#include "../include/mcu.h"
+#include "../include/sim.h"
+#include "../include/timebase.h"
+
+#define PERIOD_US 1000
+#define PERIODS 2000
+#define DUTY_L .5f
+#define DUTY_R -.25f
+#define CORRUPT_EVERY 97 //< Statuses
+#define GARBLE_EVERY 89 //< Commands
+#define SIM_TOLERANCE_TICKS 2
+
+cbMcuLink_t cbLink = CB_MCU_LINK_INIT;
+cbSimMcu_t cbSimMcu;
+
+int main(void) {
+    cbHalSelect(&cbHalSim);
+    if (cbHal->init() != 0) exit(EXIT_FAILURE);
+    cbSimMcuInit(&cbSimMcu, CB_MCU_CHANNEL);
+    cbSimMcu.corrupt_every = CORRUPT_EVERY;
+    cbSimMcu.garble_every = GARBLE_EVERY;
+    cbSimAttachMcu(&cbSimMcu);
+    cbTimeInit();
+    if (cbMcuLinkOpen(&cbLink) != CB_SUCCESS) exit(EXIT_FAILURE);
+    int wrong = 0;
+    // The link would run on its own thread on the robot, see cbMcuLinkStart()
+    cbMcuLinkCommand(&cbLink, 0.f, 0.f, CB_MCU_CLEAR);
+    cbMcuLinkExchange(&cbLink);
+    for (int i = 0; i < PERIODS; i++) {
+        cbMcuLinkCommand(&cbLink, DUTY_L, DUTY_R, CB_MCU_ENABLE);
+        cbSimStep(PERIOD_US);
+        cbMcuLinkExchange(&cbLink);
+    }
+    cbMcuState_t state;
+    cbMcuLinkState(&cbLink, &state);
+    unsigned int crc_errors = atomic_load(&cbLink.crc_errors);
+    unsigned int ack_errors = atomic_load(&cbLink.ack_errors);
+    unsigned int lost = atomic_load(&cbLink.lost);
+    printf("%u transfers, %u statuses: ticks %lld/%lld (simulated %.0f/%.0f)\n",
+           atomic_load(&cbLink.transfers), state.frames,
+           (long long)state.ticks[0], (long long)state.ticks[1],
+           cbSimMcu.count[0], cbSimMcu.count[1]);
+    printf("%u corrupted statuses, %u lost, %u commands not acknowledged "
+           "(MCU: %u corrupted commands)\n",
+           crc_errors, lost, ack_errors, cbSimMcu.status.crc_errors);
+    for (int i = 0; i < 2; i++) {
+        double error = state.ticks[i] - cbSimMcu.count[i];
+        wrong += error > SIM_TOLERANCE_TICKS || error < -SIM_TOLERANCE_TICKS;
+    }
+    wrong += crc_errors != cbSimMcu.transfers / CORRUPT_EVERY || lost != 0;
+    wrong += ack_errors != cbSimMcu.status.crc_errors;
+    // Silence
+    cbSimStep(2 * CB_MCU_WATCHDOG_US);
+    cbMcuLinkExchange(&cbLink);
+    cbMcuLinkState(&cbLink, &state);
+    printf("After %dms of silence: %s\n", 2 * CB_MCU_WATCHDOG_US / 1000,
+           state.flags & CB_MCU_TIMEOUT ? "motors stopped by the watchdog"
+                                        : "motors still running");
+    wrong += !(state.flags & CB_MCU_TIMEOUT);
+    cbMcuLinkClose(&cbLink);
+    // Loopback
+    cbMcuLink_t loopback = CB_MCU_LINK_INIT;
+    loopback.channel = 1;
+    if (cbMcuLinkOpen(&loopback) != CB_SUCCESS) exit(EXIT_FAILURE);
+    int cc = cbMcuLinkExchange(&loopback);
+    printf("Loopback: %s\n", cc == CB_SUCCESS ? "status accepted"
+                                              : "own command rejected");
+    wrong += cc == CB_SUCCESS;
+    cbMcuLinkClose(&loopback);
+    cbTimeTerminate();
+    cbHal->terminate();
+    exit(wrong ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -0,0 +1,94 @@
+/**
+ * @file sim_sonar.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Ranging with the four sonars of the V5 shield, on the simulator.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * The four sonars share the trigger line and face obstacles at different
+ * distances, one of them out of range. The driver fires the trigger from a
+ * timer and times the echoes in their ISRs, while the main thread only reads
+ * the latest ranges. Halfway through, the obstacle in front of the first
+ * sonar moves closer. The exit status is non-zero if a range differs from
+ * the simulated one by more than SIM_TOLERANCE_MM, which makes it usable as
+ * a regression test.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../include/cbdef.h"
+#include "../include/hal.h"
+#include "../include/sim.h"
+#include "../include/sonar.h"
+
+#define SIM_TOLERANCE_MM 1.f
+#define SIM_PERIODS 20
+#define SIM_MOVED_MM 400.f //< New distance of the first obstacle
+
+cbSonar_t cbSonar = CB_SONAR_INIT_V5;
+cbSimSonar_t cbSimSonar[4];
+const float cbSimRangeMm[4] = {150.f, 800.f, 0.f, 2500.f};
+
+/**
+ * @brief Reads the ranges of all the sonars and compares them with the
+ *        simulated obstacles.
+ * @return The number of wrong ranges.
+ */
+int check(void) {
+    int wrong = 0;
+    for (unsigned int i = 0; i < cbSonar.count; i++) {
+        float range_mm = 0.f;
+        int cc = cbSonarRange(&cbSonar, i, &range_mm);
+        float expected = cbSimSonar[i].range_mm;
+        if (cc == CB_ERANGE) {
+            printf("Sonar %u: nothing in range\n", i + 1);
+            wrong += expected != 0.f;
+        } else if (cc == CB_SUCCESS) {
+            printf("Sonar %u: %.1fmm\n", i + 1, range_mm);
+            wrong += fabsf(range_mm - expected) > SIM_TOLERANCE_MM;
+        } else {
+            printf("Sonar %u: no reading\n", i + 1);
+            wrong++;
+        }
+    }
+    return wrong;
+}
+
+int main(void) {
+    cbHalSelect(&cbHalSim);
+    if (cbHal->init() != 0) exit(EXIT_FAILURE);
+    for (unsigned int i = 0; i < cbSonar.count; i++) {
+        cbSimSonarInit(&cbSimSonar[i], cbSonar.trigger, cbSonar.echo[i],
+                       cbSimRangeMm[i]);
+        if (cbSimAttachSonar(&cbSimSonar[i]) != CB_SUCCESS) {
+            exit(EXIT_FAILURE);
+        }
+    }
+    cbSonarGPIOinit(&cbSonar);
+    if (cbSonarStart(&cbSonar) != CB_SUCCESS) exit(EXIT_FAILURE);
+    cbSimStep(SIM_PERIODS / 2 * cbSonar.period_ms * 1000ULL);
+    int wrong = check();
+    cbSimSonar[0].range_mm = SIM_MOVED_MM;
+    cbSimStep(SIM_PERIODS / 2 * cbSonar.period_ms * 1000ULL);
+    wrong += check();
+    cbSonarStop(&cbSonar);
+    cbHal->terminate();
+    exit(wrong ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -0,0 +1,135 @@
+/**
+ * @file sim_stream.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Decoding an encoder from the notification pipe, on the simulator.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * The left wheel turns forward at full speed and its encoder is decoded
+ * twice: by the ISRs, and from the notification pipe by a stream. The stream
+ * is pumped every millisecond, except for STALL_MS in the middle, long
+ * enough for the pipe to fill up and drop reports like PiGPIO's does. The
+ * exit status is non-zero unless the stream accounts for every edge of the
+ * simulated wheel as either read or lost, in a single gap, and its ticks
+ * match those of the ISRs but for the edges lost in the gap, which makes it
+ * usable as a regression test.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../include/cbdef.h"
+#include "../include/encoder.h"
+#include "../include/hal.h"
+#include "../include/motor.h"
+#include "../include/sim.h"
+#include "../include/stream.h"
+
+#define STEP_MS 1 //< Period of the pumps
+#define RUN_MS 500 //< Pumping before and after the stall
+#define STALL_MS 2000 //< Not pumping, the pipe overflows
+
+cbMotor_t cbMotorLeft = CB_MOTOR_INIT(PIN_LEFT_FORWARD, PIN_LEFT_BACKWARD);
+cbEncoder_t cbEncoderISR = {.pin_a = PIN_ENCODER_LEFT_A,
+                            .pin_b = PIN_ENCODER_LEFT_B,
+                            .resolution = CB_ENCODER_X4};
+cbEncoder_t cbEncoderPipe = {.pin_a = PIN_ENCODER_LEFT_A,
+                             .pin_b = PIN_ENCODER_LEFT_B,
+                             .resolution = CB_ENCODER_X4};
+cbEncoderGroup_t cbGroup;
+cbEncoderStream_t cbStream;
+cbSimWheel_t cbSimLeft;
+
+/**
+ * @brief Advances the simulation, pumping the stream after every step until
+ *        the pipe is empty.
+ * @param ms The time to simulate.
+ * @param pump Whether to pump the stream.
+ */
+void run(unsigned int ms, bool pump) {
+    for (unsigned int t = 0; t < ms; t += STEP_MS) {
+        cbSimStep(STEP_MS * 1000ULL);
+        while (pump && cbEncoderStreamPump(&cbStream) > 0) {}
+    }
+}
+
+/**
+ * @brief The ticks an x4 decoder counts when it sees the Channels jump
+ *        forward by a number of edges at once: one edge forward looks
+ *        forward, three look like one backward, and two are an illegal
+ *        transition.
+ */
+int jumpTicks(uint64_t edges) {
+    static const int ticks[4] = {0, 1, 0, -1};
+    return ticks[edges % 4];
+}
+
+int main(void) {
+    cbEncoder_t* encs[] = {&cbEncoderPipe};
+    cbEncoderSnapshot_t isr, pipe;
+    int wrong = 0;
+    cbHalSelect(&cbHalSim);
+    if (cbHal->init() != 0) exit(EXIT_FAILURE);
+    cbSimWheelInit(&cbSimLeft, PIN_LEFT_FORWARD, PIN_LEFT_BACKWARD,
+                   PIN_ENCODER_LEFT_A, PIN_ENCODER_LEFT_B);
+    cbSimAttachWheel(&cbSimLeft);
+    cbMotorGPIOinit(&cbMotorLeft);
+    cbEncoderGPIOinit(&cbEncoderISR);
+    cbEncoderSync(&cbEncoderISR);
+    cbEncoderRegisterISRs(&cbEncoderISR, 0);
+    if (cbEncoderGroupInit(&cbGroup, encs, 1) != CB_SUCCESS ||
+        cbEncoderStreamOpen(&cbStream, &cbGroup) != CB_SUCCESS) {
+        exit(EXIT_FAILURE);
+    }
+    fcntl(cbStream.fd, F_SETFL, fcntl(cbStream.fd, F_GETFL) | O_NONBLOCK);
+    cbMotorMove(&cbMotorLeft, forward, 1.f);
+    // Before the stall, both paths see every edge
+    run(RUN_MS, true);
+    cbEncoderSnapshot(&cbEncoderISR, &isr);
+    cbEncoderSnapshot(&cbEncoderPipe, &pipe);
+    printf("Before: %lld edges, ISR %lld ticks, pipe %lld ticks, %llu lost\n",
+           (long long)cbSimLeft.edge, (long long)isr.ticks,
+           (long long)pipe.ticks, (unsigned long long)cbStream.lost);
+    wrong += pipe.ticks != isr.ticks || isr.ticks != cbSimLeft.edge ||
+             cbStream.lost != 0;
+    // The stall, then the reports left in the pipe and the new ones
+    run(STALL_MS, false);
+    run(RUN_MS, true);
+    cbMotorReset(&cbMotorLeft);
+    cbEncoderSnapshot(&cbEncoderISR, &isr);
+    cbEncoderSnapshot(&cbEncoderPipe, &pipe);
+    uint64_t lost = (uint64_t)cbSimLeft.edge - cbStream.reports;
+    // The first report after the gap is decoded as a jump over the lost edges
+    int64_t expected = isr.ticks - (int64_t)(lost + 1) + jumpTicks(lost + 1);
+    printf("After: %lld edges, %llu reports, %llu lost in %llu gaps\n",
+           (long long)cbSimLeft.edge, (unsigned long long)cbStream.reports,
+           (unsigned long long)cbStream.lost,
+           (unsigned long long)cbStream.gaps);
+    printf("After: ISR %lld ticks, pipe %lld ticks (expected %lld), "
+           "%u illegal\n",
+           (long long)isr.ticks, (long long)pipe.ticks, (long long)expected,
+           pipe.illegal);
+    wrong += lost == 0 || cbStream.lost != lost || cbStream.gaps != 1;
+    wrong += isr.ticks != cbSimLeft.edge || pipe.ticks != expected;
+    wrong += pipe.illegal != ((lost + 1) % 4 == 2);
+    cbEncoderStreamClose(&cbStream);
+    cbEncoderCancelISRs(&cbEncoderISR);
+    cbHal->terminate();
+    exit(wrong ? EXIT_FAILURE : EXIT_SUCCESS);
+}
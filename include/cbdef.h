@@ -31,6 +31,10 @@
 #define CB_ENOMODE 2 //< Condition code for when a mode cannot be inferred 
 #define CB_ERANGE 3 //< Condition code for when a variable is out of range
 
+// Platform Definitions ----------------------------------------------------- //
+
+#define CB_CACHELINE 64 //< Size of a cache line on the Cortex-A53 in bytes
+
 // GPIO Definitions --------------------------------------------------------- //
 
 #define GPIO_PIN_NC -1
@@ -81,8 +85,9 @@ typedef enum {
     // servo
     PIN_SERVO_1 = 19, // 9
     PIN_SERVO_2 = 26, // 10
-    
-    // sonar
+*/
+
+    // Sonars, sharing the trigger line
     PIN_SONAR_1_TRIGGER = 5, // 18
     PIN_SONAR_1_ECHO = 27, // 7
     PIN_SONAR_2_TRIGGER = 5, // 18
@@ -90,8 +95,7 @@ typedef enum {
     PIN_SONAR_3_TRIGGER = 5, // 18
     PIN_SONAR_3_ECHO = 12, // 23
     PIN_SONAR_4_TRIGGER = 5, // 18
-    PIN_SONAR_4_ECHO = 13, // 23 
-*/
+    PIN_SONAR_4_ECHO = 13, // 23
 
     /* J11 - Left Encoder Header
      * +-+-+-+-+
@@ -24,23 +24,122 @@
 #ifndef ENCODER_H
 #define ENCODER_H
 
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include "cbdef.h"
+#include "hal.h"
 
+/**
+ * The number of edges an Encoder's ring buffer can hold. Must be a power of 2.
+ */
+#define CB_ENCODER_RING_SIZE 256
+
+/**
+ * @brief An edge received from one of the Encoder's Channels.
+ */
+struct cbEncoderEdge {
+    uint64_t ts_us;  //< Timestamp of the edge, see cbTimeExtend().
+    uint8_t gpio;  //< The GPIO Pin that triggered the Interrupt.
+    uint8_t level;  //< The level of the Pin: 0, 1 or 2 on a watchdog timeout.
+};
+
+typedef struct cbEncoderEdge cbEncoderEdge_t;
+
+/**
+ * @brief A ring of edges with a single consumer, which drains them with
+ *        cbEncoderDrain(). The producers are the ISRs of both Channels, on
+ *        different threads: they take turns under the write lock of the
+ *        Encoder, so the ring sees one producer at a time. The indices live
+ *        on separate cache lines so the two sides never contend on the same
+ *        line.
+ */
+struct cbEncoderRing {
+    _Alignas(CB_CACHELINE) atomic_uint head;  //< Written by the producer.
+    atomic_uint dropped;  //< Edges lost because the ring was full.
+    _Alignas(CB_CACHELINE) atomic_uint tail;  //< Written by the consumer.
+    _Alignas(CB_CACHELINE) cbEncoderEdge_t edges[CB_ENCODER_RING_SIZE];
+};
+
+typedef struct cbEncoderRing cbEncoderRing_t;
+
+/**
+ * @brief The ticks counted per quadrature cycle, i.e. per 4 edges.
+ */
+typedef enum {
+    CB_ENCODER_X1 = 1,  //< One edge of Channel A.
+    CB_ENCODER_X2 = 2,  //< Both edges of Channel A.
+    CB_ENCODER_X4 = 4,  //< Both edges of both Channels.
+} cbEncoderRes_t;
+
+/**
+ * @brief Initializer for a cbEncoder_t at the default x2 resolution.
+ */
+#define CB_ENCODER_INIT(a, b) \
+    { .pin_a = (a), .pin_b = (b), .resolution = CB_ENCODER_X2 }
+
+/**
+ * @brief The state of an Encoder. The configuration and the state written on
+ *        every edge live on separate cache lines, and the structure is
+ *        aligned to a cache line, so that neither the readers of the
+ *        configuration nor the neighbouring Encoders share a line with the
+ *        thread running the ISRs. Heap-allocated Encoders must be obtained
+ *        with aligned_alloc().
+ */
 struct cbEncoder {
+    // Cold: set before registering the ISRs, read-only afterwards
     cbGPIO_t pin_a, pin_b;
-    cbGPIO_t last_gpio;
-    uint16_t level_a, level_b;
+    cbEncoderRes_t resolution;  //< 0 counts at the default x2.
+    void* custom;
+    cbEncoderRing_t* ring;  //< Optional ring fed with every edge.
+    // Hot: written on every edge
+    _Alignas(CB_CACHELINE) atomic_uint seq;  //< Odd while an ISR is writing.
+    uint8_t state;  //< Last levels of the Channels, A in bit 1 and B in bit 0.
     cbDir_t direction;
     int64_t ticks;
-    uint32_t bad_ticks;
-    void* custom;
+    uint32_t bad_ticks;  //< Edges that did not change the state.
+    uint32_t illegal;  //< Transitions that skipped a state, i.e. lost edges.
+    uint64_t last_edge_us;  //< Timestamp of the last counted edge.
 };
 
 typedef struct cbEncoder cbEncoder_t;
 
+/**
+ * @brief A consistent copy of the state of an Encoder.
+ */
+struct cbEncoderSnapshot {
+    int64_t ticks;
+    uint32_t bad_ticks;
+    uint32_t illegal;
+    cbDir_t direction;
+    uint64_t last_edge_us;
+};
+
+typedef struct cbEncoderSnapshot cbEncoderSnapshot_t;
+
+/**
+ * The maximum number of Encoders decoded by a single group.
+ */
+#define CB_ENCODER_GROUP_MAX 8
+
+/**
+ * @brief A set of Encoders decoded together from the samples of all their
+ *        pins, through a single callback instead of two ISRs per Encoder.
+ */
+struct cbEncoderGroup {
+    cbEncoder_t* enc[CB_ENCODER_GROUP_MAX];
+    unsigned int count;
+    uint32_t bits;  //< The pins of all the Encoders.
+    uint32_t levels;  //< The levels of the last sample.
+};
+
+typedef struct cbEncoderGroup cbEncoderGroup_t;
+
 void cbEncoderGPIOinit(const cbEncoder_t* enc);
+int cbEncoderSetResolution(cbEncoder_t* enc, cbEncoderRes_t resolution);
+void cbEncoderSync(cbEncoder_t* enc);
 void cbEncoderRegisterISRs(const cbEncoder_t* enc, int timeout);
 void cbEncoderRegisterCustomISRs(const cbEncoder_t* enc, unsigned int edge_a,
                                  void (*isr_a)(int, int, uint32_t, void*),
@@ -48,5 +147,19 @@ void cbEncoderRegisterCustomISRs(const cbEncoder_t* enc, unsigned int edge_a,
                                  void (*isr_b)(int, int, uint32_t, void*),
                                  int timeout);
 void cbEncoderCancelISRs(const cbEncoder_t* enc);
+void cbEncoderISRa(int gpio, int level, uint32_t event_ts_us, void* enc_gen);
+void cbEncoderISRb(int gpio, int level, uint32_t event_ts_us, void* enc_gen);
+void cbEncoderSamples(const cbHalSample_t* samples, int count,
+                      void* group_gen);
+int cbEncoderGroupInit(cbEncoderGroup_t* group, cbEncoder_t* const* encs,
+                       unsigned int count);
+void cbEncoderGroupSync(cbEncoderGroup_t* group);
+bool cbEncoderGroupPoll(cbEncoderGroup_t* group);
+int cbEncoderGroupRegister(cbEncoderGroup_t* group);
+void cbEncoderGroupCancel(const cbEncoderGroup_t* group);
+void cbEncoderSnapshot(const cbEncoder_t* enc, cbEncoderSnapshot_t* snap);
+void cbEncoderAttachRing(cbEncoder_t* enc, cbEncoderRing_t* ring);
+size_t cbEncoderDrain(cbEncoder_t* enc, const cbEncoderEdge_t** batch);
+void cbEncoderRelease(cbEncoder_t* enc, size_t count);
 
 #endif  // ENCODER_H
@@ -0,0 +1,162 @@
+/**
+ * @file hal.h
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdint.h>
+
+// Pin Modes and Pulls ------------------------------------------------------ //
+
+/* The values match both PiGPIO's and the BCM2837's function select and pull
+ * registers, so they can be passed through by every backend.
+ */
+#define CB_GPIO_INPUT 0
+#define CB_GPIO_OUTPUT 1
+#define CB_GPIO_PUD_OFF 0
+#define CB_GPIO_PUD_DOWN 1
+#define CB_GPIO_PUD_UP 2
+
+#define CB_EDGE_RISING 0
+#define CB_EDGE_FALLING 1
+#define CB_EDGE_EITHER 2
+
+#define CB_LEVEL_TIMEOUT 2 //< Level passed to an ISR on a watchdog timeout
+
+/**
+ * @brief An Interrupt Service Routine, called with the pin, its new level,
+ *        the 32-bit microsecond tick of the edge and the user data.
+ */
+typedef void (*cbHalISR_t)(int gpio, int level, uint32_t tick, void* userdata);
+
+/**
+ * @brief A sample of the levels of GPIO 0-31, as taken by the backend when
+ *        one of the monitored pins changed. Same layout as PiGPIO's.
+ */
+struct cbHalSample {
+    uint32_t tick;  //< Microseconds, as returned by tick().
+    uint32_t level;  //< Levels of GPIO 0-31 as a bitmask.
+};
+
+typedef struct cbHalSample cbHalSample_t;
+
+/**
+ * @brief A callback receiving a batch of samples, in chronological order, and
+ *        the user data.
+ */
+typedef void (*cbHalSamples_t)(const cbHalSample_t* samples, int count,
+                               void* userdata);
+
+/**
+ * @brief A report read from a notification pipe: the levels of GPIO 0-31
+ *        after a change of one of the monitored pins. Same layout as PiGPIO's.
+ */
+struct cbHalReport {
+    uint16_t seqno;  //< Incremented for every report, including lost ones.
+    uint16_t flags;  //< CB_REPORT_* flags, 0 for a change of the levels.
+    uint32_t tick;  //< Microseconds, as returned by tick().
+    uint32_t level;  //< Levels of GPIO 0-31 as a bitmask.
+};
+
+typedef struct cbHalReport cbHalReport_t;
+
+#define CB_REPORT_WDOG (1 << 5) //< Watchdog timeout, levels not sampled
+#define CB_REPORT_ALIVE (1 << 6) //< Keep-alive, levels not sampled
+#define CB_REPORT_EVENT (1 << 7) //< Event, levels not sampled
+
+/**
+ * @brief A timer callback, called with the user data.
+ */
+typedef void (*cbHalTimer_t)(void* userdata);
+
+// Hardware Abstraction Layer ----------------------------------------------- //
+
+/**
+ * @brief A backend for the hardware operations used by the library. Every
+ *        operation returns 0 on success and a negative value on failure,
+ *        except for the reads which return the level(s) and the getters.
+ *        The operations mirror the semantics of their PiGPIO counterparts,
+ *        except for i2c_read_block() which, unlike i2cReadI2CBlockData(), is
+ *        not limited to 32 bytes and returns the number of bytes read.
+ */
+struct cbHal {
+    const char* name;
+    int (*init)(void);
+    void (*terminate)(void);
+    int (*set_mode)(unsigned int gpio, unsigned int mode);
+    int (*set_pull)(unsigned int gpio, unsigned int pud);
+    int (*read)(unsigned int gpio);
+    int (*write)(unsigned int gpio, unsigned int level);
+    int (*trigger)(unsigned int gpio, unsigned int pulse_us,
+                   unsigned int level);  //< Pulses an output for pulse_us.
+    uint32_t (*read_bank)(void);  //< Levels of GPIO 0-31 as a bitmask.
+    int (*set_bank)(uint32_t bits);  //< Sets the GPIOs in the bitmask.
+    int (*clear_bank)(uint32_t bits);  //< Clears the GPIOs in the bitmask.
+    int (*pwm)(unsigned int gpio, unsigned int duty);
+    int (*set_pwm_range)(unsigned int gpio, unsigned int range);
+    int (*set_pwm_freq)(unsigned int gpio, unsigned int freq);
+    int (*get_pwm_real_range)(unsigned int gpio);
+    int (*hw_pwm)(unsigned int gpio, unsigned int freq, uint32_t duty);
+    int (*set_isr)(unsigned int gpio, unsigned int edge, int timeout,
+                   cbHalISR_t isr, void* userdata);
+    int (*set_samples)(uint32_t bits, cbHalSamples_t func,
+                       void* userdata);  //< One callback for many pins.
+    int (*open_notify)(uint32_t bits);  //< Returns an fd to read reports.
+    int (*close_notify)(int fd);
+    uint32_t (*tick)(void);  //< Microseconds, wraps every ~72 minutes.
+    int (*set_timer)(unsigned int timer, unsigned int millis,
+                     cbHalTimer_t func, void* userdata);
+    int (*i2c_open)(unsigned int bus, unsigned int addr);  //< Returns a handle.
+    int (*i2c_close)(unsigned int handle);
+    int (*i2c_read_byte)(unsigned int handle, unsigned int reg);
+    int (*i2c_write_byte)(unsigned int handle, unsigned int reg,
+                          unsigned int value);
+    int (*i2c_read_block)(unsigned int handle, unsigned int reg, uint8_t* buf,
+                          unsigned int count);  //< Any count, one burst.
+    int (*spi_open)(unsigned int channel, unsigned int baud);  //< A handle.
+    int (*spi_close)(unsigned int handle);
+    int (*spi_xfer)(unsigned int handle, const uint8_t* tx, uint8_t* rx,
+                    unsigned int count);  //< Full duplex.
+};
+
+typedef struct cbHal cbHal_t;
+
+extern const cbHal_t* cbHal;  //< The backend in use.
+
+#ifndef CB_NO_PIGPIO
+extern const cbHal_t cbHalPigpio;
+#endif
+extern const cbHal_t cbHalGpiomem;
+extern const cbHal_t cbHalSim;
+
+void cbHalSelect(const cbHal_t* hal);
+
+// Memory-mapped GPIO backend ----------------------------------------------- //
+
+#define CB_GPIOMEM_PATH "/dev/gpiomem"
+#define CB_GPIOMEM_SIZE 4096
+
+int cbGpiomemOpen(const char* path);
+void cbGpiomemClose(void);
+
+#endif  // HAL_H
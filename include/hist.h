@@ -0,0 +1,102 @@
+/**
+ * @file hist.h
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef HIST_H
+#define HIST_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+/**
+ * Each power of two is split in 2^CB_HIST_SUB_BITS buckets, so a value is
+ * known within 25% of its magnitude.
+ */
+#define CB_HIST_SUB_BITS 2
+#define CB_HIST_SUB (1 << CB_HIST_SUB_BITS)
+/**
+ * Number of buckets: values up to 2^40 (~18 minutes in ns) are told apart,
+ * larger ones all end up in the last bucket.
+ */
+#define CB_HIST_BUCKETS ((40 - CB_HIST_SUB_BITS + 1) * CB_HIST_SUB)
+
+/**
+ * @brief A histogram with fixed log-linear buckets. It has a single writer,
+ *        which updates it without atomic read-modify-write operations or
+ *        locks, and any number of readers. It contains no pointers, so it can
+ *        be placed in memory shared with another process.
+ */
+struct cbHist {
+    atomic_uint_fast64_t count, sum, max;
+    atomic_uint_fast64_t bucket[CB_HIST_BUCKETS];
+};
+
+typedef struct cbHist cbHist_t;
+
+/**
+ * @brief A summary of a histogram. The percentiles are the upper bound of the
+ *        bucket they fall in, capped at the maximum.
+ */
+struct cbHistSummary {
+    uint64_t count, mean, p50, p90, p99, max;
+};
+
+typedef struct cbHistSummary cbHistSummary_t;
+
+/**
+ * @brief Returns the bucket a value falls in.
+ */
+static inline unsigned int cbHistIndex(uint64_t value) {
+    if (value < CB_HIST_SUB) return (unsigned int)value;
+    unsigned int exp = 63 - (unsigned int)__builtin_clzll(value);
+    unsigned int sub = (value >> (exp - CB_HIST_SUB_BITS)) & (CB_HIST_SUB - 1);
+    unsigned int index = (exp - CB_HIST_SUB_BITS + 1) * CB_HIST_SUB + sub;
+    return index < CB_HIST_BUCKETS ? index : CB_HIST_BUCKETS - 1;
+}
+
+static inline void cbHistBump(atomic_uint_fast64_t* counter, uint64_t by) {
+    uint64_t value = atomic_load_explicit(counter, memory_order_relaxed);
+    atomic_store_explicit(counter, value + by, memory_order_relaxed);
+}
+
+/**
+ * @brief Records a value. Wait-free, must only be called by the writer.
+ * @param hist A pointer to the histogram.
+ * @param value The value, e.g. a duration in ns.
+ */
+static inline void cbHistRecord(cbHist_t* hist, uint64_t value) {
+    cbHistBump(&hist->bucket[cbHistIndex(value)], 1);
+    cbHistBump(&hist->sum, value);
+    if (value > atomic_load_explicit(&hist->max, memory_order_relaxed)) {
+        atomic_store_explicit(&hist->max, value, memory_order_relaxed);
+    }
+    // Last, so a reader never counts more samples than are in the buckets
+    uint64_t count = atomic_load_explicit(&hist->count, memory_order_relaxed);
+    atomic_store_explicit(&hist->count, count + 1, memory_order_release);
+}
+
+void cbHistInit(cbHist_t* hist);
+uint64_t cbHistBucketLimit(unsigned int index);
+uint64_t cbHistPercentile(const cbHist_t* hist, double percent);
+void cbHistSummarize(const cbHist_t* hist, cbHistSummary_t* summary);
+
+#endif  // HIST_H
@@ -0,0 +1,171 @@
+/**
+ * @file imu.h
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMU_H
+#define IMU_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cbdef.h"
+
+#define CB_IMU_BUS 1 //< The I2C bus of the 40-pin header.
+#define CB_IMU_ADDR 0x6B //< Accelerometer and gyroscope, SDO_A/G high.
+#define CB_IMU_ID 0x68 //< Value of WHO_AM_I.
+
+/* STMicroelectronics LSM9DS1 accelerometer and gyroscope registers. See
+ * section 7 of the datasheet.
+ */
+#define CB_LSM9DS1_WHO_AM_I 0x0F
+#define CB_LSM9DS1_CTRL_REG1_G 0x10 //< ODR_G[7:5], FS_G[4:3]
+#define CB_LSM9DS1_OUT_X_L_G 0x18 //< Gyroscope X, Y, Z, little endian
+#define CB_LSM9DS1_CTRL_REG6_XL 0x20 //< ODR_XL[7:5], FS_XL[4:3]
+#define CB_LSM9DS1_CTRL_REG8 0x22
+#define CB_LSM9DS1_CTRL_REG9 0x23
+#define CB_LSM9DS1_OUT_X_L_XL 0x28 //< Accelerometer X, Y, Z, little endian
+#define CB_LSM9DS1_OUT_Z_H_XL 0x2D
+#define CB_LSM9DS1_FIFO_CTRL 0x2E //< FMODE[7:5], FTH[4:0]
+#define CB_LSM9DS1_FIFO_SRC 0x2F //< FTH[7], OVRN[6], FSS[5:0]
+
+#define CB_LSM9DS1_BDU 0x40 //< CTRL_REG8, block data update
+#define CB_LSM9DS1_IF_ADD_INC 0x04 //< CTRL_REG8, auto-increment
+#define CB_LSM9DS1_FIFO_EN 0x02 //< CTRL_REG9
+#define CB_LSM9DS1_FMODE_BYPASS 0x00 //< FIFO_CTRL, also empties the FIFO
+#define CB_LSM9DS1_FMODE_CONT 0xC0 //< FIFO_CTRL, overwrites when full
+#define CB_LSM9DS1_OVRN 0x40 //< FIFO_SRC
+#define CB_LSM9DS1_FSS 0x3F //< FIFO_SRC
+
+/**
+ * The depth of the FIFO of the LSM9DS1 and the size of each of its slots,
+ * holding one sample of the gyroscope and one of the accelerometer. With the
+ * FIFO enabled, a burst read from OUT_X_L_G jumps from the gyroscope to the
+ * accelerometer and rolls back from OUT_Z_H_XL to the next slot, so the
+ * whole FIFO can be drained in one burst.
+ */
+#define CB_IMU_FIFO_SLOTS 32
+#define CB_IMU_SLOT_SIZE 12
+
+/**
+ * The number of samples the ring of an IMU can hold. Must be a power of 2.
+ */
+#define CB_IMU_RING_SIZE 256
+
+/**
+ * @brief The output data rate of the gyroscope, which the accelerometer
+ *        follows. Values of ODR_G.
+ */
+typedef enum {
+    CB_IMU_ODR_15HZ = 1,  //< 14.9Hz
+    CB_IMU_ODR_60HZ = 2,  //< 59.5Hz
+    CB_IMU_ODR_119HZ = 3,
+    CB_IMU_ODR_238HZ = 4,
+    CB_IMU_ODR_476HZ = 5,
+    CB_IMU_ODR_952HZ = 6,
+} cbImuOdr_t;
+
+/**
+ * @brief The full scale of the gyroscope. Values of FS_G.
+ */
+typedef enum {
+    CB_IMU_GYRO_245DPS = 0,
+    CB_IMU_GYRO_500DPS = 1,
+    CB_IMU_GYRO_2000DPS = 3,
+} cbImuGyroFs_t;
+
+/**
+ * @brief The full scale of the accelerometer. Values of FS_XL.
+ */
+typedef enum {
+    CB_IMU_ACCEL_2G = 0,
+    CB_IMU_ACCEL_16G = 1,
+    CB_IMU_ACCEL_4G = 2,
+    CB_IMU_ACCEL_8G = 3,
+} cbImuAccelFs_t;
+
+/**
+ * @brief A sample of the IMU, in LSBs. Multiply by gyro_dps and accel_g of
+ *        the cbImu_t to get deg/s and g.
+ */
+struct cbImuSample {
+    uint64_t ts_us;  //< Estimated time of the sample, see cbTimeNowUs().
+    int16_t gyro[3];  //< X, Y, Z.
+    int16_t accel[3];  //< X, Y, Z.
+};
+
+typedef struct cbImuSample cbImuSample_t;
+
+/**
+ * @brief A single-producer/single-consumer ring of samples, filled by
+ *        cbImuPoll() and drained with cbImuDrain(), like cbEncoderRing_t.
+ */
+struct cbImuRing {
+    _Alignas(CB_CACHELINE) atomic_uint head;  //< Written by the producer.
+    atomic_uint dropped;  //< Samples lost because the ring was full.
+    _Alignas(CB_CACHELINE) atomic_uint tail;  //< Written by the consumer.
+    _Alignas(CB_CACHELINE) cbImuSample_t samples[CB_IMU_RING_SIZE];
+};
+
+typedef struct cbImuRing cbImuRing_t;
+
+/**
+ * @brief Initializer for a cbImu_t with the LSM9DS1 of the CoderBot V5, at
+ *        238Hz, 500deg/s and 4g.
+ */
+#define CB_IMU_INIT                                                \
+    {                                                              \
+        .bus = CB_IMU_BUS, .addr = CB_IMU_ADDR,                    \
+        .odr = CB_IMU_ODR_238HZ, .gyro_fs = CB_IMU_GYRO_500DPS,    \
+        .accel_fs = CB_IMU_ACCEL_4G                                \
+    }
+
+/**
+ * @brief The accelerometer and gyroscope of an LSM9DS1. The structure is
+ *        aligned to a cache line because of its ring: heap-allocated IMUs
+ *        must be obtained with aligned_alloc().
+ */
+struct cbImu {
+    // Set before cbImuOpen()
+    unsigned int bus, addr;
+    cbImuOdr_t odr;
+    cbImuGyroFs_t gyro_fs;
+    cbImuAccelFs_t accel_fs;
+    // Set by cbImuOpen()
+    int handle;
+    uint32_t period_us;  //< Nominal time between samples.
+    float gyro_dps, accel_g;  //< Sensitivities, per LSB.
+    // Updated by cbImuPoll()
+    uint32_t overruns;  //< Polls that found the FIFO overrun.
+    uint32_t transfers;  //< I2C operations, two per poll with samples.
+    cbImuRing_t ring;
+};
+
+typedef struct cbImu cbImu_t;
+
+int cbImuOpen(cbImu_t* imu);
+void cbImuClose(cbImu_t* imu);
+int cbImuPoll(cbImu_t* imu);
+size_t cbImuDrain(cbImu_t* imu, const cbImuSample_t** batch);
+void cbImuRelease(cbImu_t* imu, size_t count);
+
+#endif  // IMU_H
@@ -0,0 +1,147 @@
+/**
+ * @file mailbox.h
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "encoder.h"
+#include "odometry.h"
+
+/**
+ * The default mailbox, a POSIX shared memory object: other processes can
+ * open it with shm_open("/coderbot"), or e.g. with Python's
+ * multiprocessing.shared_memory.SharedMemory("coderbot").
+ */
+#define CB_MAILBOX_PATH "/dev/shm/coderbot"
+#define CB_MAILBOX_MAGIC "cbmbox"
+#define CB_MAILBOX_VERSION 2
+
+/**
+ * Number of command slots. Every process posting commands owns one, so a
+ * poster never waits for another one, nor leaves it stuck if it dies while
+ * posting.
+ */
+#define CB_MAILBOX_SLOTS 4
+
+/**
+ * Drive modes of a command.
+ */
+#define CB_MAILBOX_STOP 0  //< Stop both motors.
+#define CB_MAILBOX_DUTY 1  //< Signed duty cycles, in [-1, 1].
+#define CB_MAILBOX_SPEED 2  //< Signed wheel speeds, in mm/s.
+
+/**
+ * Health flags of the controller, set in cbMailboxState_t.health.
+ */
+#define CB_MAILBOX_STALL (1u << 0)  //< A motor is stalled.
+#define CB_MAILBOX_LATE (1u << 1)  //< The loop missed a period.
+#define CB_MAILBOX_ILLEGAL (1u << 2)  //< An encoder lost edges.
+
+/**
+ * @brief A drive command, posted by the front-end.
+ */
+struct cbMailboxCommand {
+    uint32_t id;  //< Set by cbMailboxPost(), see cbMailboxPost().
+    uint32_t mode;  //< One of CB_MAILBOX_STOP, _DUTY and _SPEED.
+    float left, right;  //< The setpoints of the wheels.
+    uint32_t pad;
+    uint64_t stamp_ns;  //< CLOCK_MONOTONIC when posted.
+};
+
+typedef struct cbMailboxCommand cbMailboxCommand_t;
+
+/**
+ * @brief The state published by the controller.
+ */
+struct cbMailboxState {
+    uint64_t time_us;  //< When published, in the time base of timebase.h.
+    uint64_t cycles;  //< Number of publications, a heartbeat.
+    int64_t ticks_l, ticks_r;
+    uint32_t illegal_l, illegal_r;
+    int64_t x_nm, y_nm;
+    uint32_t theta;  //< Heading in BAM.
+    uint32_t health;  //< CB_MAILBOX_* flags, 0 when healthy.
+    uint32_t command_id;  //< The last command applied.
+    uint32_t pad;
+};
+
+typedef struct cbMailboxState cbMailboxState_t;
+
+/**
+ * @brief A command slot, written only by the process that owns it.
+ */
+struct cbMailboxSlot {
+    _Alignas(64) atomic_uint seq;
+    cbMailboxCommand_t cmd;
+};
+
+/**
+ * @brief The layout of the shared memory. Each command slot and the state
+ *        have their own cache line and sequence counter, odd while written
+ *        by their only writer: a reader retries, or gives up, when it sees
+ *        the counter odd or changed, so no reader can make a writer wait.
+ *        The counters are only loaded and stored, never exchanged, so any
+ *        language that can map the fixed layout can take part.
+ */
+struct cbMailboxShared {
+    char magic[8];
+    atomic_uint version;  //< Written last by cbMailboxCreate().
+    uint32_t size;  //< sizeof(cbMailboxShared_t)
+    struct cbMailboxSlot slot[CB_MAILBOX_SLOTS];
+    _Alignas(64) atomic_uint state_seq;
+    cbMailboxState_t state;
+};
+
+typedef struct cbMailboxShared cbMailboxShared_t;
+
+_Static_assert(sizeof(cbMailboxCommand_t) == 32, "Fixed layout");
+_Static_assert(sizeof(cbMailboxState_t) == 72, "Fixed layout");
+
+/**
+ * @brief A mailbox mapped by this process.
+ */
+struct cbMailbox {
+    cbMailboxShared_t* shm;
+    unsigned int slot;  //< The slot posted to by cbMailboxPost().
+    uint32_t taken[CB_MAILBOX_SLOTS];  //< Last ids seen by cbMailboxTake().
+};
+
+typedef struct cbMailbox cbMailbox_t;
+
+int cbMailboxCreate(cbMailbox_t* mb, const char* path);
+int cbMailboxAttach(cbMailbox_t* mb, const char* path, unsigned int slot);
+void cbMailboxClose(cbMailbox_t* mb);
+uint32_t cbMailboxPost(cbMailbox_t* mb, uint32_t mode, float left,
+                       float right);
+bool cbMailboxTake(cbMailbox_t* mb, cbMailboxCommand_t* cmd);
+void cbMailboxPublish(cbMailbox_t* mb, const cbMailboxState_t* state);
+void cbMailboxRead(const cbMailbox_t* mb, cbMailboxState_t* state);
+void cbMailboxFill(cbMailboxState_t* state,
+                   const cbEncoderSnapshot_t* snap_l,
+                   const cbEncoderSnapshot_t* snap_r, const cbPose_t* pose);
+
+#endif  // MAILBOX_H
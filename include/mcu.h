@@ -0,0 +1,152 @@
+/**
+ * @file mcu.h
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MCU_H
+#define MCU_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cbdef.h"
+
+#define CB_MCU_CHANNEL 0 //< The ATMega328P is on SPI0 CE0.
+#define CB_MCU_BAUD 1000000 //< 16 bytes take 128us.
+#define CB_MCU_PERIOD_NS 1000000ULL //< Default period of the link, 1kHz.
+
+/* The frames exchanged with the MCU. Every transfer is full duplex and
+ * shifts a command in while a status goes out, so the status of a transfer
+ * is prepared by the MCU when the transfer starts: its ack field refers to
+ * the command of the previous transfer. Multi-byte fields are little endian
+ * and the last two bytes are a CRC-16/CCITT-FALSE of the others.
+ *
+ * Command: magic, seq, flags, 0, duty_l (Q15), duty_r (Q15), 6 x 0, CRC
+ * Status:  magic, seq, ack, flags, count_l (32), count_r (32), crc_errors,
+ *          CRC
+ */
+#define CB_MCU_FRAME_SIZE 16
+#define CB_MCU_COMMAND_MAGIC 0xC5
+#define CB_MCU_STATUS_MAGIC 0x5C
+
+#define CB_MCU_ENABLE 0x01 //< Command: drive the motors.
+#define CB_MCU_CLEAR 0x02 //< Command: zero the encoder counts.
+#define CB_MCU_BAD_CRC 0x01 //< Status: the last command was corrupted.
+#define CB_MCU_TIMEOUT 0x02 //< Status: motors stopped, no recent command.
+#define CB_MCU_WATCHDOG_US 100000 //< The MCU stops after this long silent.
+
+/**
+ * @brief A command to the MCU.
+ */
+struct cbMcuCommand {
+    uint8_t seq;  //< Incremented by the link for every transfer.
+    uint8_t flags;  //< CB_MCU_ENABLE, CB_MCU_CLEAR.
+    int16_t duty[2];  //< Left and right, Q15, negative backwards.
+};
+
+typedef struct cbMcuCommand cbMcuCommand_t;
+
+/**
+ * @brief A status of the MCU.
+ */
+struct cbMcuStatus {
+    uint8_t seq;  //< Incremented by the MCU for every transfer.
+    uint8_t ack;  //< Sequence number of the last valid command.
+    uint8_t flags;  //< CB_MCU_BAD_CRC, CB_MCU_TIMEOUT.
+    uint16_t crc_errors;  //< Corrupted commands received by the MCU.
+    int32_t count[2];  //< Left and right Encoder counts, wrapping.
+};
+
+typedef struct cbMcuStatus cbMcuStatus_t;
+
+/**
+ * @brief The state of the MCU as last received by the link.
+ */
+struct cbMcuState {
+    int64_t ticks[2];  //< The Encoder counts, extended to 64 bits.
+    uint64_t time_us;  //< When the status was received, see cbTimeNowUs().
+    uint32_t frames;  //< Valid statuses received.
+    uint8_t flags;  //< Of the last status.
+};
+
+typedef struct cbMcuState cbMcuState_t;
+
+/**
+ * @brief Initializer for a cbMcuLink_t with the MCU of the CoderBot V5.
+ */
+#define CB_MCU_LINK_INIT                                             \
+    {                                                                \
+        .channel = CB_MCU_CHANNEL, .baud = CB_MCU_BAUD,              \
+        .period_ns = CB_MCU_PERIOD_NS, .cpu = -1                     \
+    }
+
+/**
+ * @brief A link to the MCU. The control loop posts commands and reads the
+ *        state through two double buffers, each with a sequence number that
+ *        tells the reader which half is current: the writer never waits and
+ *        the reader only retries if a new value was published while it was
+ *        copying. The transfers are run by cbMcuLinkExchange(), from the
+ *        link's thread or from the caller's, so the control loop never waits
+ *        on the bus.
+ */
+struct cbMcuLink {
+    // Cold: set before cbMcuLinkOpen(), read-only afterwards
+    unsigned int channel, baud;
+    uint64_t period_ns;  //< Period of the link's thread.
+    int cpu;  //< The CPU the thread is pinned to, -1 to leave it free.
+    int handle;
+    pthread_t tid;
+    atomic_bool stop;
+    // Written by the control loop
+    _Alignas(CB_CACHELINE) atomic_uint command_seq;
+    cbMcuCommand_t command[2];
+    // Written by the link
+    _Alignas(CB_CACHELINE) atomic_uint state_seq;
+    cbMcuState_t state[2];
+    uint8_t seq;  //< Of the next command.
+    uint8_t status_seq;  //< Of the last status, valid or corrupted.
+    bool synced;  //< A valid status has been received.
+    int32_t count[2];  //< Of the last valid status.
+    atomic_uint transfers;
+    atomic_uint crc_errors;  //< Statuses with a bad magic or CRC.
+    atomic_uint ack_errors;  //< Commands the MCU did not acknowledge.
+    atomic_uint lost;  //< Statuses missed, not counting the corrupted.
+};
+
+typedef struct cbMcuLink cbMcuLink_t;
+
+uint16_t cbMcuCrc16(const uint8_t* data, unsigned int length);
+void cbMcuPackCommand(const cbMcuCommand_t* cmd, uint8_t* frame);
+int cbMcuUnpackCommand(const uint8_t* frame, cbMcuCommand_t* cmd);
+void cbMcuPackStatus(const cbMcuStatus_t* status, uint8_t* frame);
+int cbMcuUnpackStatus(const uint8_t* frame, cbMcuStatus_t* status);
+int cbMcuLinkOpen(cbMcuLink_t* link);
+void cbMcuLinkClose(cbMcuLink_t* link);
+void cbMcuLinkCommand(cbMcuLink_t* link, float duty_l, float duty_r,
+                      uint8_t flags);
+void cbMcuLinkState(const cbMcuLink_t* link, cbMcuState_t* state);
+int cbMcuLinkExchange(cbMcuLink_t* link);
+int cbMcuLinkStart(cbMcuLink_t* link);
+int cbMcuLinkStop(cbMcuLink_t* link);
+
+#endif  // MCU_H
@@ -28,15 +28,55 @@
 
 #include <stdbool.h>
 
+/**
+ * @brief The way the PWM signal of a motor is generated.
+ */
+typedef enum {
+    CB_PWM_SOFT = 0, //< PiGPIO's DMA-timed soft PWM on both pins.
+    CB_PWM_AUTO = 1 //< Hardware PWM on the pins that support it and whose
+                    //  channel is free, soft PWM on the others.
+} cbPwmMode_t;
+
 struct cbMotor {
     cbGPIO_t pin_fw, pin_bw;
     cbDir_t direction;
+    cbPwmMode_t pwm_mode;
+    unsigned int pwm_freq; //< PWM frequency in Hz, 0 for the default.
+    unsigned int pwm_range; //< Soft PWM range, 0 for the default.
+    bool hw_fw, hw_bw; //< Whether a pin is driven by hardware PWM.
+    unsigned int steps_fw, steps_bw; //< Real number of duty cycle steps.
 };
 
 typedef struct cbMotor cbMotor_t;
 
-void cbMotorGPIOinit(const cbMotor_t* motor);
+/**
+ * @brief Initializer for a cbMotor_t spinning forward with the default PWM.
+ */
+#define CB_MOTOR_INIT(fw, bw) \
+    { .pin_fw = (fw), .pin_bw = (bw), .direction = forward }
+
+/**
+ * @brief A pair of motors driven together, e.g. the two wheels. The outputs
+ *        currently applied to the four pins are shadowed so that commands
+ *        which do not change anything cost no GPIO calls.
+ */
+struct cbDrivePair {
+    cbMotor_t* left;
+    cbMotor_t* right;
+    unsigned int duty[4]; //< Raw duty cycle applied to each pin, 0 if low.
+};
+
+typedef struct cbDrivePair cbDrivePair_t;
+
+void cbMotorGPIOinit(cbMotor_t* motor);
 int cbMotorMove(cbMotor_t* motor, cbDir_t direction, float duty_cycle);
 void cbMotorReset(cbMotor_t* motor);
+unsigned int cbMotorResolution(const cbMotor_t* motor, cbDir_t direction);
+float cbMotorQuantize(const cbMotor_t* motor, cbDir_t direction,
+                      float duty_cycle);
+int cbDrivePairInit(cbDrivePair_t* pair, cbMotor_t* left, cbMotor_t* right);
+int cbDrivePairMove(cbDrivePair_t* pair, cbDir_t dir_left, float duty_left,
+                    cbDir_t dir_right, float duty_right);
+void cbDrivePairReset(cbDrivePair_t* pair);
 
 #endif // MOTOR_H
@@ -0,0 +1,77 @@
+/**
+ * @file odometry.h
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef ODOMETRY_H
+#define ODOMETRY_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "encoder.h"
+
+/**
+ * Angles are Binary Angular Measurements: the full turn is 2^32, so they wrap
+ * around for free. CB_ODO_BAM_QUARTER is 90 degrees.
+ */
+#define CB_ODO_BAM_QUARTER 0x40000000u
+
+/**
+ * @brief The pose of the robot. The x axis points where the robot faced when
+ *        the pose was zero, angles grow counterclockwise.
+ */
+struct cbPose {
+    int64_t x_nm, y_nm;
+    uint32_t theta;  //< Heading in BAM.
+};
+
+typedef struct cbPose cbPose_t;
+
+/**
+ * @brief A differential-drive odometry engine. It is updated by a single
+ *        thread and its pose can be read by any other without locking.
+ */
+struct cbOdometry {
+    int64_t nm_per_tick_l, nm_per_tick_r;  //< Q16.
+    int64_t rem_l, rem_r;  //< Fractions of nm not integrated yet, Q16.
+    int64_t bam_per_nm;  //< Q32, heading change per nm of wheel difference.
+    int64_t ticks_l, ticks_r;  //< Last ticks seen by cbOdoUpdate().
+    bool primed;  //< Whether ticks_l and ticks_r are valid.
+    cbPose_t pose;
+    atomic_uint seq;  //< Sequence counter, odd while the pose is written.
+};
+
+typedef struct cbOdometry cbOdometry_t;
+
+double cbOdoMmPerTick(double wheel_radius_mm, unsigned int ticks_per_rev,
+                      double gear_ratio);
+void cbOdoInit(cbOdometry_t* odo, double mm_per_tick_l, double mm_per_tick_r,
+               double track_mm);
+void cbOdoSetPose(cbOdometry_t* odo, const cbPose_t* pose);
+void cbOdoIntegrate(cbOdometry_t* odo, int32_t ticks_l, int32_t ticks_r);
+void cbOdoUpdate(cbOdometry_t* odo, const cbEncoderSnapshot_t* left,
+                 const cbEncoderSnapshot_t* right);
+void cbOdoPose(const cbOdometry_t* odo, cbPose_t* pose);
+double cbOdoBamToRad(uint32_t theta);
+
+#endif  // ODOMETRY_H
@@ -0,0 +1,48 @@
+/**
+ * @file periodic.h
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PERIODIC_H
+#define PERIODIC_H
+
+#include <stdint.h>
+
+/**
+ * @brief A periodic timer on CLOCK_MONOTONIC. Releases happen at
+ *        `start + k * period_ns`, no matter how long the caller takes between
+ *        two waits, so the period does not drift.
+ */
+struct cbPeriodic {
+    uint64_t period_ns;
+    uint64_t spin_ns; //< Final part of each wait spent spinning, 0 for none.
+    uint64_t release_ns; //< The release the caller is running for.
+    uint64_t late; //< Waits that began after their release.
+    uint64_t skipped; //< Releases that passed entirely during the caller.
+};
+
+typedef struct cbPeriodic cbPeriodic_t;
+
+uint64_t cbPeriodicNowNs(void);
+void cbPeriodicInit(cbPeriodic_t* timer, uint64_t period_ns, uint64_t spin_ns);
+unsigned int cbPeriodicWait(cbPeriodic_t* timer);
+
+#endif  // PERIODIC_H
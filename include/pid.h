@@ -0,0 +1,90 @@
+/**
+ * @file pid.h
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PID_H
+#define PID_H
+
+#include <stdint.h>
+
+/**
+ * Number of loops updated together by cbPidUpdate(). Four 32-bit lanes fill a
+ * NEON register; unused lanes have zero gains and cost nothing more.
+ */
+#define CB_PID_LANES 4
+
+/**
+ * All the values are Q16.16: setpoints and measurements in the unit of the
+ * process variable (e.g. mm/s), outputs in the unit of the actuator (e.g. a
+ * signed duty cycle, 1.0 being CB_PID_ONE).
+ */
+#define CB_PID_FRAC_BITS 16
+#define CB_PID_ONE (1 << CB_PID_FRAC_BITS)
+#define CB_PID_FIX(x) ((int32_t)((x) * (float)CB_PID_ONE)) //< From float
+#define CB_PID_FLOAT(x) ((float)(x) / CB_PID_ONE) //< To float
+
+/**
+ * The per-period integral and back-calculation gains, Ki * dt and Kb * dt,
+ * are tiny at short periods and would lose most of their digits in Q16.16.
+ * They are kept in Q8.24 instead, and so is the integral, so that the product
+ * of a gain and an error is already in the unit of the integral and still
+ * fits 64 bits.
+ */
+#define CB_PID_GAIN_BITS 24
+
+/**
+ * @brief A bank of PID controllers in structure-of-arrays layout, one lane
+ *        per loop, e.g. per wheel.
+ *
+ * The derivative acts on the measurement, so setpoint steps do not kick the
+ * output. Two anti-windup schemes are combined: the integral stops growing
+ * while the output is saturated in the direction of the error (clamping),
+ * and it is pulled back by kb times the excess of the output over the limits
+ * (back-calculation, disabled with kb = 0).
+ */
+struct cbPid {
+    int32_t kp[CB_PID_LANES]; //< Proportional gain.
+    int32_t ki[CB_PID_LANES]; //< Integral gain per period (Q8.24), Ki * dt.
+    int32_t kd[CB_PID_LANES]; //< Derivative gain per period, i.e. Kd / dt.
+    int32_t kb[CB_PID_LANES]; //< Back-calculation gain per period (Q8.24).
+    int32_t out_min[CB_PID_LANES], out_max[CB_PID_LANES];
+    int32_t setpoint[CB_PID_LANES];
+    int64_t integral[CB_PID_LANES]; //< Q24.40, see CB_PID_GAIN_BITS.
+    int32_t prev_meas[CB_PID_LANES];
+    int32_t output[CB_PID_LANES]; //< Set by cbPidUpdate().
+    uint32_t saturated[CB_PID_LANES]; //< Consecutive saturated updates.
+    uint32_t period_us;
+    int primed; //< Whether prev_meas is valid.
+};
+
+typedef struct cbPid cbPid_t;
+
+void cbPidInit(cbPid_t* pid, uint32_t period_us);
+int cbPidSetGains(cbPid_t* pid, unsigned int lane, float kp, float ki,
+                  float kd, float kb);
+int cbPidSetLimits(cbPid_t* pid, unsigned int lane, float out_min,
+                   float out_max);
+int cbPidPreload(cbPid_t* pid, unsigned int lane, float output);
+void cbPidReset(cbPid_t* pid);
+void cbPidUpdate(cbPid_t* pid, const int32_t measurement[CB_PID_LANES]);
+
+#endif  // PID_H
@@ -0,0 +1,82 @@
+/**
+ * @file profile.h
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * The maximum number of periods of a move, e.g. 80s at 50Hz.
+ */
+#define CB_PROFILE_STEPS 4096
+
+/**
+ * @brief A rest-to-rest motion profile, sampled once per control period.
+ *        The setpoints are Q16.16 (see CB_PID_FIX()), in mm and mm/s, so the
+ *        velocity can be fed to a cbPid_t as is. With a jerk limit the
+ *        acceleration ramps up and down (S-curve), without one it steps
+ *        (trapezoid). The position never decreases, and the last one is the
+ *        distance of the move.
+ */
+struct cbProfile {
+    int32_t pos[CB_PROFILE_STEPS];  //< Position at the end of each period.
+    int32_t vel[CB_PROFILE_STEPS];  //< Velocity at the end of each period.
+    unsigned int steps;  //< Number of periods of the move.
+    unsigned int next;  //< The step returned by the next cbProfileNext().
+    float peak_vel, peak_acc;  //< Reached, at most the limits.
+};
+
+typedef struct cbProfile cbProfile_t;
+
+int cbProfileInit(cbProfile_t* prof, float dist_mm, float max_vel,
+                  float max_acc, float max_jerk, uint32_t period_us);
+
+/**
+ * @brief Returns the setpoints of the next period. Once the move is over, the
+ *        final position is returned with zero velocity.
+ * @param prof A pointer to the profile.
+ * @param pos Where to store the position setpoint.
+ * @param vel Where to store the velocity setpoint.
+ * @return false if the move was already over.
+ */
+static inline bool cbProfileNext(cbProfile_t* prof, int32_t* pos,
+                                 int32_t* vel) {
+    if (prof->next >= prof->steps) {
+        *pos = prof->pos[prof->steps - 1];
+        *vel = 0;
+        return false;
+    }
+    *pos = prof->pos[prof->next];
+    *vel = prof->vel[prof->next];
+    prof->next++;
+    return true;
+}
+
+/**
+ * @brief Restarts a profile from its first period.
+ */
+static inline void cbProfileRewind(cbProfile_t* prof) { prof->next = 0; }
+
+#endif  // PROFILE_H
@@ -0,0 +1,95 @@
+/**
+ * @file rt.h
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RT_H
+#define RT_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hist.h"
+
+#define CB_RT_FIFO_PRIORITY 50 //< Priority of the SCHED_FIFO fallback
+
+/**
+ * @brief The scheduling policy a task actually runs with.
+ */
+typedef enum {
+    CB_RT_DEADLINE = 0, //< SCHED_DEADLINE, the task yields with sched_yield()
+    CB_RT_FIFO = 1, //< SCHED_FIFO, the task sleeps until the next period
+    CB_RT_OTHER = 2 //< No RT privileges, as CB_RT_FIFO with SCHED_OTHER
+} cbRtPolicy_t;
+
+/**
+ * @brief What a task records about its own timing, all in ns:
+ *        - wakeup: from the beginning of the period to the start of the job;
+ *        - exec: from the start to the end of the job;
+ *        - jitter: how far the time between the start of two jobs is from
+ *          the nominal, in either direction.
+ *        The task is the only writer. It contains no pointers, so it can be
+ *        placed in memory shared with a monitoring process.
+ */
+struct cbRtStats {
+    atomic_uint_fast64_t cycles, overruns, misses;
+    cbHist_t wakeup, exec, jitter;
+};
+
+typedef struct cbRtStats cbRtStats_t;
+
+/**
+ * @brief A periodic real-time task. The parameters are set by the caller
+ *        before cbRtTaskStart(), the rest is managed by the library.
+ *
+ * The job is called once per period and returns false to end the task. If a
+ * job is still running when the deadline of its period expires it counts as
+ * a miss, and the releases skipped because of it count as misses too. The
+ * fallbacks release the jobs on a fixed grid, see cbPeriodicWait(), while
+ * with SCHED_DEADLINE a job is released when the kernel wakes the task up.
+ * An overrun is a job using more than runtime_ns of CPU: it is reported by
+ * the kernel with SCHED_DEADLINE and measured on the CPU clock of the thread
+ * with the fallbacks.
+ */
+struct cbRtTask {
+    const char* name; //< Used in diagnostics only.
+    bool (*job)(void* args); //< The body of the task.
+    void* args; //< Passed to the job.
+    uint64_t runtime_ns, deadline_ns, period_ns;
+    int priority; //< SCHED_FIFO priority of the fallback, 0 for the default.
+    pthread_t tid;
+    atomic_int policy; //< The cbRtPolicy_t actually obtained.
+    cbRtStats_t* stats; //< Where to record, NULL to use own_stats.
+    cbRtStats_t own_stats;
+    atomic_bool stop;
+};
+
+typedef struct cbRtTask cbRtTask_t;
+
+void cbRtStatsInit(cbRtStats_t* stats);
+int cbRtTaskStart(cbRtTask_t* task);
+void cbRtTaskStop(cbRtTask_t* task);
+int cbRtTaskJoin(cbRtTask_t* task);
+const char* cbRtPolicyName(cbRtPolicy_t policy);
+
+#endif  // RT_H
@@ -0,0 +1,60 @@
+/**
+ * @file sampler.h
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "encoder.h"
+
+#define CB_SAMPLER_SPIN_NS 100000 //< Spin instead of sleeping below this
+
+/**
+ * @brief A thread polling the levels of a group of Encoders at a fixed rate
+ *        with a single read of the level register per sample, in place of
+ *        the ISRs. Its cost depends on the sample rate rather than on the
+ *        edge rate, so it pays off at high wheel speeds. Each Channel must
+ *        change at most once per period, or the edges are counted as illegal
+ *        transitions.
+ */
+struct cbEncoderSampler {
+    cbEncoderGroup_t* group;  //< The Encoders to decode.
+    uint64_t period_ns;  //< The sampling period.
+    int cpu;  //< The CPU the thread is pinned to, -1 to leave it free.
+    pthread_t tid;
+    atomic_bool stop;
+    atomic_uint_fast64_t samples;  //< Samples taken.
+    atomic_uint_fast64_t moving;  //< Samples in which a pin changed.
+    atomic_uint_fast64_t missed;  //< Periods missed entirely.
+};
+
+typedef struct cbEncoderSampler cbEncoderSampler_t;
+
+int cbEncoderSamplerStart(cbEncoderSampler_t* sampler);
+int cbEncoderSamplerStop(cbEncoderSampler_t* sampler);
+
+#endif  // SAMPLER_H
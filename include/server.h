@@ -0,0 +1,120 @@
+/**
+ * @file server.h
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "encoder.h"
+#include "motor.h"
+
+/**
+ * The default path of the socket.
+ */
+#define CB_SERVER_PATH "/tmp/coderbot.sock"
+
+#define CB_SERVER_CLIENTS 16  //< Maximum number of clients connected at once
+#define CB_SERVER_BATCH 64  //< Maximum number of requests read at once
+#define CB_SERVER_MIN_PERIOD_US 100  //< Shortest period of a subscription
+
+/**
+ * Operations. Every request is answered by a reply with the same op and
+ * tag, in order; CB_OP_UPDATE replies are pushed to subscribers.
+ */
+#define CB_OP_PING 0  //< Does nothing.
+#define CB_OP_MOVE 1  //< cbMotorMove(motor arg, dir, duty value).
+#define CB_OP_RESET 2  //< cbMotorReset(motor arg).
+#define CB_OP_READ 3  //< Replies with the ticks of the Encoders.
+#define CB_OP_SUBSCRIBE 4  //< Pushes updates every arg us, 0 to stop.
+#define CB_OP_UPDATE 5  //< An update, tagged as the CB_OP_SUBSCRIBE.
+
+/**
+ * @brief A request, in the byte order of the host.
+ */
+struct cbRequest {
+    uint16_t op;
+    uint16_t tag;  //< Chosen by the client, echoed in the reply.
+    uint32_t arg;
+    float value;
+    int32_t dir;  //< A cbDir_t.
+};
+
+typedef struct cbRequest cbRequest_t;
+
+/**
+ * @brief A reply. The ticks are always filled, so every reply is also an
+ *        update of the Encoders.
+ */
+struct cbReply {
+    uint16_t op;
+    uint16_t tag;
+    int32_t status;  //< A condition code.
+    uint64_t time_us;  //< When the ticks were read, see timebase.h.
+    int64_t ticks_l, ticks_r;
+};
+
+typedef struct cbReply cbReply_t;
+
+_Static_assert(sizeof(cbRequest_t) == 16, "Fixed-size requests");
+_Static_assert(sizeof(cbReply_t) == 32, "Fixed-size replies");
+
+/**
+ * @brief A client of the server.
+ */
+struct cbServerClient {
+    int fd;  //< The socket, -1 if the slot is free.
+    int timer;  //< A timerfd for the subscription, -1 if none.
+    uint32_t events;  //< EPOLLIN while idle, EPOLLOUT while replies wait.
+    uint16_t sub_tag;
+    size_t in_len, out_len, out_pos;
+    uint64_t dropped;  //< Updates not sent because the client was slow.
+    uint8_t in[CB_SERVER_BATCH * sizeof(cbRequest_t)];
+    uint8_t out[CB_SERVER_BATCH * sizeof(cbReply_t)];
+};
+
+typedef struct cbServerClient cbServerClient_t;
+
+/**
+ * @brief A command server over a Unix domain socket, serving the motors and
+ *        Encoders of the robot. All clients are handled by the thread
+ *        calling cbServerPoll().
+ */
+struct cbServer {
+    int fd;  //< The listening socket.
+    int epoll;
+    cbMotor_t* motor[2];  //< Left and right.
+    cbEncoder_t* encoder[2];  //< Left and right.
+    uint64_t requests, updates;
+    cbServerClient_t client[CB_SERVER_CLIENTS];
+};
+
+typedef struct cbServer cbServer_t;
+
+int cbServerOpen(cbServer_t* srv, const char* path, cbMotor_t* motors[2],
+                 cbEncoder_t* encoders[2]);
+int cbServerPoll(cbServer_t* srv, int timeout_ms);
+void cbServerClose(cbServer_t* srv, const char* path);
+
+#endif  // SERVER_H
@@ -0,0 +1,137 @@
+/**
+ * @file sim.h
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cbdef.h"
+#include "imu.h"
+#include "mcu.h"
+
+#define CB_SIM_STEP_US 20 //< Integration step of the simulation
+#define CB_SIM_MAX_WHEELS 4 //< Maximum number of simulated wheels
+#define CB_SIM_MAX_SONARS 4 //< Maximum number of simulated sonars
+#define CB_SIM_MAX_I2C 4 //< Maximum number of simulated I2C devices
+#define CB_SIM_SPI_CHANNELS 2 //< SPI0 CE0 and CE1
+#define CB_SIM_EPOCH_US 1000000 //< Simulated time at initialization
+
+/**
+ * @brief A simulated wheel: a DC motor driven by an L293DD half-bridge pair,
+ *        with a quadrature encoder on the motor shaft and a gearbox between
+ *        the motor and the wheel. The motor is modeled as a first order
+ *        system whose no-load speed is proportional to the average voltage
+ *        applied by the PWM, minus a deadband due to static friction.
+ */
+struct cbSimWheel {
+    cbGPIO_t pin_fw, pin_bw; //< Inputs of the motor driver.
+    cbGPIO_t pin_a, pin_b; //< Outputs of the encoder.
+    float noload_rps; //< Motor shaft speed at full duty in revolutions/s.
+    float tau_s; //< Mechanical time constant of the motor and load in s.
+    float deadband; //< Duty cycle below which the motor does not move.
+    unsigned int edges_per_rev; //< Quadrature edges per motor revolution.
+    float gear_ratio; //< Motor revolutions per wheel revolution.
+    float wheel_radius_mm;
+    double speed_rps, angle_rev; //< State of the motor shaft.
+    int64_t edge; //< Index of the last quadrature edge generated.
+};
+
+typedef struct cbSimWheel cbSimWheel_t;
+
+/**
+ * @brief A simulated HC-SR04 ultrasonic sonar. A trigger pulse raises the
+ *        echo line after delay_us, and lowers it again after the round trip
+ *        of the sound to the obstacle, or after max_us if there is none.
+ *        Triggers received while an echo is in progress are ignored.
+ */
+struct cbSimSonar {
+    cbGPIO_t pin_trigger, pin_echo;
+    float range_mm; //< Distance of the obstacle, 0 if there is none.
+    unsigned int delay_us; //< From the end of the trigger to the echo.
+    unsigned int max_us; //< Length of the echo when there is no obstacle.
+    uint64_t rise_us, fall_us; //< Pending echo edges, 0 if none.
+};
+
+typedef struct cbSimSonar cbSimSonar_t;
+
+/**
+ * @brief A simulated LSM9DS1 accelerometer and gyroscope on the I2C bus. It
+ *        replays a recording of FIFO slots in a loop, one slot per period of
+ *        the output data rate, into a FIFO that behaves like the real one in
+ *        continuous mode. The other registers read back what was written to
+ *        them.
+ */
+struct cbSimImu {
+    unsigned int bus, addr;
+    const uint8_t* recording; //< Slots of CB_IMU_SLOT_SIZE bytes.
+    size_t slots; //< Number of slots in the recording.
+    uint8_t regs[128];
+    uint8_t fifo[CB_IMU_FIFO_SLOTS][CB_IMU_SLOT_SIZE];
+    unsigned int first, level; //< Oldest slot and number of slots queued.
+    bool overrun; //< Set when a slot is overwritten, cleared by a read.
+    size_t next; //< Next slot of the recording.
+    uint64_t next_us; //< When the next slot is due.
+    uint32_t transfers; //< Bus transactions addressed to the device.
+};
+
+typedef struct cbSimImu cbSimImu_t;
+
+/**
+ * @brief A simulated ATMega328P running the firmware of the SPI link. It
+ *        counts encoder ticks at a rate proportional to the duty cycles it
+ *        is commanded, stops the motors if no valid command arrives for
+ *        CB_MCU_WATCHDOG_US, and can corrupt the frames on the wire.
+ *        Channels without an MCU loop MOSI back to MISO.
+ */
+struct cbSimMcu {
+    unsigned int channel;
+    float ticks_per_s; //< Counting rate at full duty.
+    uint32_t corrupt_every; //< Flip a bit of every Nth status, 0 never.
+    uint32_t garble_every; //< Flip a bit of every Nth command, 0 never.
+    cbMcuCommand_t command; //< The last valid command.
+    cbMcuStatus_t status;
+    double count[2];
+    uint64_t last_us, command_us; //< Last transfer and last valid command.
+    uint32_t transfers;
+};
+
+typedef struct cbSimMcu cbSimMcu_t;
+
+void cbSimWheelInit(cbSimWheel_t* wheel, cbGPIO_t pin_fw, cbGPIO_t pin_bw,
+                    cbGPIO_t pin_a, cbGPIO_t pin_b);
+int cbSimAttachWheel(cbSimWheel_t* wheel);
+void cbSimSonarInit(cbSimSonar_t* sonar, cbGPIO_t pin_trigger,
+                    cbGPIO_t pin_echo, float range_mm);
+int cbSimAttachSonar(cbSimSonar_t* sonar);
+void cbSimImuInit(cbSimImu_t* imu, const uint8_t* recording, size_t slots);
+int cbSimAttachImu(cbSimImu_t* imu);
+void cbSimMcuInit(cbSimMcu_t* mcu, unsigned int channel);
+int cbSimAttachMcu(cbSimMcu_t* mcu);
+void cbSimStep(uint64_t dt_us);
+uint64_t cbSimNowUs(void);
+double cbSimWheelTravelMm(const cbSimWheel_t* wheel);
+
+#endif  // SIM_H
@@ -0,0 +1,95 @@
+/**
+ * @file sonar.h
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SONAR_H
+#define SONAR_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "cbdef.h"
+
+/**
+ * The maximum number of Sonars sharing a trigger line.
+ */
+#define CB_SONAR_MAX 4
+
+/**
+ * The PiGPIO timer firing the trigger, see CB_TIME_TIMER for the other one.
+ * @link https://abyz.me.uk/rpi/pigpio/cif.html#gpioSetTimerFuncEx
+ */
+#define CB_SONAR_TIMER 8
+
+#define CB_SONAR_PULSE_US 10 //< Length of the trigger pulse.
+#define CB_SONAR_PERIOD_MS 60 //< Default period, as advised for the HC-SR04.
+#define CB_SONAR_TIMEOUT_US 23500 //< Default timeout, ~4m away and back.
+#define CB_SONAR_SOUND_SPEED 343 //< In m/s at 20 degrees C, i.e. um per us.
+#define CB_SONAR_NONE UINT32_MAX //< Range of an echo longer than the timeout.
+
+/**
+ * @brief Initializer for a cbSonar_t with the four Sonars of the CoderBot V5,
+ *        at the default period and timeout.
+ */
+#define CB_SONAR_INIT_V5                                                  \
+    {                                                                     \
+        .trigger = PIN_SONAR_1_TRIGGER,                                   \
+        .echo = {PIN_SONAR_1_ECHO, PIN_SONAR_2_ECHO, PIN_SONAR_3_ECHO,    \
+                 PIN_SONAR_4_ECHO},                                       \
+        .count = 4, .period_ms = CB_SONAR_PERIOD_MS,                      \
+        .timeout_us = CB_SONAR_TIMEOUT_US                                 \
+    }
+
+/**
+ * @brief A set of Sonars sharing a trigger line. Every trigger starts a cycle
+ *        in which the echo pulses of all the Sonars are timed concurrently by
+ *        their ISRs, from the ticks of the edges. The latest range of each
+ *        Sonar is published as a single atomic word, holding the cycle it
+ *        was measured in and the range in um, so readers never block the
+ *        ISRs nor see a range of one cycle paired with the cycle of another.
+ *        Like for the Encoders, the configuration and the state written by
+ *        the ISRs live on separate cache lines.
+ */
+struct cbSonar {
+    // Cold: set before cbSonarStart(), read-only afterwards
+    cbGPIO_t trigger;
+    cbGPIO_t echo[CB_SONAR_MAX];
+    unsigned int count;
+    unsigned int period_ms;  //< Trigger period, 0 to call cbSonarFire().
+    uint32_t timeout_us;  //< Longer echoes mean nothing is in range.
+    // Hot: written by the timer and the ISRs
+    _Alignas(CB_CACHELINE) atomic_uint cycle;  //< Incremented by triggers.
+    uint32_t rise[CB_SONAR_MAX];  //< Tick of the rising edge of the echo.
+    uint32_t rise_cycle[CB_SONAR_MAX];  //< Cycle of the rising edge, 0 if none.
+    _Atomic uint64_t reading[CB_SONAR_MAX];  //< Cycle << 32 | range in um.
+};
+
+typedef struct cbSonar cbSonar_t;
+
+void cbSonarGPIOinit(const cbSonar_t* sonar);
+int cbSonarStart(cbSonar_t* sonar);
+void cbSonarStop(cbSonar_t* sonar);
+void cbSonarFire(void* sonar_gen);
+void cbSonarISR(int gpio, int level, uint32_t tick, void* sonar_gen);
+int cbSonarRange(const cbSonar_t* sonar, unsigned int index, float* range_mm);
+
+#endif  // SONAR_H
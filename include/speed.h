@@ -0,0 +1,63 @@
+/**
+ * @file speed.h
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SPEED_H
+#define SPEED_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "encoder.h"
+
+/**
+ * @brief The state of a wheel speed estimator.
+ *
+ * The estimator implements the M/T method: the speed is the number of ticks
+ * counted between two edges divided by the exact time elapsed between those
+ * edges, as timestamped by PiGPIO. At high speed many ticks fall in a window
+ * and the method behaves like a tick counter; at low speed it degenerates to
+ * a measurement of the pulse period. When no edge has been seen for a while
+ * the estimate decays, as the wheel cannot be faster than one tick over the
+ * time elapsed since the last edge.
+ */
+struct cbSpeed {
+    float mm_per_tick;  //< Distance traveled by the wheel per tick in mm.
+    uint64_t window_us;  //< Minimum span of the measurement window.
+    uint64_t timeout_us;  //< Time without edges after which speed is zero.
+    float alpha, beta;  //< Gains of the alpha-beta filter, 0 to disable it.
+    int64_t ref_ticks, prev_ticks, last_ticks;
+    uint64_t ref_edge_us, prev_edge_us, last_edge_us;
+    float raw_mm_s;  //< The unfiltered M/T estimate.
+    float pos_mm, speed_mm_s;  //< State of the filter.
+    bool primed, stopped;
+};
+
+typedef struct cbSpeed cbSpeed_t;
+
+void cbSpeedInit(cbSpeed_t* est, float mm_per_tick, uint64_t window_us,
+                 uint64_t timeout_us);
+void cbSpeedSetFilter(cbSpeed_t* est, float alpha, float beta);
+float cbSpeedUpdate(cbSpeed_t* est, const cbEncoderSnapshot_t* snap,
+                    uint64_t now_us);
+
+#endif  // SPEED_H
@@ -0,0 +1,66 @@
+/**
+ * @file stream.h
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "encoder.h"
+#include "hal.h"
+
+/**
+ * The number of reports read from the pipe at once. PiGPIO writes them in
+ * blocks, so a large buffer makes for few reads under heavy load.
+ */
+#define CB_STREAM_BATCH 512
+
+/**
+ * @brief A group of Encoders decoded from the reports of a notification
+ *        pipe. The decoding runs in the thread calling cbEncoderStreamPump(),
+ *        instead of PiGPIO's callback thread, and a whole block of reports is
+ *        decoded at once. The statistics are written by that thread only.
+ */
+struct cbEncoderStream {
+    cbEncoderGroup_t* group;
+    int fd;  //< The pipe, -1 if closed.
+    uint16_t seqno;  //< The sequence number of the next report.
+    bool primed;  //< Whether seqno is valid.
+    uint64_t reports;  //< Reports read.
+    uint64_t lost;  //< Reports missing from the sequence.
+    uint64_t gaps;  //< Runs of missing reports.
+    uint64_t other;  //< Watchdog, keep-alive and event reports.
+    size_t pending;  //< Bytes of a partial report at the start of buf.
+    cbHalReport_t buf[CB_STREAM_BATCH];
+    cbHalSample_t samples[CB_STREAM_BATCH];
+};
+
+typedef struct cbEncoderStream cbEncoderStream_t;
+
+int cbEncoderStreamOpen(cbEncoderStream_t* stream, cbEncoderGroup_t* group);
+int cbEncoderStreamPump(cbEncoderStream_t* stream);
+void cbEncoderStreamClose(cbEncoderStream_t* stream);
+
+#endif  // STREAM_H
@@ -0,0 +1,132 @@
+/**
+ * @file telemetry.h
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * The magic number at the start of a telemetry file, "cbtelem" and a NUL.
+ */
+#define CB_TELEMETRY_MAGIC "cbtelem"
+#define CB_TELEMETRY_VERSION 1
+
+/**
+ * The default number of records kept, 4MiB of records: about 65s at 1kHz,
+ * or 20 minutes at the 50Hz of a typical control loop.
+ */
+#define CB_TELEMETRY_CAPACITY (1 << 16)
+
+/**
+ * @brief A telemetry record, one cache line. The fields other than seq are
+ *        filled by the caller, and only interpreted by the dump tool.
+ */
+struct cbTelemetryRecord {
+    atomic_uint seq;  //< Low 32 bits of the index + 1, 0 while written.
+    uint32_t theta;  //< Heading in BAM.
+    uint64_t time_us;  //< In the time base of timebase.h.
+    int64_t ticks_l, ticks_r;
+    int64_t x_nm, y_nm;
+    float duty_l, duty_r;  //< Signed duty cycles.
+    float setpoint, error;
+};
+
+typedef struct cbTelemetryRecord cbTelemetryRecord_t;
+
+_Static_assert(sizeof(cbTelemetryRecord_t) == 64, "Records are 64 bytes");
+
+/**
+ * @brief The header of a telemetry file, followed by the ring of records.
+ *        Both contain no pointers and are read back by other processes.
+ */
+struct cbTelemetryHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;  //< sizeof(cbTelemetryRecord_t)
+    uint64_t capacity;  //< Number of records, a power of two.
+    int64_t start_ns;  //< CLOCK_REALTIME when the file was created.
+    uint64_t start_us;  //< cbTimeNowUs() when the file was created.
+    atomic_uint_fast64_t head;  //< Number of records ever written.
+    uint8_t pad[16];
+};
+
+typedef struct cbTelemetryHeader cbTelemetryHeader_t;
+
+_Static_assert(sizeof(cbTelemetryHeader_t) == 64, "The header is 64 bytes");
+
+/**
+ * @brief A telemetry file mapped in memory. It has a single writer, which
+ *        appends records with cbTelemetryLog(), and any number of readers,
+ *        in the same or in other processes.
+ */
+struct cbTelemetry {
+    cbTelemetryHeader_t* header;
+    cbTelemetryRecord_t* ring;
+    uint64_t mask;  //< capacity - 1
+    uint64_t head;  //< Writer's copy of header->head.
+    size_t size;  //< Size of the mapping in bytes.
+};
+
+typedef struct cbTelemetry cbTelemetry_t;
+
+/**
+ * @brief Appends a record, overwriting the oldest one if the ring is full.
+ *        Wait-free: a handful of stores to memory already mapped, with no
+ *        system calls. Must only be called by the writer.
+ * @param tel A pointer to the telemetry file, opened with cbTelemetryOpen().
+ * @param rec A pointer to the record, its seq is ignored.
+ */
+static inline void cbTelemetryLog(cbTelemetry_t* tel,
+                                  const cbTelemetryRecord_t* rec) {
+    uint64_t head = tel->head;
+    cbTelemetryRecord_t* slot = &tel->ring[head & tel->mask];
+    atomic_store_explicit(&slot->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot->theta = rec->theta;
+    slot->time_us = rec->time_us;
+    slot->ticks_l = rec->ticks_l;
+    slot->ticks_r = rec->ticks_r;
+    slot->x_nm = rec->x_nm;
+    slot->y_nm = rec->y_nm;
+    slot->duty_l = rec->duty_l;
+    slot->duty_r = rec->duty_r;
+    slot->setpoint = rec->setpoint;
+    slot->error = rec->error;
+    atomic_store_explicit(&slot->seq, (unsigned int)(head + 1),
+                          memory_order_release);
+    tel->head = head + 1;
+    atomic_store_explicit(&tel->header->head, head + 1, memory_order_release);
+}
+
+int cbTelemetryOpen(cbTelemetry_t* tel, const char* path, uint64_t capacity);
+int cbTelemetryAttach(cbTelemetry_t* tel, const char* path);
+void cbTelemetryClose(cbTelemetry_t* tel);
+uint64_t cbTelemetryFirst(const cbTelemetry_t* tel, uint64_t* head);
+bool cbTelemetryRead(const cbTelemetry_t* tel, uint64_t index,
+                     cbTelemetryRecord_t* rec);
+
+#endif  // TELEMETRY_H
@@ -0,0 +1,49 @@
+/**
+ * @file timebase.h
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include <stdint.h>
+
+/**
+ * The PiGPIO timer used to keep the timebase alive when no edges are received.
+ * @link https://abyz.me.uk/rpi/pigpio/cif.html#gpioSetTimerFuncEx
+ */
+#define CB_TIME_TIMER 9
+
+/**
+ * The period of the keepalive timer in milliseconds. It must be well below
+ * half of the wrap-around period of the PiGPIO tick (~35 minutes).
+ */
+#define CB_TIME_KEEPALIVE_MS 60000
+
+int cbTimeInit(void);
+void cbTimeTerminate(void);
+void cbTimeCalibrate(void);
+uint64_t cbTimeExtend(uint32_t tick_us);
+uint64_t cbTimeNowUs(void);
+uint64_t cbTimeToMonoRawNs(uint64_t time_us);
+uint64_t cbTimeFromMonoRawNs(uint64_t mono_raw_ns);
+
+#endif  // TIMEBASE_H
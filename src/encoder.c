@@ -23,10 +23,106 @@
 
 #include "encoder.h"
 
-#include <pigpio.h>
+#include "hal.h"
+#include "timebase.h"
 
-void cbEncoderISRa(int gpio, int level, uint32_t tick, void* enc_gen);
-void cbEncoderISRb(int gpio, int level, uint32_t tick, void* enc_gen);
+/**
+ * Ticks counted on each transition of the Channels, for each resolution,
+ * indexed by the previous state in bits 2-3 and the new one in bits 0-1. Both
+ * Channels are encoded as A in the high bit and B in the low one, so turning
+ * forward goes 00 -> 10 -> 11 -> 01 -> 00.
+ */
+static const int8_t cbEncoderDecode[3][16] = {
+    // 00 01 10 11 <- new, previous:
+    {0, 0, 1, 0, /* 00 */ 0, 0, 0, 0, /* 01 */
+     -1, 0, 0, 0, /* 10 */ 0, 0, 0, 0 /* 11 */},  // x1
+    {0, 0, 1, 0, /* 00 */ 0, 0, 0, -1, /* 01 */
+     -1, 0, 0, 0, /* 10 */ 0, 1, 0, 0 /* 11 */},  // x2
+    {0, -1, 1, 0, /* 00 */ 1, 0, 0, -1, /* 01 */
+     -1, 0, 0, 1, /* 10 */ 0, 1, -1, 0 /* 11 */},  // x4
+};
+
+/**
+ * The row of cbEncoderDecode for each resolution, indexed by its lowest bits.
+ * A zeroed resolution, e.g. from a cbEncoder_t initialized with {0}, and any
+ * invalid one count at the default x2, so the lookup never leaves the table.
+ */
+static const uint8_t cbEncoderRow[8] = {1, 0, 1, 1, 2, 1, 1, 1};
+
+/**
+ * The transitions in which both Channels changed, i.e. an edge was lost and
+ * the direction cannot be known: 00 <-> 11 and 01 <-> 10.
+ */
+#define CB_ENCODER_ILLEGAL 0x1248u
+
+/**
+ * @brief Marks the beginning of an update to the state of an Encoder. The
+ *        two ISRs of an Encoder run on different PiGPIO threads, so the
+ *        writers take the sequence counter from even to odd with an atomic
+ *        exchange, which also makes it a lock between them. The section it
+ *        guards is a few instructions long, so a writer that finds it taken
+ *        spins instead of sleeping.
+ * @param enc A pointer to the cbEncoder_t structure being updated.
+ */
+static inline void cbEncoderWriteBegin(cbEncoder_t* enc) {
+    unsigned int seq = atomic_load_explicit(&enc->seq, memory_order_relaxed);
+    do {
+        seq &= ~1u;
+    } while (!atomic_compare_exchange_weak_explicit(
+        &enc->seq, &seq, seq + 1, memory_order_acquire,
+        memory_order_relaxed));
+    atomic_thread_fence(memory_order_release);
+}
+
+/**
+ * @brief Marks the end of an update to the state of an Encoder, publishing
+ *        the new state to the readers and letting the next writer in.
+ * @param enc A pointer to the cbEncoder_t structure being updated.
+ */
+static inline void cbEncoderWriteEnd(cbEncoder_t* enc) {
+    unsigned int seq = atomic_load_explicit(&enc->seq, memory_order_relaxed);
+    atomic_store_explicit(&enc->seq, seq + 1, memory_order_release);
+}
+
+/**
+ * @brief Appends an edge to the ring buffer of an Encoder, if one is attached.
+ *        If the consumer fell behind and the ring is full the edge is dropped
+ *        and accounted for, as the ISR must never wait. Must be called
+ *        between cbEncoderWriteBegin() and cbEncoderWriteEnd(), which keep
+ *        the ISRs of the two Channels from claiming the same slot.
+ * @param enc A pointer to the cbEncoder_t structure owning the ring.
+ * @param gpio The GPIO Pin that triggered the Interrupt.
+ * @param level The TTL level read from the Pin.
+ * @param ts_us The timestamp at which the Interrupt happened.
+ */
+static inline void cbEncoderPushEdge(cbEncoder_t* enc, int gpio, int level,
+                                     uint64_t ts_us) {
+    cbEncoderRing_t* ring = enc->ring;
+    if (!ring) return;
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail == CB_ENCODER_RING_SIZE) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+    cbEncoderEdge_t* edge = &ring->edges[head & (CB_ENCODER_RING_SIZE - 1)];
+    edge->ts_us = ts_us;
+    edge->gpio = (uint8_t)gpio;
+    edge->level = (uint8_t)level;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+/**
+ * @brief Sets the state of an Encoder from the levels of the GPIO port.
+ * @param enc A pointer to the cbEncoder_t structure of the encoder.
+ * @param levels The levels of GPIO 0-31 as a bitmask.
+ */
+static void cbEncoderSyncLevels(cbEncoder_t* enc, uint32_t levels) {
+    cbEncoderWriteBegin(enc);
+    enc->state = (uint8_t)(((levels >> enc->pin_a) & 1) << 1 |
+                           ((levels >> enc->pin_b) & 1));
+    cbEncoderWriteEnd(enc);
+}
 
 /**
  * @brief Initializes PiGPIO to service the Pulses from an Encoder.
@@ -35,11 +131,38 @@ void cbEncoderISRb(int gpio, int level, uint32_t tick, void* enc_gen);
  */
 void cbEncoderGPIOinit(const cbEncoder_t* enc) {
     // Channel A
-    gpioSetMode(enc->pin_a, PI_INPUT);
-    gpioSetPullUpDown(enc->pin_a, PI_PUD_UP);
+    cbHal->set_mode(enc->pin_a, CB_GPIO_INPUT);
+    cbHal->set_pull(enc->pin_a, CB_GPIO_PUD_UP);
     // Channel B
-    gpioSetMode(enc->pin_b, PI_INPUT);
-    gpioSetPullUpDown(enc->pin_b, PI_PUD_UP);
+    cbHal->set_mode(enc->pin_b, CB_GPIO_INPUT);
+    cbHal->set_pull(enc->pin_b, CB_GPIO_PUD_UP);
+}
+
+/**
+ * @brief Selects how many ticks an Encoder counts per quadrature cycle. Must
+ *        be called before registering the ISRs.
+ * @param enc A pointer to the cbEncoder_t structure of the encoder.
+ * @param resolution The resolution.
+ * @return A condition code.
+ */
+int cbEncoderSetResolution(cbEncoder_t* enc, cbEncoderRes_t resolution) {
+    if (resolution != CB_ENCODER_X1 && resolution != CB_ENCODER_X2 &&
+        resolution != CB_ENCODER_X4) {
+        return CB_ERANGE;
+    }
+    enc->resolution = resolution;
+    return CB_SUCCESS;
+}
+
+/**
+ * @brief Samples the current levels of the Encoder's Channels, so that the
+ *        first edges are decoded against the actual state of the pins rather
+ *        than against zero. Both levels come from the same read of the level
+ *        register. Must be called before registering the ISRs.
+ * @param enc A pointer to the cbEncoder_t structure of the encoder.
+ */
+void cbEncoderSync(cbEncoder_t* enc) {
+    cbEncoderSyncLevels(enc, cbHal->read_bank());
 }
 
 /**
@@ -51,11 +174,11 @@ void cbEncoderGPIOinit(const cbEncoder_t* enc) {
  */
 void cbEncoderRegisterISRs(const cbEncoder_t* enc, int timeout) {
     // Channel A
-    gpioSetISRFuncEx(enc->pin_a, EITHER_EDGE, timeout, cbEncoderISRa,
-                     (void*)enc);
+    cbHal->set_isr(enc->pin_a, CB_EDGE_EITHER, timeout, cbEncoderISRa,
+                   (void*)enc);
     // Channel B
-    gpioSetISRFuncEx(enc->pin_b, EITHER_EDGE, timeout, cbEncoderISRb,
-                     (void*)enc);
+    cbHal->set_isr(enc->pin_b, CB_EDGE_EITHER, timeout, cbEncoderISRb,
+                   (void*)enc);
 }
 
 /**
@@ -75,9 +198,9 @@ void cbEncoderRegisterCustomISRs(const cbEncoder_t* enc, unsigned int edge_a,
                                  void (*isr_b)(int, int, uint32_t, void*),
                                  int timeout) {
     // Channel A
-    gpioSetISRFuncEx(enc->pin_a, edge_a, timeout, isr_a, (void*)enc);
+    cbHal->set_isr(enc->pin_a, edge_a, timeout, isr_a, (void*)enc);
     // Channel B
-    gpioSetISRFuncEx(enc->pin_b, edge_b, timeout, isr_b, (void*)enc);
+    cbHal->set_isr(enc->pin_b, edge_b, timeout, isr_b, (void*)enc);
 }
 
 /**
@@ -87,53 +210,266 @@ void cbEncoderRegisterCustomISRs(const cbEncoder_t* enc, unsigned int edge_a,
  */
 void cbEncoderCancelISRs(const cbEncoder_t* enc) {
     // Channel A
-    gpioSetISRFunc(enc->pin_a, EITHER_EDGE, 0, NULL);
+    cbHal->set_isr(enc->pin_a, CB_EDGE_EITHER, 0, NULL, NULL);
     // Channel B
-    gpioSetISRFunc(enc->pin_b, EITHER_EDGE, 0, NULL);
+    cbHal->set_isr(enc->pin_b, CB_EDGE_EITHER, 0, NULL, NULL);
+}
+
+/**
+ * @brief Takes a consistent snapshot of the state of an Encoder without
+ *        locking. The ISRs never wait on the reader: if an edge is serviced
+ *        while the copy is in progress, the copy is simply retried.
+ * @param enc A pointer to the cbEncoder_t structure to be read.
+ * @param snap A pointer to the cbEncoderSnapshot_t structure to be filled.
+ */
+void cbEncoderSnapshot(const cbEncoder_t* enc, cbEncoderSnapshot_t* snap) {
+    unsigned int seq0, seq1;
+    do {
+        seq0 = atomic_load_explicit(&enc->seq, memory_order_acquire);
+        snap->ticks = enc->ticks;
+        snap->bad_ticks = enc->bad_ticks;
+        snap->illegal = enc->illegal;
+        snap->direction = enc->direction;
+        snap->last_edge_us = enc->last_edge_us;
+        atomic_thread_fence(memory_order_acquire);
+        seq1 = atomic_load_explicit(&enc->seq, memory_order_relaxed);
+    } while ((seq0 & 1) || seq0 != seq1);
+}
+
+/**
+ * @brief Attaches a ring buffer to an Encoder. From now on the ISRs will
+ *        record every edge they receive into the ring. This must be done
+ *        before registering the ISRs.
+ * @param enc A pointer to the cbEncoder_t structure of the encoder.
+ * @param ring A pointer to the ring buffer, or NULL to detach it.
+ */
+void cbEncoderAttachRing(cbEncoder_t* enc, cbEncoderRing_t* ring) {
+    if (ring) {
+        atomic_store_explicit(&ring->head, 0, memory_order_relaxed);
+        atomic_store_explicit(&ring->tail, 0, memory_order_relaxed);
+        atomic_store_explicit(&ring->dropped, 0, memory_order_relaxed);
+    }
+    enc->ring = ring;
+}
+
+/**
+ * @brief Returns the oldest batch of edges received by an Encoder without
+ *        copying them. The batch stays valid until it is handed back with
+ *        cbEncoderRelease(). Since the edges are returned as a contiguous
+ *        array, a batch that wraps around the end of the ring is returned in
+ *        two calls: drain until zero is returned to get every pending edge.
+ * @param enc A pointer to the cbEncoder_t structure of the encoder.
+ * @param batch Set to point to the first edge of the batch.
+ * @return The number of edges in the batch, zero if there are none or no ring
+ *         is attached.
+ */
+size_t cbEncoderDrain(cbEncoder_t* enc, const cbEncoderEdge_t** batch) {
+    cbEncoderRing_t* ring = enc->ring;
+    if (!ring) return 0;
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    unsigned int first = tail & (CB_ENCODER_RING_SIZE - 1);
+    size_t count = head - tail;
+    if (count > CB_ENCODER_RING_SIZE - first) {
+        count = CB_ENCODER_RING_SIZE - first;  // Stop at the end of the ring
+    }
+    *batch = &ring->edges[first];
+    return count;
+}
+
+/**
+ * @brief Hands a batch of edges obtained with cbEncoderDrain() back to the
+ *        ISRs, so that their slots can be reused.
+ * @param enc A pointer to the cbEncoder_t structure of the encoder.
+ * @param count The number of edges consumed, at most the size of the batch.
+ */
+void cbEncoderRelease(cbEncoder_t* enc, size_t count) {
+    cbEncoderRing_t* ring = enc->ring;
+    if (!ring) return;
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + (unsigned int)count,
+                          memory_order_release);
+}
+
+/**
+ * @brief Decodes a new state of the Channels of an Encoder with a lookup, so
+ *        the outcome of the transition costs no branches. Must be called
+ *        between cbEncoderWriteBegin() and cbEncoderWriteEnd(): the new state
+ *        is merged with the previous one, which the ISR of the other Channel
+ *        may be changing.
+ * @param enc A pointer to the cbEncoder_t structure of the encoder.
+ * @param keep The bits of the previous state to keep, A in bit 1 and B in
+ *        bit 0.
+ * @param levels The other bits of the new state.
+ * @param ts_us The timestamp of the edge.
+ */
+static inline void cbEncoderDecodeState(cbEncoder_t* enc, unsigned int keep,
+                                        unsigned int levels, uint64_t ts_us) {
+    unsigned int state = (enc->state & keep) | levels;
+    unsigned int transition = (unsigned int)enc->state << 2 | state;
+    int delta = cbEncoderDecode[cbEncoderRow[enc->resolution & 7]][transition];
+    enc->state = (uint8_t)state;
+    enc->ticks += delta;
+    enc->direction = delta ? (cbDir_t)delta : enc->direction;
+    enc->last_edge_us = delta ? ts_us : enc->last_edge_us;
+    enc->bad_ticks += (transition >> 2) == state;
+    enc->illegal += (CB_ENCODER_ILLEGAL >> transition) & 1;
 }
 
 /**
  * @brief Service Routine for the Interrupt on Channel A.
  * @param gpio The GPIO Pin that triggered the Interrupt.
- * @param level The TTL level read from the Pin (0 or 1).
+ * @param level The TTL level read from the Pin: 0 or 1, 2 on a watchdog
+ *        timeout, which is recorded in the ring but not decoded.
  * @param event_ts_us The timestamp at which the Interrupt happened expressed
- *        in microseconds elapsed since boot. WARNING: this wraps around from
- *        4294967295 to 0 roughly every 72 minutes.
+ *        in microseconds elapsed since boot. It wraps around from 4294967295
+ *        to 0 roughly every 72 minutes, so it is extended to 64 bits with
+ *        cbTimeExtend() before being stored.
  * @param enc_gen A generic pointer to the cbEncoder_t structure containing
  *                the encoder parameters.
  */
 void cbEncoderISRa(int gpio, int level, uint32_t event_ts_us, void* enc_gen) {
     cbEncoder_t* enc = (cbEncoder_t*)enc_gen;
-    if (gpio == enc->last_gpio) return;  // Debounce
-    enc->last_gpio = gpio;
-    enc->level_a = level;
-    if (level ^ enc->level_b) {  // Either one of A or B is 1
-        enc->direction = forward;
-        enc->ticks += enc->direction;
-    } else {
-        enc->bad_ticks++;  // Self-diagnostics
-    }
+    uint64_t ts_us = cbTimeExtend(event_ts_us);
+    cbEncoderWriteBegin(enc);
+    cbEncoderPushEdge(enc, gpio, level, ts_us);
+    if (level <= 1) cbEncoderDecodeState(enc, 1, (unsigned int)level << 1, ts_us);
+    cbEncoderWriteEnd(enc);
 }
 
 /**
  * @brief Service Routine for the Interrupt on Channel B.
  * @param gpio The GPIO Pin that triggered the Interrupt.
- * @param level The TTL level read from the Pin (0 or 1).
+ * @param level The TTL level read from the Pin: 0 or 1, 2 on a watchdog
+ *        timeout, which is recorded in the ring but not decoded.
  * @param event_ts_us The timestamp at which the Interrupt happened expressed
- *        in microseconds elapsed since boot. WARNING: this wraps around from
- *        4294967295 to 0 roughly every 72 minutes.
+ *        in microseconds elapsed since boot. It wraps around from 4294967295
+ *        to 0 roughly every 72 minutes, so it is extended to 64 bits with
+ *        cbTimeExtend() before being stored.
  * @param enc_gen A generic pointer to the cbEncoder_t structure containing
  *                the encoder parameters.
  */
 void cbEncoderISRb(int gpio, int level, uint32_t event_ts_us, void* enc_gen) {
     cbEncoder_t* enc = (cbEncoder_t*)enc_gen;
-    if (gpio == enc->last_gpio) return;  // Debounce
-    enc->last_gpio = gpio;
-    enc->level_b = level;
-    if (level ^ enc->level_a) {  // Either one of A or B is 1
-        enc->direction = backward;
-        enc->ticks += enc->direction;
-    } else {
-        enc->bad_ticks++;  // Self-diagnostics
+    uint64_t ts_us = cbTimeExtend(event_ts_us);
+    cbEncoderWriteBegin(enc);
+    cbEncoderPushEdge(enc, gpio, level, ts_us);
+    if (level <= 1) cbEncoderDecodeState(enc, 2, (unsigned int)level, ts_us);
+    cbEncoderWriteEnd(enc);
+}
+
+/**
+ * @brief Samples callback decoding a group of Encoders. Each sample carries
+ *        the levels of every pin, so all the Encoders that moved are decoded
+ *        from the same read, and the samples in which none of their pins
+ *        changed cost a single comparison.
+ * @param samples The samples, in chronological order.
+ * @param count The number of samples.
+ * @param group_gen A generic pointer to the cbEncoderGroup_t structure.
+ */
+void cbEncoderSamples(const cbHalSample_t* samples, int count,
+                      void* group_gen) {
+    cbEncoderGroup_t* group = (cbEncoderGroup_t*)group_gen;
+    for (int i = 0; i < count; i++) {
+        uint32_t levels = samples[i].level;
+        uint32_t changed = (levels ^ group->levels) & group->bits;
+        group->levels = levels;
+        if (!changed) continue;
+        uint64_t ts_us = cbTimeExtend(samples[i].tick);
+        for (unsigned int e = 0; e < group->count; e++) {
+            cbEncoder_t* enc = group->enc[e];
+            unsigned int a = (levels >> enc->pin_a) & 1;
+            unsigned int b = (levels >> enc->pin_b) & 1;
+            unsigned int moved = ((changed >> enc->pin_a) & 1) << 1 |
+                                 ((changed >> enc->pin_b) & 1);
+            if (!moved) continue;
+            cbEncoderWriteBegin(enc);
+            if (moved & 2) cbEncoderPushEdge(enc, enc->pin_a, (int)a, ts_us);
+            if (moved & 1) cbEncoderPushEdge(enc, enc->pin_b, (int)b, ts_us);
+            cbEncoderDecodeState(enc, 0, a << 1 | b, ts_us);
+            cbEncoderWriteEnd(enc);
+        }
+    }
+}
+
+/**
+ * @brief Initializes a group of Encoders to be decoded together.
+ * @param group A pointer to the group.
+ * @param encs The Encoders, which must not share pins.
+ * @param count The number of Encoders, at most CB_ENCODER_GROUP_MAX.
+ * @return A condition code.
+ */
+int cbEncoderGroupInit(cbEncoderGroup_t* group, cbEncoder_t* const* encs,
+                       unsigned int count) {
+    if (!count || count > CB_ENCODER_GROUP_MAX) return CB_ERANGE;
+    group->count = 0;
+    group->bits = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        cbEncoder_t* enc = encs[i];
+        if (enc->pin_a < 0 || enc->pin_a > 31 || enc->pin_b < 0 ||
+            enc->pin_b > 31) {
+            return CB_ERANGE;
+        }
+        uint32_t bits = 1u << enc->pin_a | 1u << enc->pin_b;
+        if (group->bits & bits) return CB_ERANGE;
+        group->bits |= bits;
+        group->enc[group->count++] = enc;
     }
+    group->levels = 0;
+    return CB_SUCCESS;
+}
+
+/**
+ * @brief Samples the levels of the pins of a group of Encoders, with a single
+ *        read, as the state the next sample is decoded against. Must be
+ *        called before decoding samples, like cbEncoderSync().
+ * @param group A pointer to the group.
+ */
+void cbEncoderGroupSync(cbEncoderGroup_t* group) {
+    uint32_t levels = cbHal->read_bank();
+    for (unsigned int i = 0; i < group->count; i++) {
+        cbEncoderSyncLevels(group->enc[i], levels);
+    }
+    group->levels = levels;
+}
+
+/**
+ * @brief Takes one sample of the pins of a group of Encoders with a single
+ *        read of the level register, and decodes it if any of them changed.
+ *        For polling the Encoders instead of registering callbacks.
+ * @param group A pointer to the group, synchronized with
+ *        cbEncoderGroupSync().
+ * @return Whether any of the pins changed.
+ */
+bool cbEncoderGroupPoll(cbEncoderGroup_t* group) {
+    uint32_t levels = cbHal->read_bank();
+    if (!((levels ^ group->levels) & group->bits)) return false;
+    cbHalSample_t sample = {cbHal->tick(), levels};
+    cbEncoderSamples(&sample, 1, group);
+    return true;
+}
+
+/**
+ * @brief Synchronizes the Encoders of a group with the levels of their pins
+ *        and registers a single callback decoding all of them, in place of
+ *        the ISRs of each Encoder.
+ * @param group A pointer to the group.
+ * @return A condition code.
+ * @link  https://abyz.me.uk/rpi/pigpio/cif.html#gpioSetGetSamplesFuncEx
+ */
+int cbEncoderGroupRegister(cbEncoderGroup_t* group) {
+    cbEncoderGroupSync(group);
+    if (cbHal->set_samples(group->bits, cbEncoderSamples, group) < 0) {
+        return CB_FAILURE;
+    }
+    return CB_SUCCESS;
+}
+
+/**
+ * @brief Unregisters the callback of a group of Encoders.
+ * @param group A pointer to the group.
+ */
+void cbEncoderGroupCancel(const cbEncoderGroup_t* group) {
+    (void)group;
+    cbHal->set_samples(0, NULL, NULL);
 }
@@ -0,0 +1,41 @@
+/**
+ * @file hal.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "hal.h"
+
+/**
+ * The backend in use, PiGPIO unless another one is selected or the library
+ * is built without PiGPIO, in which case the simulator is used.
+ */
+#ifndef CB_NO_PIGPIO
+const cbHal_t* cbHal = &cbHalPigpio;
+#else
+const cbHal_t* cbHal = &cbHalSim;
+#endif
+
+/**
+ * @brief Selects the backend used for the hardware operations. This must be
+ *        done before initializing the backend, motors and encoders.
+ * @param hal A pointer to the backend.
+ */
+void cbHalSelect(const cbHal_t* hal) { cbHal = hal; }
@@ -0,0 +1,393 @@
+/**
+ * @file hal_gpiomem.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cbdef.h"
+#include "hal.h"
+
+/* BCM2837 GPIO registers, as word offsets from the base of the GPIO block.
+ * See section 6.1 of docs/BCM2837-ARM-Peripherals.pdf.
+ */
+#define GPFSEL0 0  //< Function Select 0, 10 pins per register
+#define GPSET0 7  //< Pin Output Set 0
+#define GPCLR0 10  //< Pin Output Clear 0
+#define GPLEV0 13  //< Pin Level 0
+#define GPPUD 37  //< Pull-up/down Enable
+#define GPPUDCLK0 38  //< Pull-up/down Enable Clock 0
+
+#define BANK0_PINS 32
+
+/**
+ * The mapped register block, NULL until cbGpiomemOpen() succeeds.
+ */
+static volatile uint32_t* cbGpiomemRegs = NULL;
+
+/**
+ * @brief Maps the GPIO registers. On the Raspberry Pi `/dev/gpiomem` exposes
+ *        them to unprivileged users in the `gpio` group. Any other file can be
+ *        used as a fake register page, e.g. to exercise the backend on a
+ *        machine without GPIOs: a regular file is grown to the size of the
+ *        page if needed.
+ * @param path The path of the device or file, NULL for CB_GPIOMEM_PATH.
+ * @return A condition code.
+ */
+int cbGpiomemOpen(const char* path) {
+    struct stat st;
+    if (cbGpiomemRegs) return CB_SUCCESS;
+    int fd = open(path ? path : CB_GPIOMEM_PATH, O_RDWR | O_SYNC);
+    if (fd < 0) return CB_FAILURE;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) &&
+        st.st_size < CB_GPIOMEM_SIZE && ftruncate(fd, CB_GPIOMEM_SIZE) != 0) {
+        close(fd);
+        return CB_FAILURE;
+    }
+    void* regs = mmap(NULL, CB_GPIOMEM_SIZE, PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0);
+    close(fd);  // The mapping stays valid
+    if (regs == MAP_FAILED) return CB_FAILURE;
+    cbGpiomemRegs = (volatile uint32_t*)regs;
+    return CB_SUCCESS;
+}
+
+/**
+ * @brief Unmaps the GPIO registers.
+ */
+void cbGpiomemClose(void) {
+    if (!cbGpiomemRegs) return;
+    munmap((void*)cbGpiomemRegs, CB_GPIOMEM_SIZE);
+    cbGpiomemRegs = NULL;
+}
+
+/**
+ * @brief Waits for the 150 cycles required by the pull-up/down sequence.
+ */
+static inline void cbGpiomemSettle(void) {
+    struct timespec ts = {0, 1000};
+    nanosleep(&ts, NULL);
+}
+
+/* Pins are driven through the registers; PWM, ISRs, ticks and timers need
+ * PiGPIO's DMA and sampling threads, so they are delegated to it, and so are
+ * the I2C and SPI buses.
+ */
+
+static int cbGpiomemInit(void) {
+#ifndef CB_NO_PIGPIO
+    if (cbHalPigpio.init() != 0) return -CB_FAILURE;
+#endif
+    return cbGpiomemOpen(NULL) == CB_SUCCESS ? 0 : -CB_FAILURE;
+}
+
+static void cbGpiomemTerminate(void) {
+    cbGpiomemClose();
+#ifndef CB_NO_PIGPIO
+    cbHalPigpio.terminate();
+#endif
+}
+
+static int cbGpiomemSetMode(unsigned int gpio, unsigned int mode) {
+    if (gpio >= BANK0_PINS || mode > 7) return -CB_ERANGE;
+    volatile uint32_t* fsel = &cbGpiomemRegs[GPFSEL0 + gpio / 10];
+    unsigned int shift = (gpio % 10) * 3;
+    *fsel = (*fsel & ~(7u << shift)) | (mode << shift);
+    return 0;
+}
+
+static int cbGpiomemSetPull(unsigned int gpio, unsigned int pud) {
+    if (gpio >= BANK0_PINS || pud > CB_GPIO_PUD_UP) return -CB_ERANGE;
+    cbGpiomemRegs[GPPUD] = pud;
+    cbGpiomemSettle();
+    cbGpiomemRegs[GPPUDCLK0] = 1u << gpio;
+    cbGpiomemSettle();
+    cbGpiomemRegs[GPPUD] = 0;
+    cbGpiomemRegs[GPPUDCLK0] = 0;
+    return 0;
+}
+
+static int cbGpiomemRead(unsigned int gpio) {
+    if (gpio >= BANK0_PINS) return -CB_ERANGE;
+    return (cbGpiomemRegs[GPLEV0] >> gpio) & 1;
+}
+
+static int cbGpiomemWrite(unsigned int gpio, unsigned int level) {
+    if (gpio >= BANK0_PINS) return -CB_ERANGE;
+    cbGpiomemRegs[level ? GPSET0 : GPCLR0] = 1u << gpio;
+    return 0;
+}
+
+static int cbGpiomemTrigger(unsigned int gpio, unsigned int pulse_us,
+                            unsigned int level) {
+    if (gpio >= BANK0_PINS || pulse_us > 100 || level > 1) return -CB_ERANGE;
+    struct timespec ts = {0, pulse_us * 1000L};  // At least pulse_us
+    cbGpiomemRegs[level ? GPSET0 : GPCLR0] = 1u << gpio;
+    nanosleep(&ts, NULL);
+    cbGpiomemRegs[level ? GPCLR0 : GPSET0] = 1u << gpio;
+    return 0;
+}
+
+static uint32_t cbGpiomemReadBank(void) { return cbGpiomemRegs[GPLEV0]; }
+
+static int cbGpiomemSetBank(uint32_t bits) {
+    cbGpiomemRegs[GPSET0] = bits;
+    return 0;
+}
+
+static int cbGpiomemClearBank(uint32_t bits) {
+    cbGpiomemRegs[GPCLR0] = bits;
+    return 0;
+}
+
+#ifndef CB_NO_PIGPIO
+
+static int cbGpiomemPWM(unsigned int gpio, unsigned int duty) {
+    return cbHalPigpio.pwm(gpio, duty);
+}
+
+static int cbGpiomemSetPWMrange(unsigned int gpio, unsigned int range) {
+    return cbHalPigpio.set_pwm_range(gpio, range);
+}
+
+static int cbGpiomemSetPWMfreq(unsigned int gpio, unsigned int freq) {
+    return cbHalPigpio.set_pwm_freq(gpio, freq);
+}
+
+static int cbGpiomemGetPWMrealRange(unsigned int gpio) {
+    return cbHalPigpio.get_pwm_real_range(gpio);
+}
+
+static int cbGpiomemHwPWM(unsigned int gpio, unsigned int freq,
+                          uint32_t duty) {
+    return cbHalPigpio.hw_pwm(gpio, freq, duty);
+}
+
+static int cbGpiomemSetISR(unsigned int gpio, unsigned int edge, int timeout,
+                           cbHalISR_t isr, void* userdata) {
+    return cbHalPigpio.set_isr(gpio, edge, timeout, isr, userdata);
+}
+
+static int cbGpiomemSetSamples(uint32_t bits, cbHalSamples_t func,
+                               void* userdata) {
+    return cbHalPigpio.set_samples(bits, func, userdata);
+}
+
+static int cbGpiomemOpenNotify(uint32_t bits) {
+    return cbHalPigpio.open_notify(bits);
+}
+
+static int cbGpiomemCloseNotify(int fd) { return cbHalPigpio.close_notify(fd); }
+
+static uint32_t cbGpiomemTick(void) { return cbHalPigpio.tick(); }
+
+static int cbGpiomemSetTimer(unsigned int timer, unsigned int millis,
+                             cbHalTimer_t func, void* userdata) {
+    return cbHalPigpio.set_timer(timer, millis, func, userdata);
+}
+
+static int cbGpiomemI2cOpen(unsigned int bus, unsigned int addr) {
+    return cbHalPigpio.i2c_open(bus, addr);
+}
+
+static int cbGpiomemI2cClose(unsigned int handle) {
+    return cbHalPigpio.i2c_close(handle);
+}
+
+static int cbGpiomemI2cReadByte(unsigned int handle, unsigned int reg) {
+    return cbHalPigpio.i2c_read_byte(handle, reg);
+}
+
+static int cbGpiomemI2cWriteByte(unsigned int handle, unsigned int reg,
+                                 unsigned int value) {
+    return cbHalPigpio.i2c_write_byte(handle, reg, value);
+}
+
+static int cbGpiomemI2cReadBlock(unsigned int handle, unsigned int reg,
+                                 uint8_t* buf, unsigned int count) {
+    return cbHalPigpio.i2c_read_block(handle, reg, buf, count);
+}
+
+static int cbGpiomemSpiOpen(unsigned int channel, unsigned int baud) {
+    return cbHalPigpio.spi_open(channel, baud);
+}
+
+static int cbGpiomemSpiClose(unsigned int handle) {
+    return cbHalPigpio.spi_close(handle);
+}
+
+static int cbGpiomemSpiXfer(unsigned int handle, const uint8_t* tx,
+                            uint8_t* rx, unsigned int count) {
+    return cbHalPigpio.spi_xfer(handle, tx, rx, count);
+}
+
+#else  // Without PiGPIO there is nothing to delegate to
+
+static int cbGpiomemPWM(unsigned int gpio, unsigned int duty) {
+    (void)gpio, (void)duty;
+    return -CB_FAILURE;
+}
+
+static int cbGpiomemSetPWMrange(unsigned int gpio, unsigned int range) {
+    (void)gpio, (void)range;
+    return -CB_FAILURE;
+}
+
+static int cbGpiomemSetPWMfreq(unsigned int gpio, unsigned int freq) {
+    (void)gpio, (void)freq;
+    return -CB_FAILURE;
+}
+
+static int cbGpiomemGetPWMrealRange(unsigned int gpio) {
+    (void)gpio;
+    return -CB_FAILURE;
+}
+
+static int cbGpiomemHwPWM(unsigned int gpio, unsigned int freq,
+                          uint32_t duty) {
+    (void)gpio, (void)freq, (void)duty;
+    return -CB_FAILURE;
+}
+
+static int cbGpiomemSetISR(unsigned int gpio, unsigned int edge, int timeout,
+                           cbHalISR_t isr, void* userdata) {
+    (void)gpio, (void)edge, (void)timeout, (void)isr, (void)userdata;
+    return -CB_FAILURE;
+}
+
+static int cbGpiomemSetSamples(uint32_t bits, cbHalSamples_t func,
+                               void* userdata) {
+    (void)bits, (void)func, (void)userdata;
+    return -CB_FAILURE;
+}
+
+static int cbGpiomemOpenNotify(uint32_t bits) {
+    (void)bits;
+    return -CB_FAILURE;
+}
+
+static int cbGpiomemCloseNotify(int fd) {
+    (void)fd;
+    return -CB_FAILURE;
+}
+
+static uint32_t cbGpiomemTick(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+static int cbGpiomemSetTimer(unsigned int timer, unsigned int millis,
+                             cbHalTimer_t func, void* userdata) {
+    (void)timer, (void)millis, (void)func, (void)userdata;
+    return -CB_FAILURE;
+}
+
+static int cbGpiomemI2cOpen(unsigned int bus, unsigned int addr) {
+    (void)bus, (void)addr;
+    return -CB_FAILURE;
+}
+
+static int cbGpiomemI2cClose(unsigned int handle) {
+    (void)handle;
+    return -CB_FAILURE;
+}
+
+static int cbGpiomemI2cReadByte(unsigned int handle, unsigned int reg) {
+    (void)handle, (void)reg;
+    return -CB_FAILURE;
+}
+
+static int cbGpiomemI2cWriteByte(unsigned int handle, unsigned int reg,
+                                 unsigned int value) {
+    (void)handle, (void)reg, (void)value;
+    return -CB_FAILURE;
+}
+
+static int cbGpiomemI2cReadBlock(unsigned int handle, unsigned int reg,
+                                 uint8_t* buf, unsigned int count) {
+    (void)handle, (void)reg, (void)buf, (void)count;
+    return -CB_FAILURE;
+}
+
+static int cbGpiomemSpiOpen(unsigned int channel, unsigned int baud) {
+    (void)channel, (void)baud;
+    return -CB_FAILURE;
+}
+
+static int cbGpiomemSpiClose(unsigned int handle) {
+    (void)handle;
+    return -CB_FAILURE;
+}
+
+static int cbGpiomemSpiXfer(unsigned int handle, const uint8_t* tx,
+                            uint8_t* rx, unsigned int count) {
+    (void)handle, (void)tx, (void)rx, (void)count;
+    return -CB_FAILURE;
+}
+
+#endif  // CB_NO_PIGPIO
+
+/**
+ * The memory-mapped backend. Writes to GPSET/GPCLR and reads from GPLEV go
+ * straight to the registers, without going through PiGPIO. Only GPIO 0-31 are
+ * supported, which covers the whole 40-pin header. Either init() it, or call
+ * cbGpiomemOpen() after initializing PiGPIO.
+ */
+const cbHal_t cbHalGpiomem = {
+    .name = "gpiomem",
+    .init = cbGpiomemInit,
+    .terminate = cbGpiomemTerminate,
+    .set_mode = cbGpiomemSetMode,
+    .set_pull = cbGpiomemSetPull,
+    .read = cbGpiomemRead,
+    .write = cbGpiomemWrite,
+    .trigger = cbGpiomemTrigger,
+    .read_bank = cbGpiomemReadBank,
+    .set_bank = cbGpiomemSetBank,
+    .clear_bank = cbGpiomemClearBank,
+    .pwm = cbGpiomemPWM,
+    .set_pwm_range = cbGpiomemSetPWMrange,
+    .set_pwm_freq = cbGpiomemSetPWMfreq,
+    .get_pwm_real_range = cbGpiomemGetPWMrealRange,
+    .hw_pwm = cbGpiomemHwPWM,
+    .set_isr = cbGpiomemSetISR,
+    .set_samples = cbGpiomemSetSamples,
+    .open_notify = cbGpiomemOpenNotify,
+    .close_notify = cbGpiomemCloseNotify,
+    .tick = cbGpiomemTick,
+    .set_timer = cbGpiomemSetTimer,
+    .i2c_open = cbGpiomemI2cOpen,
+    .i2c_close = cbGpiomemI2cClose,
+    .i2c_read_byte = cbGpiomemI2cReadByte,
+    .i2c_write_byte = cbGpiomemI2cWriteByte,
+    .i2c_read_block = cbGpiomemI2cReadBlock,
+    .spi_open = cbGpiomemSpiOpen,
+    .spi_close = cbGpiomemSpiClose,
+    .spi_xfer = cbGpiomemSpiXfer,
+};
@@ -0,0 +1,248 @@
+/**
+ * @file hal_pigpio.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <pigpio.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "hal.h"
+
+#define CB_PIGPIO_NOTIFY_MAX 4 //< Notification pipes open at the same time
+#define CB_PIGPIO_I2C_BLOCK 32 //< Longest SMBus block read
+
+/* Thin wrappers around PiGPIO, which already implements every operation. */
+
+static int cbHalPigpioInit(void) { return gpioInitialise() < 0 ? -1 : 0; }
+
+static void cbHalPigpioTerminate(void) { gpioTerminate(); }
+
+static int cbHalPigpioSetMode(unsigned int gpio, unsigned int mode) {
+    return gpioSetMode(gpio, mode);
+}
+
+static int cbHalPigpioSetPull(unsigned int gpio, unsigned int pud) {
+    return gpioSetPullUpDown(gpio, pud);
+}
+
+static int cbHalPigpioRead(unsigned int gpio) { return gpioRead(gpio); }
+
+static int cbHalPigpioWrite(unsigned int gpio, unsigned int level) {
+    return gpioWrite(gpio, level);
+}
+
+static int cbHalPigpioTrigger(unsigned int gpio, unsigned int pulse_us,
+                              unsigned int level) {
+    return gpioTrigger(gpio, pulse_us, level);
+}
+
+static uint32_t cbHalPigpioReadBank(void) { return gpioRead_Bits_0_31(); }
+
+static int cbHalPigpioSetBank(uint32_t bits) {
+    return gpioWrite_Bits_0_31_Set(bits);
+}
+
+static int cbHalPigpioClearBank(uint32_t bits) {
+    return gpioWrite_Bits_0_31_Clear(bits);
+}
+
+static int cbHalPigpioPWM(unsigned int gpio, unsigned int duty) {
+    return gpioPWM(gpio, duty);
+}
+
+static int cbHalPigpioSetPWMrange(unsigned int gpio, unsigned int range) {
+    return gpioSetPWMrange(gpio, range);
+}
+
+static int cbHalPigpioSetPWMfreq(unsigned int gpio, unsigned int freq) {
+    return gpioSetPWMfrequency(gpio, freq);
+}
+
+static int cbHalPigpioGetPWMrealRange(unsigned int gpio) {
+    return gpioGetPWMrealRange(gpio);
+}
+
+static int cbHalPigpioHwPWM(unsigned int gpio, unsigned int freq,
+                            uint32_t duty) {
+    return gpioHardwarePWM(gpio, freq, duty);
+}
+
+static int cbHalPigpioSetISR(unsigned int gpio, unsigned int edge,
+                             int timeout, cbHalISR_t isr, void* userdata) {
+    return gpioSetISRFuncEx(gpio, edge, timeout, isr, userdata);
+}
+
+_Static_assert(sizeof(cbHalSample_t) == sizeof(gpioSample_t) &&
+                   offsetof(cbHalSample_t, level) ==
+                       offsetof(gpioSample_t, level),
+               "cbHalSample_t must match gpioSample_t");
+
+/* PiGPIO has a single samples callback, so one set of these is enough. */
+static cbHalSamples_t cbHalPigpioSamplesFunc;
+
+static void cbHalPigpioSamples(const gpioSample_t* samples, int count,
+                               void* userdata) {
+    cbHalPigpioSamplesFunc((const cbHalSample_t*)samples, count, userdata);
+}
+
+static int cbHalPigpioSetSamples(uint32_t bits, cbHalSamples_t func,
+                                 void* userdata) {
+    if (!func) return gpioSetGetSamplesFuncEx(NULL, 0, NULL);
+    cbHalPigpioSamplesFunc = func;
+    return gpioSetGetSamplesFuncEx(cbHalPigpioSamples, bits, userdata);
+}
+
+_Static_assert(sizeof(cbHalReport_t) == sizeof(gpioReport_t) &&
+                   offsetof(cbHalReport_t, tick) ==
+                       offsetof(gpioReport_t, tick) &&
+                   offsetof(cbHalReport_t, level) ==
+                       offsetof(gpioReport_t, level),
+               "cbHalReport_t must match gpioReport_t");
+
+/* The PiGPIO handle of each open pipe, to close it from the descriptor. */
+static struct {
+    int fd, handle;
+} cbHalPigpioNotify[CB_PIGPIO_NOTIFY_MAX] = {{-1, -1}, {-1, -1}, {-1, -1},
+                                             {-1, -1}};
+
+static int cbHalPigpioOpenNotify(uint32_t bits) {
+    char path[32];
+    int slot = 0;
+    while (slot < CB_PIGPIO_NOTIFY_MAX && cbHalPigpioNotify[slot].fd >= 0) {
+        slot++;
+    }
+    if (slot == CB_PIGPIO_NOTIFY_MAX) return -1;
+    int handle = gpioNotifyOpen();
+    if (handle < 0) return handle;
+    snprintf(path, sizeof(path), "/dev/pigpio%d", handle);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0 || gpioNotifyBegin(handle, bits) != 0) {
+        if (fd >= 0) close(fd);
+        gpioNotifyClose(handle);
+        return -1;
+    }
+    cbHalPigpioNotify[slot].fd = fd;
+    cbHalPigpioNotify[slot].handle = handle;
+    return fd;
+}
+
+static int cbHalPigpioCloseNotify(int fd) {
+    for (int slot = 0; slot < CB_PIGPIO_NOTIFY_MAX; slot++) {
+        if (cbHalPigpioNotify[slot].fd == fd) {
+            gpioNotifyClose(cbHalPigpioNotify[slot].handle);
+            close(fd);
+            cbHalPigpioNotify[slot].fd = cbHalPigpioNotify[slot].handle = -1;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static uint32_t cbHalPigpioTick(void) { return gpioTick(); }
+
+static int cbHalPigpioSetTimer(unsigned int timer, unsigned int millis,
+                               cbHalTimer_t func, void* userdata) {
+    return gpioSetTimerFuncEx(timer, millis, func, userdata);
+}
+
+static int cbHalPigpioI2cOpen(unsigned int bus, unsigned int addr) {
+    return i2cOpen(bus, addr, 0);
+}
+
+static int cbHalPigpioI2cClose(unsigned int handle) {
+    return i2cClose(handle);
+}
+
+static int cbHalPigpioI2cReadByte(unsigned int handle, unsigned int reg) {
+    return i2cReadByteData(handle, reg);
+}
+
+static int cbHalPigpioI2cWriteByte(unsigned int handle, unsigned int reg,
+                                   unsigned int value) {
+    return i2cWriteByteData(handle, reg, value);
+}
+
+/* SMBus block reads are limited to 32 bytes. Longer ones set the register
+ * pointer and then read the whole block straight from the device, which
+ * auto-increments it: two transactions, whatever the length.
+ */
+static int cbHalPigpioI2cReadBlock(unsigned int handle, unsigned int reg,
+                                   uint8_t* buf, unsigned int count) {
+    if (count <= CB_PIGPIO_I2C_BLOCK) {
+        return i2cReadI2CBlockData(handle, reg, (char*)buf, count);
+    }
+    int rc = i2cWriteByte(handle, reg);
+    return rc < 0 ? rc : i2cReadDevice(handle, (char*)buf, count);
+}
+
+static int cbHalPigpioSpiOpen(unsigned int channel, unsigned int baud) {
+    return spiOpen(channel, baud, 0);  // Mode 0, main SPI, CE active low
+}
+
+static int cbHalPigpioSpiClose(unsigned int handle) {
+    return spiClose(handle);
+}
+
+static int cbHalPigpioSpiXfer(unsigned int handle, const uint8_t* tx,
+                              uint8_t* rx, unsigned int count) {
+    return spiXfer(handle, (char*)tx, (char*)rx, count);  // tx is not written
+}
+
+/**
+ * The PiGPIO backend. PiGPIO must be initialized with `gpioInitialise()`.
+ */
+const cbHal_t cbHalPigpio = {
+    .name = "pigpio",
+    .init = cbHalPigpioInit,
+    .terminate = cbHalPigpioTerminate,
+    .set_mode = cbHalPigpioSetMode,
+    .set_pull = cbHalPigpioSetPull,
+    .read = cbHalPigpioRead,
+    .write = cbHalPigpioWrite,
+    .trigger = cbHalPigpioTrigger,
+    .read_bank = cbHalPigpioReadBank,
+    .set_bank = cbHalPigpioSetBank,
+    .clear_bank = cbHalPigpioClearBank,
+    .pwm = cbHalPigpioPWM,
+    .set_pwm_range = cbHalPigpioSetPWMrange,
+    .set_pwm_freq = cbHalPigpioSetPWMfreq,
+    .get_pwm_real_range = cbHalPigpioGetPWMrealRange,
+    .hw_pwm = cbHalPigpioHwPWM,
+    .set_isr = cbHalPigpioSetISR,
+    .set_samples = cbHalPigpioSetSamples,
+    .open_notify = cbHalPigpioOpenNotify,
+    .close_notify = cbHalPigpioCloseNotify,
+    .tick = cbHalPigpioTick,
+    .set_timer = cbHalPigpioSetTimer,
+    .i2c_open = cbHalPigpioI2cOpen,
+    .i2c_close = cbHalPigpioI2cClose,
+    .i2c_read_byte = cbHalPigpioI2cReadByte,
+    .i2c_write_byte = cbHalPigpioI2cWriteByte,
+    .i2c_read_block = cbHalPigpioI2cReadBlock,
+    .spi_open = cbHalPigpioSpiOpen,
+    .spi_close = cbHalPigpioSpiClose,
+    .spi_xfer = cbHalPigpioSpiXfer,
+};
@@ -0,0 +1,748 @@
+/**
+ * @file hal_sim.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "hal.h"
+#include "sim.h"
+
+#define SIM_PINS 32
+#define SIM_TIMERS 10
+#define HW_MAX_DUTY_CYC 1000000
+#define HW_PWM_CLOCK_HZ 250000000
+#define SIM_PI 3.14159265358979323846
+#define SIM_SOUND_MM_US .343 //< Speed of sound in air at 20 degrees C
+
+/**
+ * @brief The state of the simulated GPIO port. The simulation runs entirely
+ *        in the thread calling cbSimStep(), which is also the one the ISRs
+ *        and timers are called from: no locking is needed.
+ */
+static struct {
+    uint64_t now_us;
+    uint32_t levels;
+    unsigned int mode[SIM_PINS];
+    bool pwm[SIM_PINS], hw[SIM_PINS];
+    unsigned int duty[SIM_PINS], range[SIM_PINS], freq[SIM_PINS];
+    struct {
+        cbHalISR_t isr;
+        void* userdata;
+        unsigned int edge;
+    } isr[SIM_PINS];
+    struct {
+        cbHalSamples_t func;
+        void* userdata;
+        uint32_t bits;
+    } samples;
+    struct {
+        int fd_r, fd_w;  //< The pipe, fd_w is -1 if not open.
+        uint32_t bits;
+        uint16_t seqno;
+    } notify;
+    struct {
+        cbHalTimer_t func;
+        void* userdata;
+        uint64_t period_us, next_us;
+    } timer[SIM_TIMERS];
+    cbSimWheel_t* wheel[CB_SIM_MAX_WHEELS];
+    int wheels;
+    cbSimSonar_t* sonar[CB_SIM_MAX_SONARS];
+    int sonars;
+    cbSimImu_t* i2c[CB_SIM_MAX_I2C];  //< Indexed by the I2C handle.
+    int i2cs;
+    cbSimMcu_t* spi[CB_SIM_SPI_CHANNELS];  //< Indexed by the SPI handle.
+} sim;
+
+/**
+ * The time between slots of a simulated IMU in us, indexed by ODR_G.
+ */
+static const uint64_t cbSimImuPeriodUs[] = {0, 67114, 16807, 8403,
+                                            4202, 2101, 1050, 0};
+
+/**
+ * @brief Initializes a simulated wheel with the parameters of the CoderBot.
+ * @param wheel A pointer to the wheel.
+ * @param pin_fw The forward input of the motor driver.
+ * @param pin_bw The backward input of the motor driver.
+ * @param pin_a The Channel A output of the encoder.
+ * @param pin_b The Channel B output of the encoder.
+ */
+void cbSimWheelInit(cbSimWheel_t* wheel, cbGPIO_t pin_fw, cbGPIO_t pin_bw,
+                    cbGPIO_t pin_a, cbGPIO_t pin_b) {
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->pin_fw = pin_fw;
+    wheel->pin_bw = pin_bw;
+    wheel->pin_a = pin_a;
+    wheel->pin_b = pin_b;
+    wheel->noload_rps = 150.f;  // ~260 mm/s at the wheel
+    wheel->tau_s = .05f;
+    wheel->deadband = .1f;
+    wheel->edges_per_rev = 32;  // 16 ticks as counted by the encoder ISRs
+    wheel->gear_ratio = 120.f;
+    wheel->wheel_radius_mm = 33.f;
+}
+
+/**
+ * @brief Attaches a wheel to the simulation. Must be called after the
+ *        backend has been initialized. The encoder starts with both Channels
+ *        low.
+ * @param wheel A pointer to the wheel, which must outlive the simulation.
+ * @return A condition code.
+ */
+int cbSimAttachWheel(cbSimWheel_t* wheel) {
+    if (sim.wheels == CB_SIM_MAX_WHEELS) return CB_ERANGE;
+    if (wheel->pin_a < 0 || wheel->pin_a >= SIM_PINS || wheel->pin_b < 0 ||
+        wheel->pin_b >= SIM_PINS) {
+        return CB_ERANGE;
+    }
+    sim.levels &= ~((1u << wheel->pin_a) | (1u << wheel->pin_b));
+    wheel->speed_rps = wheel->angle_rev = 0.;
+    wheel->edge = 0;
+    sim.wheel[sim.wheels++] = wheel;
+    return CB_SUCCESS;
+}
+
+/**
+ * @brief Initializes a simulated sonar with the timings of an HC-SR04.
+ * @param sonar A pointer to the sonar.
+ * @param pin_trigger The trigger input of the sonar.
+ * @param pin_echo The echo output of the sonar.
+ * @param range_mm The distance of the obstacle, 0 if there is none. It can be
+ *        changed at any time and applies from the next trigger.
+ */
+void cbSimSonarInit(cbSimSonar_t* sonar, cbGPIO_t pin_trigger,
+                    cbGPIO_t pin_echo, float range_mm) {
+    memset(sonar, 0, sizeof(*sonar));
+    sonar->pin_trigger = pin_trigger;
+    sonar->pin_echo = pin_echo;
+    sonar->range_mm = range_mm;
+    sonar->delay_us = 450;  // The 8-cycle 40kHz burst and some processing
+    sonar->max_us = 38000;
+}
+
+/**
+ * @brief Attaches a sonar to the simulation. Must be called after the
+ *        backend has been initialized. The echo starts low.
+ * @param sonar A pointer to the sonar, which must outlive the simulation.
+ * @return A condition code.
+ */
+int cbSimAttachSonar(cbSimSonar_t* sonar) {
+    if (sim.sonars == CB_SIM_MAX_SONARS) return CB_ERANGE;
+    if (sonar->pin_trigger < 0 || sonar->pin_trigger >= SIM_PINS ||
+        sonar->pin_echo < 0 || sonar->pin_echo >= SIM_PINS) {
+        return CB_ERANGE;
+    }
+    sim.levels &= ~(1u << sonar->pin_echo);
+    sonar->rise_us = sonar->fall_us = 0;
+    sim.sonar[sim.sonars++] = sonar;
+    return CB_SUCCESS;
+}
+
+/**
+ * @brief Initializes a simulated IMU at the address of the LSM9DS1 of the
+ *        CoderBot, powered down like after a reset.
+ * @param imu A pointer to the IMU.
+ * @param recording The FIFO slots to replay, CB_IMU_SLOT_SIZE bytes each,
+ *        which must outlive the simulation.
+ * @param slots The number of slots in the recording, at least 1.
+ */
+void cbSimImuInit(cbSimImu_t* imu, const uint8_t* recording, size_t slots) {
+    memset(imu, 0, sizeof(*imu));
+    imu->bus = CB_IMU_BUS;
+    imu->addr = CB_IMU_ADDR;
+    imu->recording = recording;
+    imu->slots = slots;
+    imu->regs[CB_LSM9DS1_WHO_AM_I] = CB_IMU_ID;
+    imu->regs[CB_LSM9DS1_CTRL_REG8] = CB_LSM9DS1_IF_ADD_INC;
+}
+
+/**
+ * @brief Attaches an IMU to the simulated I2C bus. Must be called after the
+ *        backend has been initialized.
+ * @param imu A pointer to the IMU, which must outlive the simulation.
+ * @return A condition code.
+ */
+int cbSimAttachImu(cbSimImu_t* imu) {
+    if (sim.i2cs == CB_SIM_MAX_I2C) return CB_ERANGE;
+    if (!imu->recording || !imu->slots) return CB_ERANGE;
+    sim.i2c[sim.i2cs++] = imu;
+    return CB_SUCCESS;
+}
+
+/**
+ * @brief Initializes a simulated MCU, with no command received yet.
+ * @param mcu A pointer to the MCU.
+ * @param channel The SPI channel of the MCU.
+ */
+void cbSimMcuInit(cbSimMcu_t* mcu, unsigned int channel) {
+    memset(mcu, 0, sizeof(*mcu));
+    mcu->channel = channel;
+    mcu->ticks_per_s = 2000.f;  // The motor shaft at full speed, x2
+    mcu->status.flags = CB_MCU_TIMEOUT;
+}
+
+/**
+ * @brief Attaches an MCU to the simulated SPI bus. Must be called after the
+ *        backend has been initialized.
+ * @param mcu A pointer to the MCU, which must outlive the simulation.
+ * @return A condition code.
+ */
+int cbSimAttachMcu(cbSimMcu_t* mcu) {
+    if (mcu->channel >= CB_SIM_SPI_CHANNELS || sim.spi[mcu->channel]) {
+        return CB_ERANGE;
+    }
+    mcu->last_us = mcu->command_us = sim.now_us;
+    sim.spi[mcu->channel] = mcu;
+    return CB_SUCCESS;
+}
+
+/**
+ * @brief Returns the current simulated time.
+ * @return The simulated time in microseconds.
+ */
+uint64_t cbSimNowUs(void) { return sim.now_us; }
+
+/**
+ * @brief Returns the distance actually traveled by a simulated wheel, to be
+ *        compared with what the controller under test believes.
+ * @param wheel A pointer to the wheel.
+ * @return The distance traveled in mm, negative if backwards.
+ */
+double cbSimWheelTravelMm(const cbSimWheel_t* wheel) {
+    return wheel->angle_rev / wheel->gear_ratio * 2. * SIM_PI *
+           wheel->wheel_radius_mm;
+}
+
+/**
+ * @brief Returns the average level a pin drives the motor with.
+ * @param gpio The GPIO pin.
+ * @return The fraction of the supply voltage, in the range [0,1].
+ */
+static double cbSimDrive(cbGPIO_t gpio) {
+    if (gpio < 0 || gpio >= SIM_PINS) return 0.;
+    if (sim.hw[gpio]) return (double)sim.duty[gpio] / HW_MAX_DUTY_CYC;
+    if (sim.pwm[gpio]) return (double)sim.duty[gpio] / sim.range[gpio];
+    return (sim.levels >> gpio) & 1;
+}
+
+/**
+ * @brief Changes the level of a pin, calling its ISR if the edge matches and
+ *        delivering a sample if the pin is monitored.
+ * @param gpio The GPIO pin.
+ * @param level The new level.
+ * @param ts_us The simulated time of the edge.
+ */
+static void cbSimEdge(cbGPIO_t gpio, unsigned int level, uint64_t ts_us) {
+    if (level) sim.levels |= 1u << gpio;
+    else sim.levels &= ~(1u << gpio);
+    cbHalISR_t isr = sim.isr[gpio].isr;
+    unsigned int edge = sim.isr[gpio].edge;
+    if (isr && (edge == CB_EDGE_EITHER || (edge == CB_EDGE_RISING && level) ||
+                (edge == CB_EDGE_FALLING && !level))) {
+        isr(gpio, level, (uint32_t)ts_us, sim.isr[gpio].userdata);
+    }
+    if (sim.samples.func && (sim.samples.bits >> gpio) & 1) {
+        cbHalSample_t sample = {(uint32_t)ts_us, sim.levels};
+        sim.samples.func(&sample, 1, sim.samples.userdata);
+    }
+    if (sim.notify.fd_w >= 0 && (sim.notify.bits >> gpio) & 1) {
+        // Like PiGPIO, a report that does not fit in the pipe is lost
+        cbHalReport_t report = {sim.notify.seqno++, 0, (uint32_t)ts_us,
+                                sim.levels};
+        if (write(sim.notify.fd_w, &report, sizeof(report)) < 0) return;
+    }
+}
+
+/**
+ * @brief Integrates the motion of a wheel over a step and generates the
+ *        encoder edges crossed, timestamped by linear interpolation.
+ * @param wheel A pointer to the wheel.
+ * @param step_us The length of the step.
+ */
+static void cbSimWheelAdvance(cbSimWheel_t* wheel, uint64_t step_us) {
+    double dt = step_us / 1e6;
+    double drive = cbSimDrive(wheel->pin_fw) - cbSimDrive(wheel->pin_bw);
+    double target = 0.;
+    if (fabs(drive) > wheel->deadband) {
+        target = copysign(fabs(drive) - wheel->deadband, drive) /
+                 (1. - wheel->deadband) * wheel->noload_rps;
+    }
+    double speed0 = wheel->speed_rps, angle0 = wheel->angle_rev;
+    wheel->speed_rps += (target - speed0) * (1. - exp(-dt / wheel->tau_s));
+    wheel->angle_rev += (speed0 + wheel->speed_rps) / 2. * dt;
+    int64_t edge = (int64_t)floor(wheel->angle_rev * wheel->edges_per_rev);
+    while (wheel->edge != edge) {
+        int64_t next = wheel->edge + (edge > wheel->edge ? 1 : -1);
+        int64_t low = next < wheel->edge ? next : wheel->edge;
+        // Quadrature: 00 -> A -> 10 -> B -> 11 -> A -> 01 -> B -> 00
+        cbGPIO_t pin = (low & 1) ? wheel->pin_b : wheel->pin_a;
+        double boundary = (double)(low + 1) / wheel->edges_per_rev;
+        double frac = (boundary - angle0) / (wheel->angle_rev - angle0);
+        if (!(frac >= 0.)) frac = 0.;  // Also catches NaN
+        if (frac > 1.) frac = 1.;
+        wheel->edge = next;
+        cbSimEdge(pin, !((sim.levels >> pin) & 1),
+                  sim.now_us + (uint64_t)(frac * step_us));
+    }
+}
+
+/**
+ * @brief Delivers the echo edges of a sonar falling before a point in time.
+ * @param sonar A pointer to the sonar.
+ * @param end_us The end of the current step.
+ */
+static void cbSimSonarAdvance(cbSimSonar_t* sonar, uint64_t end_us) {
+    if (sonar->rise_us && sonar->rise_us <= end_us) {
+        cbSimEdge(sonar->pin_echo, 1, sonar->rise_us);
+        sonar->rise_us = 0;
+    }
+    if (!sonar->rise_us && sonar->fall_us && sonar->fall_us <= end_us) {
+        cbSimEdge(sonar->pin_echo, 0, sonar->fall_us);
+        sonar->fall_us = 0;
+    }
+}
+
+/**
+ * @brief Tells whether the FIFO of a simulated IMU is being filled.
+ * @param imu A pointer to the IMU.
+ * @return The period of the slots in us, 0 if the FIFO is not running.
+ */
+static uint64_t cbSimImuPeriod(const cbSimImu_t* imu) {
+    if (!(imu->regs[CB_LSM9DS1_CTRL_REG9] & CB_LSM9DS1_FIFO_EN) ||
+        imu->regs[CB_LSM9DS1_FIFO_CTRL] >> 5 == 0) {
+        return 0;
+    }
+    return cbSimImuPeriodUs[imu->regs[CB_LSM9DS1_CTRL_REG1_G] >> 5];
+}
+
+/**
+ * @brief Queues the slots of the recording due by the current time. A full
+ *        FIFO loses its oldest slot, as in continuous mode.
+ * @param imu A pointer to the IMU.
+ */
+static void cbSimImuAdvance(cbSimImu_t* imu) {
+    uint64_t period_us = cbSimImuPeriod(imu);
+    if (!period_us) return;
+    for (; imu->next_us <= sim.now_us; imu->next_us += period_us) {
+        unsigned int last = (imu->first + imu->level) % CB_IMU_FIFO_SLOTS;
+        if (imu->level == CB_IMU_FIFO_SLOTS) {
+            imu->first = (imu->first + 1) % CB_IMU_FIFO_SLOTS;
+            imu->overrun = true;
+        } else {
+            imu->level++;
+        }
+        memcpy(imu->fifo[last], &imu->recording[imu->next * CB_IMU_SLOT_SIZE],
+               CB_IMU_SLOT_SIZE);
+        imu->next = (imu->next + 1) % imu->slots;
+    }
+}
+
+/**
+ * @brief Reads a register of a simulated IMU. Reading the last byte of a
+ *        slot pops it, leaving it in the output registers.
+ * @param imu A pointer to the IMU.
+ * @param reg The register.
+ * @return The value of the register.
+ */
+static uint8_t cbSimImuRead(cbSimImu_t* imu, unsigned int reg) {
+    if (reg == CB_LSM9DS1_FIFO_SRC) {
+        unsigned int fth = imu->regs[CB_LSM9DS1_FIFO_CTRL] & 0x1F;
+        return (uint8_t)(imu->level | (imu->overrun ? CB_LSM9DS1_OVRN : 0) |
+                         (fth && imu->level >= fth ? 0x80 : 0));
+    }
+    if (reg == CB_LSM9DS1_OUT_X_L_G && imu->level) {  // Loads the oldest slot
+        memcpy(&imu->regs[CB_LSM9DS1_OUT_X_L_G], imu->fifo[imu->first], 6);
+        memcpy(&imu->regs[CB_LSM9DS1_OUT_X_L_XL], &imu->fifo[imu->first][6],
+               6);
+    }
+    uint8_t value = imu->regs[reg & 0x7F];
+    if (reg == CB_LSM9DS1_OUT_Z_H_XL && imu->level) {
+        imu->first = (imu->first + 1) % CB_IMU_FIFO_SLOTS;
+        imu->level--;
+        imu->overrun = false;
+    }
+    return value;
+}
+
+/**
+ * @brief Advances the simulation. Edges and timers falling in the interval
+ *        are delivered from the calling thread, as fast as the host can
+ *        compute them.
+ * @param dt_us The simulated time to advance by.
+ */
+void cbSimStep(uint64_t dt_us) {
+    uint64_t end_us = sim.now_us + dt_us;
+    while (sim.now_us < end_us) {
+        uint64_t step_us = end_us - sim.now_us;
+        if (step_us > CB_SIM_STEP_US) step_us = CB_SIM_STEP_US;
+        for (int i = 0; i < sim.wheels; i++) {
+            cbSimWheelAdvance(sim.wheel[i], step_us);
+        }
+        for (int i = 0; i < sim.sonars; i++) {
+            cbSimSonarAdvance(sim.sonar[i], sim.now_us + step_us);
+        }
+        sim.now_us += step_us;
+        for (int t = 0; t < SIM_TIMERS; t++) {
+            if (sim.timer[t].func && sim.timer[t].next_us <= sim.now_us) {
+                sim.timer[t].next_us += sim.timer[t].period_us;
+                sim.timer[t].func(sim.timer[t].userdata);
+            }
+        }
+    }
+}
+
+/* Backend operations. Pulls are accepted but have no effect, as the levels
+ * of the inputs are set by the simulated devices. Watchdog timeouts are not
+ * simulated.
+ */
+
+static int cbSimInit(void) {
+    memset(&sim, 0, sizeof(sim));
+    sim.now_us = CB_SIM_EPOCH_US;
+    sim.notify.fd_r = sim.notify.fd_w = -1;
+    return 0;
+}
+
+static void cbSimTerminate(void) {
+    sim.wheels = sim.sonars = sim.i2cs = 0;
+    sim.spi[0] = sim.spi[1] = NULL;
+    if (sim.notify.fd_w >= 0) {
+        close(sim.notify.fd_w);
+        close(sim.notify.fd_r);
+        sim.notify.fd_r = sim.notify.fd_w = -1;
+    }
+}
+
+static int cbSimSetMode(unsigned int gpio, unsigned int mode) {
+    if (gpio >= SIM_PINS) return -CB_ERANGE;
+    sim.mode[gpio] = mode;
+    return 0;
+}
+
+static int cbSimSetPull(unsigned int gpio, unsigned int pud) {
+    if (gpio >= SIM_PINS || pud > CB_GPIO_PUD_UP) return -CB_ERANGE;
+    return 0;
+}
+
+static int cbSimRead(unsigned int gpio) {
+    if (gpio >= SIM_PINS) return -CB_ERANGE;
+    return (sim.levels >> gpio) & 1;
+}
+
+static int cbSimWrite(unsigned int gpio, unsigned int level) {
+    if (gpio >= SIM_PINS) return -CB_ERANGE;
+    sim.pwm[gpio] = sim.hw[gpio] = false;  // Like PiGPIO, stops the PWM
+    sim.mode[gpio] = CB_GPIO_OUTPUT;
+    if (level) sim.levels |= 1u << gpio;
+    else sim.levels &= ~(1u << gpio);
+    return 0;
+}
+
+static int cbSimTrigger(unsigned int gpio, unsigned int pulse_us,
+                        unsigned int level) {
+    if (gpio >= SIM_PINS || pulse_us > 100 || level > 1) return -CB_ERANGE;
+    sim.pwm[gpio] = sim.hw[gpio] = false;
+    sim.mode[gpio] = CB_GPIO_OUTPUT;
+    if (level) sim.levels &= ~(1u << gpio);  // Back to the idle level
+    else sim.levels |= 1u << gpio;
+    for (int i = 0; i < sim.sonars; i++) {
+        cbSimSonar_t* sonar = sim.sonar[i];
+        if (!level || sonar->pin_trigger != (cbGPIO_t)gpio ||
+            sonar->rise_us || sonar->fall_us) {
+            continue;
+        }
+        uint64_t length_us = sonar->max_us;
+        if (sonar->range_mm > 0.f &&
+            sonar->range_mm * 2. / SIM_SOUND_MM_US < sonar->max_us) {
+            length_us = (uint64_t)(sonar->range_mm * 2. / SIM_SOUND_MM_US);
+        }
+        sonar->rise_us = sim.now_us + pulse_us + sonar->delay_us;
+        sonar->fall_us = sonar->rise_us + length_us;
+    }
+    return 0;
+}
+
+static uint32_t cbSimReadBank(void) { return sim.levels; }
+
+static int cbSimSetBank(uint32_t bits) {
+    sim.levels |= bits;
+    return 0;
+}
+
+static int cbSimClearBank(uint32_t bits) {
+    sim.levels &= ~bits;
+    return 0;
+}
+
+static int cbSimPWM(unsigned int gpio, unsigned int duty) {
+    if (gpio >= SIM_PINS || duty > sim.range[gpio]) return -CB_ERANGE;
+    sim.pwm[gpio] = true;
+    sim.hw[gpio] = false;
+    sim.duty[gpio] = duty;
+    return 0;
+}
+
+static int cbSimSetPWMrange(unsigned int gpio, unsigned int range) {
+    if (gpio >= SIM_PINS || !range) return -CB_ERANGE;
+    sim.range[gpio] = range;
+    return 0;
+}
+
+static int cbSimSetPWMfreq(unsigned int gpio, unsigned int freq) {
+    if (gpio >= SIM_PINS) return -CB_ERANGE;
+    sim.freq[gpio] = freq;
+    return 0;
+}
+
+static int cbSimGetPWMrealRange(unsigned int gpio) {
+    if (gpio >= SIM_PINS) return -CB_ERANGE;
+    if (sim.hw[gpio]) return HW_PWM_CLOCK_HZ / sim.freq[gpio];
+    return sim.range[gpio];
+}
+
+static int cbSimHwPWM(unsigned int gpio, unsigned int freq, uint32_t duty) {
+    if (gpio != 12 && gpio != 13 && gpio != 18 && gpio != 19) return -1;
+    if (!freq || duty > HW_MAX_DUTY_CYC) return -CB_ERANGE;
+    sim.hw[gpio] = true;
+    sim.pwm[gpio] = false;
+    sim.freq[gpio] = freq;
+    sim.duty[gpio] = duty;
+    return 0;
+}
+
+static int cbSimSetISR(unsigned int gpio, unsigned int edge, int timeout,
+                       cbHalISR_t isr, void* userdata) {
+    (void)timeout;
+    if (gpio >= SIM_PINS || edge > CB_EDGE_EITHER) return -CB_ERANGE;
+    sim.isr[gpio].isr = isr;
+    sim.isr[gpio].edge = edge;
+    sim.isr[gpio].userdata = userdata;
+    return 0;
+}
+
+static int cbSimSetSamples(uint32_t bits, cbHalSamples_t func,
+                           void* userdata) {
+    sim.samples.func = func;
+    sim.samples.bits = bits;
+    sim.samples.userdata = userdata;
+    return 0;
+}
+
+static int cbSimOpenNotify(uint32_t bits) {
+    int fds[2];
+    if (sim.notify.fd_w >= 0 || pipe(fds) != 0) return -1;
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+    sim.notify.fd_r = fds[0];
+    sim.notify.fd_w = fds[1];
+    sim.notify.bits = bits;
+    sim.notify.seqno = 0;
+    return fds[0];
+}
+
+static int cbSimCloseNotify(int fd) {
+    if (sim.notify.fd_w < 0 || fd != sim.notify.fd_r) return -1;
+    close(sim.notify.fd_w);
+    close(sim.notify.fd_r);
+    sim.notify.fd_r = sim.notify.fd_w = -1;
+    return 0;
+}
+
+/* The simulated I2C bus. Handles are indices of the attached devices. */
+
+static cbSimImu_t* cbSimI2cDevice(unsigned int handle) {
+    if (handle >= (unsigned int)sim.i2cs) return NULL;
+    sim.i2c[handle]->transfers++;
+    cbSimImuAdvance(sim.i2c[handle]);
+    return sim.i2c[handle];
+}
+
+static int cbSimI2cOpen(unsigned int bus, unsigned int addr) {
+    for (int i = 0; i < sim.i2cs; i++) {
+        if (sim.i2c[i]->bus == bus && sim.i2c[i]->addr == addr) return i;
+    }
+    return -CB_FAILURE;
+}
+
+static int cbSimI2cClose(unsigned int handle) {
+    return handle < (unsigned int)sim.i2cs ? 0 : -CB_FAILURE;
+}
+
+static int cbSimI2cReadByte(unsigned int handle, unsigned int reg) {
+    cbSimImu_t* imu = cbSimI2cDevice(handle);
+    if (!imu || reg > 0x7F) return -CB_FAILURE;
+    return cbSimImuRead(imu, reg);
+}
+
+static int cbSimI2cWriteByte(unsigned int handle, unsigned int reg,
+                             unsigned int value) {
+    cbSimImu_t* imu = cbSimI2cDevice(handle);
+    if (!imu || reg > 0x7F || value > 0xFF) return -CB_FAILURE;
+    bool running = cbSimImuPeriod(imu) != 0;
+    imu->regs[reg] = (uint8_t)value;
+    if (reg == CB_LSM9DS1_FIFO_CTRL && value >> 5 == 0) {
+        imu->level = 0;  // Bypass mode empties the FIFO
+        imu->overrun = false;
+    }
+    uint64_t period_us = cbSimImuPeriod(imu);
+    if (!running && period_us) imu->next_us = sim.now_us + period_us;
+    return 0;
+}
+
+/* With the FIFO enabled, the address jumps from the gyroscope to the
+ * accelerometer, and from the end of the slot back to its beginning.
+ */
+static int cbSimI2cReadBlock(unsigned int handle, unsigned int reg,
+                             uint8_t* buf, unsigned int count) {
+    cbSimImu_t* imu = cbSimI2cDevice(handle);
+    if (!imu || reg > 0x7F) return -CB_FAILURE;
+    bool fifo = imu->regs[CB_LSM9DS1_CTRL_REG9] & CB_LSM9DS1_FIFO_EN;
+    for (unsigned int i = 0; i < count; i++) {
+        buf[i] = cbSimImuRead(imu, reg);
+        if (fifo && reg == CB_LSM9DS1_OUT_X_L_G + 5) {
+            reg = CB_LSM9DS1_OUT_X_L_XL;
+        } else if (fifo && reg == CB_LSM9DS1_OUT_Z_H_XL) {
+            reg = CB_LSM9DS1_OUT_X_L_G;
+        } else {
+            reg = (reg + 1) & 0x7F;
+        }
+    }
+    return (int)count;
+}
+
+/* The simulated SPI bus. Handles are the channels. */
+
+static int cbSimSpiOpen(unsigned int channel, unsigned int baud) {
+    if (channel >= CB_SIM_SPI_CHANNELS || !baud) return -CB_ERANGE;
+    return (int)channel;
+}
+
+static int cbSimSpiClose(unsigned int handle) {
+    return handle < CB_SIM_SPI_CHANNELS ? 0 : -CB_FAILURE;
+}
+
+/* Like the firmware, the MCU prepares the status as the transfer starts, and
+ * decodes the command once it has been shifted in.
+ */
+static int cbSimSpiXfer(unsigned int handle, const uint8_t* tx, uint8_t* rx,
+                        unsigned int count) {
+    if (handle >= CB_SIM_SPI_CHANNELS) return -CB_FAILURE;
+    cbSimMcu_t* mcu = sim.spi[handle];
+    if (!mcu) {
+        memmove(rx, tx, count);
+        return (int)count;
+    }
+    if (count != CB_MCU_FRAME_SIZE) return -CB_FAILURE;
+    mcu->transfers++;
+    if (sim.now_us - mcu->command_us > CB_MCU_WATCHDOG_US) {
+        mcu->command.flags &= ~CB_MCU_ENABLE;
+        mcu->status.flags |= CB_MCU_TIMEOUT;
+    }
+    if (mcu->command.flags & CB_MCU_ENABLE) {
+        double dt = (sim.now_us - mcu->last_us) / 1e6;
+        for (int i = 0; i < 2; i++) {
+            mcu->count[i] += mcu->command.duty[i] / 32767. * mcu->ticks_per_s *
+                             dt;
+        }
+    }
+    mcu->last_us = sim.now_us;
+    mcu->status.count[0] = (int32_t)(int64_t)floor(mcu->count[0]);
+    mcu->status.count[1] = (int32_t)(int64_t)floor(mcu->count[1]);
+    cbMcuPackStatus(&mcu->status, rx);
+    mcu->status.seq++;
+    if (mcu->corrupt_every && mcu->transfers % mcu->corrupt_every == 0) {
+        rx[4] ^= 0x10;
+    }
+    uint8_t frame[CB_MCU_FRAME_SIZE];
+    memcpy(frame, tx, sizeof(frame));
+    if (mcu->garble_every && mcu->transfers % mcu->garble_every == 0) {
+        frame[5] ^= 0x01;
+    }
+    cbMcuCommand_t command;
+    if (cbMcuUnpackCommand(frame, &command) != CB_SUCCESS) {
+        mcu->status.crc_errors++;
+        mcu->status.flags |= CB_MCU_BAD_CRC;
+        return (int)count;
+    }
+    if (command.flags & CB_MCU_CLEAR) mcu->count[0] = mcu->count[1] = 0.;
+    mcu->command = command;
+    mcu->command_us = sim.now_us;
+    mcu->status.ack = command.seq;
+    mcu->status.flags = 0;
+    return (int)count;
+}
+
+static uint32_t cbSimTick(void) { return (uint32_t)sim.now_us; }
+
+static int cbSimSetTimer(unsigned int timer, unsigned int millis,
+                         cbHalTimer_t func, void* userdata) {
+    if (timer >= SIM_TIMERS || (func && !millis)) return -CB_ERANGE;
+    sim.timer[timer].func = func;
+    sim.timer[timer].userdata = userdata;
+    sim.timer[timer].period_us = millis * 1000ULL;
+    sim.timer[timer].next_us = sim.now_us + millis * 1000ULL;
+    return 0;
+}
+
+/**
+ * The simulation backend. Time only advances with cbSimStep(), so programs
+ * run as fast as the host allows and are fully deterministic.
+ */
+const cbHal_t cbHalSim = {
+    .name = "sim",
+    .init = cbSimInit,
+    .terminate = cbSimTerminate,
+    .set_mode = cbSimSetMode,
+    .set_pull = cbSimSetPull,
+    .read = cbSimRead,
+    .write = cbSimWrite,
+    .trigger = cbSimTrigger,
+    .read_bank = cbSimReadBank,
+    .set_bank = cbSimSetBank,
+    .clear_bank = cbSimClearBank,
+    .pwm = cbSimPWM,
+    .set_pwm_range = cbSimSetPWMrange,
+    .set_pwm_freq = cbSimSetPWMfreq,
+    .get_pwm_real_range = cbSimGetPWMrealRange,
+    .hw_pwm = cbSimHwPWM,
+    .set_isr = cbSimSetISR,
+    .set_samples = cbSimSetSamples,
+    .open_notify = cbSimOpenNotify,
+    .close_notify = cbSimCloseNotify,
+    .tick = cbSimTick,
+    .set_timer = cbSimSetTimer,
+    .i2c_open = cbSimI2cOpen,
+    .i2c_close = cbSimI2cClose,
+    .i2c_read_byte = cbSimI2cReadByte,
+    .i2c_write_byte = cbSimI2cWriteByte,
+    .i2c_read_block = cbSimI2cReadBlock,
+    .spi_open = cbSimSpiOpen,
+    .spi_close = cbSimSpiClose,
+    .spi_xfer = cbSimSpiXfer,
+};
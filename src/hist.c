@@ -0,0 +1,97 @@
+/**
+ * @file hist.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "hist.h"
+
+/**
+ * @brief Empties a histogram. Must not race with the writer.
+ * @param hist A pointer to the histogram.
+ */
+void cbHistInit(cbHist_t* hist) {
+    atomic_init(&hist->count, 0);
+    atomic_init(&hist->sum, 0);
+    atomic_init(&hist->max, 0);
+    for (unsigned int i = 0; i < CB_HIST_BUCKETS; i++) {
+        atomic_init(&hist->bucket[i], 0);
+    }
+}
+
+/**
+ * @brief Returns the smallest value falling in a bucket.
+ */
+static uint64_t cbHistBucketBase(unsigned int index) {
+    if (index < CB_HIST_SUB) return index;
+    unsigned int exp = index / CB_HIST_SUB + CB_HIST_SUB_BITS - 1;
+    uint64_t sub = index % CB_HIST_SUB;
+    return (CB_HIST_SUB + sub) << (exp - CB_HIST_SUB_BITS);
+}
+
+/**
+ * @brief Returns the largest value falling in a bucket.
+ * @param index The index of the bucket.
+ * @return The upper bound of the bucket, inclusive.
+ */
+uint64_t cbHistBucketLimit(unsigned int index) {
+    if (index >= CB_HIST_BUCKETS - 1) return UINT64_MAX;
+    return cbHistBucketBase(index + 1) - 1;
+}
+
+/**
+ * @brief Computes a percentile. Can be called while the writer is running.
+ * @param hist A pointer to the histogram.
+ * @param percent The percentile, between 0 and 100.
+ * @return The upper bound of the bucket the percentile falls in, capped at
+ *         the maximum, or 0 if the histogram is empty.
+ */
+uint64_t cbHistPercentile(const cbHist_t* hist, double percent) {
+    uint64_t count = atomic_load_explicit(&hist->count, memory_order_acquire);
+    uint64_t max = atomic_load_explicit(&hist->max, memory_order_relaxed);
+    if (count == 0) return 0;
+    double exact = count * percent / 100.;
+    uint64_t rank = (uint64_t)exact;
+    if (rank < exact || rank == 0) rank++;
+    uint64_t seen = 0;
+    for (unsigned int i = 0; i < CB_HIST_BUCKETS; i++) {
+        seen += atomic_load_explicit(&hist->bucket[i], memory_order_relaxed);
+        if (seen >= rank) {
+            uint64_t limit = cbHistBucketLimit(i);
+            return limit < max ? limit : max;
+        }
+    }
+    return max;
+}
+
+/**
+ * @brief Summarizes a histogram. Can be called while the writer is running.
+ * @param hist A pointer to the histogram.
+ * @param summary A pointer to the summary to fill.
+ */
+void cbHistSummarize(const cbHist_t* hist, cbHistSummary_t* summary) {
+    summary->count = atomic_load_explicit(&hist->count, memory_order_acquire);
+    uint64_t sum = atomic_load_explicit(&hist->sum, memory_order_relaxed);
+    summary->mean = summary->count ? sum / summary->count : 0;
+    summary->p50 = cbHistPercentile(hist, 50.);
+    summary->p90 = cbHistPercentile(hist, 90.);
+    summary->p99 = cbHistPercentile(hist, 99.);
+    summary->max = atomic_load_explicit(&hist->max, memory_order_relaxed);
+}
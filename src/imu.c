@@ -0,0 +1,197 @@
+/**
+ * @file imu.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "imu.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cbdef.h"
+#include "hal.h"
+#include "timebase.h"
+
+/**
+ * The time between samples in us, indexed by ODR_G.
+ */
+static const uint32_t cbImuPeriodUs[] = {0, 67114, 16807, 8403,
+                                         4202, 2101, 1050};
+
+/**
+ * The sensitivities of the gyroscope in deg/s, indexed by FS_G, and of the
+ * accelerometer in g, indexed by FS_XL. See table 3 of the datasheet.
+ */
+static const float cbImuGyroDps[] = {.00875f, .0175f, 0.f, .07f};
+static const float cbImuAccelG[] = {.000061f, .000732f, .000122f, .000244f};
+
+/**
+ * @brief Opens the accelerometer and gyroscope of an LSM9DS1 and starts them
+ *        at the configured rate, with the FIFO in continuous mode so that
+ *        cbImuPoll() can collect every sample in one burst.
+ * @param imu A pointer to the IMU.
+ * @return CB_SUCCESS, CB_ERANGE for an invalid configuration, CB_ENOMODE if
+ *         the device is not an LSM9DS1, or CB_FAILURE on a bus error.
+ */
+int cbImuOpen(cbImu_t* imu) {
+    if (imu->odr < CB_IMU_ODR_15HZ || imu->odr > CB_IMU_ODR_952HZ ||
+        imu->gyro_fs > 3 || !cbImuGyroDps[imu->gyro_fs] ||
+        imu->accel_fs > 3) {
+        return CB_ERANGE;
+    }
+    int handle = cbHal->i2c_open(imu->bus, imu->addr);
+    if (handle < 0) return CB_FAILURE;
+    if (cbHal->i2c_read_byte(handle, CB_LSM9DS1_WHO_AM_I) != CB_IMU_ID) {
+        cbHal->i2c_close(handle);
+        return CB_ENOMODE;
+    }
+    const uint8_t config[][2] = {
+        {CB_LSM9DS1_CTRL_REG8, CB_LSM9DS1_BDU | CB_LSM9DS1_IF_ADD_INC},
+        {CB_LSM9DS1_CTRL_REG1_G, imu->odr << 5 | imu->gyro_fs << 3},
+        {CB_LSM9DS1_CTRL_REG6_XL, imu->odr << 5 | imu->accel_fs << 3},
+        {CB_LSM9DS1_FIFO_CTRL, CB_LSM9DS1_FMODE_BYPASS},  // Empties it
+        {CB_LSM9DS1_CTRL_REG9, CB_LSM9DS1_FIFO_EN},
+        {CB_LSM9DS1_FIFO_CTRL, CB_LSM9DS1_FMODE_CONT},
+    };
+    for (size_t i = 0; i < sizeof(config) / sizeof(config[0]); i++) {
+        if (cbHal->i2c_write_byte(handle, config[i][0], config[i][1]) < 0) {
+            cbHal->i2c_close(handle);
+            return CB_FAILURE;
+        }
+    }
+    imu->handle = handle;
+    imu->period_us = cbImuPeriodUs[imu->odr];
+    imu->gyro_dps = cbImuGyroDps[imu->gyro_fs];
+    imu->accel_g = cbImuAccelG[imu->accel_fs];
+    imu->overruns = imu->transfers = 0;
+    atomic_store(&imu->ring.head, 0);
+    atomic_store(&imu->ring.tail, 0);
+    atomic_store(&imu->ring.dropped, 0);
+    return CB_SUCCESS;
+}
+
+/**
+ * @brief Powers the accelerometer and gyroscope down and closes the device.
+ * @param imu A pointer to the IMU.
+ */
+void cbImuClose(cbImu_t* imu) {
+    cbHal->i2c_write_byte(imu->handle, CB_LSM9DS1_FIFO_CTRL,
+                          CB_LSM9DS1_FMODE_BYPASS);
+    cbHal->i2c_write_byte(imu->handle, CB_LSM9DS1_CTRL_REG1_G, 0);
+    cbHal->i2c_write_byte(imu->handle, CB_LSM9DS1_CTRL_REG6_XL, 0);
+    cbHal->i2c_close(imu->handle);
+}
+
+/**
+ * @brief Reads a little endian 16-bit value.
+ * @param p A pointer to the low byte.
+ * @return The value.
+ */
+static inline int16_t cbImuLe16(const uint8_t* p) {
+    return (int16_t)(p[0] | p[1] << 8);
+}
+
+/**
+ * @brief Collects the samples in the FIFO and pushes them to the ring. Costs
+ *        two I2C operations of the HAL whatever the number of samples, one
+ *        for the level of the FIFO and one for the burst, so polling at the
+ *        rate of the control loop amortizes them over several samples. On
+ *        PiGPIO a burst of more than 32 bytes is two bus transactions, which
+ *        makes three for a poll of three samples or more. The newest
+ *        sample is timestamped with the time of the poll on the timebase of
+ *        the Encoders, which must be initialized, and the older ones at the
+ *        nominal period before it.
+ * @param imu A pointer to the IMU.
+ * @return The number of samples collected, -1 on a bus error. Samples that
+ *         do not fit in the ring are counted in its dropped field.
+ */
+int cbImuPoll(cbImu_t* imu) {
+    uint8_t buf[CB_IMU_FIFO_SLOTS * CB_IMU_SLOT_SIZE];
+    int src = cbHal->i2c_read_byte(imu->handle, CB_LSM9DS1_FIFO_SRC);
+    imu->transfers++;
+    if (src < 0) return -1;
+    if (src & CB_LSM9DS1_OVRN) imu->overruns++;
+    unsigned int count = src & CB_LSM9DS1_FSS;
+    if (count > CB_IMU_FIFO_SLOTS) count = CB_IMU_FIFO_SLOTS;
+    if (!count) return 0;
+    uint64_t now_us = cbTimeNowUs();
+    unsigned int length = count * CB_IMU_SLOT_SIZE;
+    int rc = cbHal->i2c_read_block(imu->handle, CB_LSM9DS1_OUT_X_L_G, buf,
+                                   length);
+    imu->transfers++;
+    if (rc != (int)length) return -1;
+    cbImuRing_t* ring = &imu->ring;
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    for (unsigned int k = 0; k < count; k++) {
+        if (head - tail == CB_IMU_RING_SIZE) {
+            atomic_fetch_add_explicit(&ring->dropped, count - k,
+                                      memory_order_relaxed);
+            break;
+        }
+        const uint8_t* slot = &buf[k * CB_IMU_SLOT_SIZE];
+        cbImuSample_t* sample = &ring->samples[head & (CB_IMU_RING_SIZE - 1)];
+        sample->ts_us = now_us - (uint64_t)(count - 1 - k) * imu->period_us;
+        for (int axis = 0; axis < 3; axis++) {
+            sample->gyro[axis] = cbImuLe16(&slot[2 * axis]);
+            sample->accel[axis] = cbImuLe16(&slot[6 + 2 * axis]);
+        }
+        head++;
+    }
+    atomic_store_explicit(&ring->head, head, memory_order_release);
+    return (int)count;
+}
+
+/**
+ * @brief Returns a batch of samples collected by cbImuPoll(), oldest first,
+ *        which stay valid until handed back with cbImuRelease(). Like
+ *        cbEncoderDrain(), a batch wrapping around the end of the ring is
+ *        returned in two calls.
+ * @param imu A pointer to the IMU.
+ * @param batch Set to point to the first sample of the batch.
+ * @return The number of samples in the batch, zero if there are none.
+ */
+size_t cbImuDrain(cbImu_t* imu, const cbImuSample_t** batch) {
+    cbImuRing_t* ring = &imu->ring;
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    unsigned int first = tail & (CB_IMU_RING_SIZE - 1);
+    size_t count = head - tail;
+    if (count > CB_IMU_RING_SIZE - first) {
+        count = CB_IMU_RING_SIZE - first;  // Stop at the end of the ring
+    }
+    *batch = &ring->samples[first];
+    return count;
+}
+
+/**
+ * @brief Hands a batch of samples obtained with cbImuDrain() back to
+ *        cbImuPoll(), so that their slots can be reused.
+ * @param imu A pointer to the IMU.
+ * @param count The number of samples consumed, at most the size of the batch.
+ */
+void cbImuRelease(cbImu_t* imu, size_t count) {
+    cbImuRing_t* ring = &imu->ring;
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + (unsigned int)count,
+                          memory_order_release);
+}
@@ -0,0 +1,244 @@
+/**
+ * @file mailbox.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L  // ftruncate(), clock_gettime()
+#include "mailbox.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cbdef.h"
+
+/**
+ * @brief Maps a mailbox file.
+ * @return The mapping, or NULL.
+ */
+static cbMailboxShared_t* cbMailboxMap(const char* path, int flags) {
+    struct stat st;
+    int fd = open(path ? path : CB_MAILBOX_PATH, flags, 0660);
+    if (fd < 0) return NULL;
+    if ((flags & O_CREAT) && ftruncate(fd, sizeof(cbMailboxShared_t)) != 0) {
+        close(fd);
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 ||
+        (uint64_t)st.st_size < sizeof(cbMailboxShared_t)) {
+        close(fd);
+        return NULL;
+    }
+    void* shm = mmap(NULL, sizeof(cbMailboxShared_t), PROT_READ | PROT_WRITE,
+                     MAP_SHARED, fd, 0);
+    close(fd);  // The mapping stays valid
+    return shm == MAP_FAILED ? NULL : shm;
+}
+
+/**
+ * @brief Creates a mailbox, or resets an existing one, and maps it. Called
+ *        by the controller, before other processes attach. The mailbox
+ *        stays in place after cbMailboxClose(), until the file is removed.
+ * @param mb A pointer to the mailbox.
+ * @param path The path of the file, NULL for CB_MAILBOX_PATH.
+ * @return A condition code.
+ */
+int cbMailboxCreate(cbMailbox_t* mb, const char* path) {
+    cbMailboxShared_t* shm = cbMailboxMap(path, O_RDWR | O_CREAT);
+    if (!shm) return CB_FAILURE;
+    atomic_store_explicit(&shm->version, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    for (int i = 0; i < CB_MAILBOX_SLOTS; i++) {
+        memset(&shm->slot[i].cmd, 0, sizeof(shm->slot[i].cmd));
+        atomic_store_explicit(&shm->slot[i].seq, 0, memory_order_relaxed);
+    }
+    memset(&shm->state, 0, sizeof(shm->state));
+    atomic_store_explicit(&shm->state_seq, 0, memory_order_relaxed);
+    memcpy(shm->magic, CB_MAILBOX_MAGIC, sizeof(CB_MAILBOX_MAGIC));
+    shm->size = sizeof(cbMailboxShared_t);
+    atomic_store_explicit(&shm->version, CB_MAILBOX_VERSION,
+                          memory_order_release);
+    mb->shm = shm;
+    mb->slot = 0;
+    memset(mb->taken, 0, sizeof(mb->taken));
+    return CB_SUCCESS;
+}
+
+/**
+ * @brief Maps an existing mailbox, e.g. from the front-end.
+ * @param mb A pointer to the mailbox.
+ * @param path The path of the file, NULL for CB_MAILBOX_PATH.
+ * @param slot The command slot of this process, below CB_MAILBOX_SLOTS. No
+ *        two processes posting commands at the same time may share a slot.
+ * @return CB_ERANGE if the slot does not exist, CB_FAILURE if the mailbox
+ *         does not exist, is not initialized or has a different layout,
+ *         CB_SUCCESS otherwise.
+ */
+int cbMailboxAttach(cbMailbox_t* mb, const char* path, unsigned int slot) {
+    if (slot >= CB_MAILBOX_SLOTS) return CB_ERANGE;
+    cbMailboxShared_t* shm = cbMailboxMap(path, O_RDWR);
+    if (!shm) return CB_FAILURE;
+    if (atomic_load_explicit(&shm->version, memory_order_acquire) !=
+            CB_MAILBOX_VERSION ||
+        memcmp(shm->magic, CB_MAILBOX_MAGIC, sizeof(CB_MAILBOX_MAGIC)) ||
+        shm->size != sizeof(cbMailboxShared_t)) {
+        munmap(shm, sizeof(cbMailboxShared_t));
+        return CB_FAILURE;
+    }
+    mb->shm = shm;
+    mb->slot = slot;
+    memset(mb->taken, 0, sizeof(mb->taken));
+    return CB_SUCCESS;
+}
+
+/**
+ * @brief Unmaps a mailbox.
+ * @param mb A pointer to the mailbox.
+ */
+void cbMailboxClose(cbMailbox_t* mb) {
+    if (!mb->shm) return;
+    munmap(mb->shm, sizeof(cbMailboxShared_t));
+    mb->shm = NULL;
+}
+
+/**
+ * @brief Posts a command to the slot of this process, replacing the previous
+ *        one if the controller did not take it yet. Wait-free: the slot has
+ *        no other writer, so posting is a plain seqlock write. A poster
+ *        killed while posting only leaves its own slot odd, and whoever
+ *        attaches to the slot next resumes from there.
+ * @param mb A pointer to the mailbox.
+ * @param mode One of CB_MAILBOX_STOP, CB_MAILBOX_DUTY and CB_MAILBOX_SPEED.
+ * @param left The setpoint of the left wheel.
+ * @param right The setpoint of the right wheel.
+ * @return The id of the command, reported in cbMailboxState_t.command_id
+ *         once applied. Ids increase by CB_MAILBOX_SLOTS within a slot, and
+ *         (id - 1) % CB_MAILBOX_SLOTS is the slot, so they never collide.
+ */
+uint32_t cbMailboxPost(cbMailbox_t* mb, uint32_t mode, float left,
+                       float right) {
+    struct cbMailboxSlot* slot = &mb->shm->slot[mb->slot];
+    struct timespec ts;
+    unsigned int seq = atomic_load_explicit(&slot->seq,
+                                            memory_order_relaxed) | 1u;
+    atomic_store_explicit(&slot->seq, seq, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint32_t id = slot->cmd.id ? slot->cmd.id + CB_MAILBOX_SLOTS
+                               : mb->slot + 1;
+    if (id == 0) id = CB_MAILBOX_SLOTS;  // 0 means no command
+    slot->cmd = (cbMailboxCommand_t){
+        .id = id,
+        .mode = mode,
+        .left = left,
+        .right = right,
+        .stamp_ns = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec};
+    atomic_store_explicit(&slot->seq, seq + 1, memory_order_release);
+    return id;
+}
+
+/**
+ * @brief Takes the latest command, if a new one was posted. Wait-free: each
+ *        slot is read once, and a command being posted is left for the next
+ *        call. New commands of the other slots that are older than the one
+ *        taken are dropped, as if they had been replaced.
+ * @param mb A pointer to the mailbox.
+ * @param cmd Where to copy the command.
+ * @return true if cmd was set to a new command.
+ */
+bool cbMailboxTake(cbMailbox_t* mb, cbMailboxCommand_t* cmd) {
+    const cbMailboxShared_t* shm = mb->shm;
+    bool found = false;
+    for (int i = 0; i < CB_MAILBOX_SLOTS; i++) {
+        const struct cbMailboxSlot* slot = &shm->slot[i];
+        unsigned int seq0 = atomic_load_explicit(&slot->seq,
+                                                 memory_order_acquire);
+        if (seq0 & 1) continue;
+        cbMailboxCommand_t copy = slot->cmd;
+        atomic_thread_fence(memory_order_acquire);
+        unsigned int seq1 = atomic_load_explicit(&slot->seq,
+                                                 memory_order_relaxed);
+        if (seq0 != seq1 || copy.id == mb->taken[i]) continue;
+        mb->taken[i] = copy.id;
+        if (!found || copy.stamp_ns > cmd->stamp_ns) *cmd = copy;
+        found = true;
+    }
+    return found;
+}
+
+/**
+ * @brief Publishes the state of the controller, and bumps its heartbeat.
+ *        Wait-free, must only be called by the controller.
+ * @param mb A pointer to the mailbox.
+ * @param state A pointer to the state, its cycles are ignored.
+ */
+void cbMailboxPublish(cbMailbox_t* mb, const cbMailboxState_t* state) {
+    cbMailboxShared_t* shm = mb->shm;
+    unsigned int seq = atomic_load_explicit(&shm->state_seq,
+                                            memory_order_relaxed);
+    uint64_t cycles = shm->state.cycles;
+    atomic_store_explicit(&shm->state_seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    shm->state = *state;
+    shm->state.cycles = cycles + 1;
+    atomic_store_explicit(&shm->state_seq, seq + 2, memory_order_release);
+}
+
+/**
+ * @brief Reads the last state published by the controller. Retries while
+ *        it is being published, which never takes long.
+ * @param mb A pointer to the mailbox.
+ * @param state Where to copy the state.
+ */
+void cbMailboxRead(const cbMailbox_t* mb, cbMailboxState_t* state) {
+    const cbMailboxShared_t* shm = mb->shm;
+    unsigned int seq0, seq1;
+    do {
+        seq0 = atomic_load_explicit(&shm->state_seq, memory_order_acquire);
+        *state = shm->state;
+        atomic_thread_fence(memory_order_acquire);
+        seq1 = atomic_load_explicit(&shm->state_seq, memory_order_relaxed);
+    } while ((seq0 & 1) || seq0 != seq1);
+}
+
+/**
+ * @brief Fills the encoder and pose fields of a state.
+ * @param state A pointer to the state.
+ * @param snap_l A snapshot of the left Encoder.
+ * @param snap_r A snapshot of the right Encoder.
+ * @param pose The pose of the robot, NULL if unknown.
+ */
+void cbMailboxFill(cbMailboxState_t* state,
+                   const cbEncoderSnapshot_t* snap_l,
+                   const cbEncoderSnapshot_t* snap_r, const cbPose_t* pose) {
+    state->ticks_l = snap_l->ticks;
+    state->ticks_r = snap_r->ticks;
+    state->illegal_l = snap_l->illegal;
+    state->illegal_r = snap_r->illegal;
+    if (pose) {
+        state->x_nm = pose->x_nm;
+        state->y_nm = pose->y_nm;
+        state->theta = pose->theta;
+    }
+}
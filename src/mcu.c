@@ -0,0 +1,375 @@
+/**
+ * @file mcu.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE  // pthread_attr_setaffinity_np()
+#include "mcu.h"
+
+#include <math.h>
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cbdef.h"
+#include "hal.h"
+#include "periodic.h"
+#include "timebase.h"
+
+/**
+ * @brief Computes the CRC-16/CCITT-FALSE of a buffer: polynomial 0x1021,
+ *        initial value 0xFFFF, no reflection, which `_crc_xmodem_update()`
+ *        of avr-libc also computes when started from 0xFFFF.
+ * @param data The buffer.
+ * @param length Its length in bytes.
+ * @return The CRC.
+ */
+uint16_t cbMcuCrc16(const uint8_t* data, unsigned int length) {
+    uint16_t crc = 0xFFFF;
+    for (unsigned int i = 0; i < length; i++) {
+        crc ^= (uint16_t)(data[i] << 8);
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (uint16_t)(crc & 0x8000 ? crc << 1 ^ 0x1021 : crc << 1);
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief Stores a little endian value.
+ * @param p Where to store the value.
+ * @param value The value.
+ * @param bytes The size of the value.
+ */
+static inline void cbMcuPut(uint8_t* p, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) p[i] = (uint8_t)(value >> 8 * i);
+}
+
+/**
+ * @brief Loads a little endian value.
+ * @param p Where to load the value from.
+ * @param bytes The size of the value.
+ * @return The value.
+ */
+static inline uint32_t cbMcuGet(const uint8_t* p, int bytes) {
+    uint32_t value = 0;
+    for (int i = 0; i < bytes; i++) value |= (uint32_t)p[i] << 8 * i;
+    return value;
+}
+
+/**
+ * @brief Checks the magic and the CRC of a frame.
+ * @param frame The frame.
+ * @param magic The expected magic.
+ * @return A condition code.
+ */
+static int cbMcuCheck(const uint8_t* frame, uint8_t magic) {
+    if (frame[0] != magic) return CB_FAILURE;
+    uint16_t crc = (uint16_t)cbMcuGet(&frame[CB_MCU_FRAME_SIZE - 2], 2);
+    return cbMcuCrc16(frame, CB_MCU_FRAME_SIZE - 2) == crc ? CB_SUCCESS
+                                                            : CB_FAILURE;
+}
+
+/**
+ * @brief Seals a frame with its CRC.
+ * @param frame The frame.
+ */
+static void cbMcuSeal(uint8_t* frame) {
+    cbMcuPut(&frame[CB_MCU_FRAME_SIZE - 2],
+             cbMcuCrc16(frame, CB_MCU_FRAME_SIZE - 2), 2);
+}
+
+/**
+ * @brief Encodes a command.
+ * @param cmd A pointer to the command.
+ * @param frame Where to encode it, CB_MCU_FRAME_SIZE bytes.
+ */
+void cbMcuPackCommand(const cbMcuCommand_t* cmd, uint8_t* frame) {
+    memset(frame, 0, CB_MCU_FRAME_SIZE);
+    frame[0] = CB_MCU_COMMAND_MAGIC;
+    frame[1] = cmd->seq;
+    frame[2] = cmd->flags;
+    cbMcuPut(&frame[4], (uint16_t)cmd->duty[0], 2);
+    cbMcuPut(&frame[6], (uint16_t)cmd->duty[1], 2);
+    cbMcuSeal(frame);
+}
+
+/**
+ * @brief Decodes a command, as the MCU does.
+ * @param frame The frame, CB_MCU_FRAME_SIZE bytes.
+ * @param cmd Where to decode it, only written on success.
+ * @return CB_FAILURE if the magic or the CRC are wrong.
+ */
+int cbMcuUnpackCommand(const uint8_t* frame, cbMcuCommand_t* cmd) {
+    if (cbMcuCheck(frame, CB_MCU_COMMAND_MAGIC) != CB_SUCCESS) {
+        return CB_FAILURE;
+    }
+    cmd->seq = frame[1];
+    cmd->flags = frame[2];
+    cmd->duty[0] = (int16_t)cbMcuGet(&frame[4], 2);
+    cmd->duty[1] = (int16_t)cbMcuGet(&frame[6], 2);
+    return CB_SUCCESS;
+}
+
+/**
+ * @brief Encodes a status, as the MCU does.
+ * @param status A pointer to the status.
+ * @param frame Where to encode it, CB_MCU_FRAME_SIZE bytes.
+ */
+void cbMcuPackStatus(const cbMcuStatus_t* status, uint8_t* frame) {
+    frame[0] = CB_MCU_STATUS_MAGIC;
+    frame[1] = status->seq;
+    frame[2] = status->ack;
+    frame[3] = status->flags;
+    cbMcuPut(&frame[4], (uint32_t)status->count[0], 4);
+    cbMcuPut(&frame[8], (uint32_t)status->count[1], 4);
+    cbMcuPut(&frame[12], status->crc_errors, 2);
+    cbMcuSeal(frame);
+}
+
+/**
+ * @brief Decodes a status.
+ * @param frame The frame, CB_MCU_FRAME_SIZE bytes.
+ * @param status Where to decode it, only written on success.
+ * @return CB_FAILURE if the magic or the CRC are wrong.
+ */
+int cbMcuUnpackStatus(const uint8_t* frame, cbMcuStatus_t* status) {
+    if (cbMcuCheck(frame, CB_MCU_STATUS_MAGIC) != CB_SUCCESS) {
+        return CB_FAILURE;
+    }
+    status->seq = frame[1];
+    status->ack = frame[2];
+    status->flags = frame[3];
+    status->count[0] = (int32_t)cbMcuGet(&frame[4], 4);
+    status->count[1] = (int32_t)cbMcuGet(&frame[8], 4);
+    status->crc_errors = (uint16_t)cbMcuGet(&frame[12], 2);
+    return CB_SUCCESS;
+}
+
+/**
+ * @brief Publishes a value to a double buffer. Only one thread may write.
+ *        The sequence number goes up by two per value and is odd while the
+ *        other half is being written. The odd store is ordered before the
+ *        copy, like in the Encoder and mailbox seqlocks, so a reader that saw
+ *        any byte of the copy also sees that a write started.
+ * @param seq The sequence number of the buffer: seq / 2 counts the values
+ *        published, and its parity is the index of the current half.
+ * @param halves The two halves.
+ * @param value The new value.
+ * @param size The size of the value.
+ */
+static void cbMcuPublish(atomic_uint* seq, void* halves, const void* value,
+                         size_t size) {
+    unsigned int current = atomic_load_explicit(seq, memory_order_relaxed);
+    atomic_store_explicit(seq, current + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy((uint8_t*)halves + (((current >> 1) + 1) & 1) * size, value, size);
+    atomic_store_explicit(seq, current + 2, memory_order_release);
+}
+
+/**
+ * @brief Copies the current value of a double buffer. The writer only ever
+ *        writes the other half, so a write in progress does not disturb the
+ *        copy; it is retried only if a value was published meanwhile, as the
+ *        writer may then have started to overwrite the half being copied.
+ * @param seq The sequence number of the buffer.
+ * @param halves The two halves.
+ * @param value Where to copy the value.
+ * @param size The size of the value.
+ */
+static void cbMcuFetch(const atomic_uint* seq, const void* halves, void* value,
+                       size_t size) {
+    unsigned int current;
+    do {
+        current = atomic_load_explicit(seq, memory_order_acquire);
+        memcpy(value, (const uint8_t*)halves + ((current >> 1) & 1) * size,
+               size);
+        atomic_thread_fence(memory_order_acquire);
+    } while (atomic_load_explicit(seq, memory_order_relaxed) >> 1 !=
+             current >> 1);
+}
+
+/**
+ * @brief Opens the SPI channel of the MCU. The initial command keeps the
+ *        motors stopped.
+ * @param link A pointer to the link.
+ * @return A condition code.
+ */
+int cbMcuLinkOpen(cbMcuLink_t* link) {
+    int handle = cbHal->spi_open(link->channel, link->baud);
+    if (handle < 0) return CB_FAILURE;
+    link->handle = handle;
+    memset(link->command, 0, sizeof(link->command));
+    memset(link->state, 0, sizeof(link->state));
+    atomic_init(&link->command_seq, 0);
+    atomic_init(&link->state_seq, 0);
+    link->seq = link->status_seq = 0;
+    link->synced = false;
+    atomic_init(&link->transfers, 0);
+    atomic_init(&link->crc_errors, 0);
+    atomic_init(&link->ack_errors, 0);
+    atomic_init(&link->lost, 0);
+    return CB_SUCCESS;
+}
+
+/**
+ * @brief Closes the SPI channel. The MCU stops the motors by itself after
+ *        CB_MCU_WATCHDOG_US.
+ * @param link A pointer to the link, whose thread must be stopped.
+ */
+void cbMcuLinkClose(cbMcuLink_t* link) { cbHal->spi_close(link->handle); }
+
+/**
+ * @brief Posts the command sent by the next transfers. Never waits. Only one
+ *        thread may post commands.
+ * @param link A pointer to the link.
+ * @param duty_l The duty cycle of the left motor, in the range [-1,1].
+ * @param duty_r The duty cycle of the right motor, in the range [-1,1].
+ * @param flags CB_MCU_ENABLE to drive the motors, CB_MCU_CLEAR to zero the
+ *        counts.
+ */
+void cbMcuLinkCommand(cbMcuLink_t* link, float duty_l, float duty_r,
+                      uint8_t flags) {
+    cbMcuCommand_t cmd = {.flags = flags};
+    float duty[2] = {duty_l, duty_r};
+    for (int i = 0; i < 2; i++) {
+        float d = duty[i] > 1.f ? 1.f : duty[i] < -1.f ? -1.f : duty[i];
+        cmd.duty[i] = (int16_t)lrintf(d * 32767.f);
+    }
+    cbMcuPublish(&link->command_seq, link->command, &cmd, sizeof(cmd));
+}
+
+/**
+ * @brief Copies the state of the MCU as last received. Never waits for the
+ *        bus, and only retries if the link published a new state meanwhile.
+ * @param link A pointer to the link.
+ * @param state Where to copy the state.
+ */
+void cbMcuLinkState(const cbMcuLink_t* link, cbMcuState_t* state) {
+    cbMcuFetch(&link->state_seq, link->state, state, sizeof(*state));
+}
+
+/**
+ * @brief Performs one transfer: sends the latest command and receives a
+ *        status, which is published if its magic and CRC are valid. Its
+ *        ack is checked against the previous command and its seq against
+ *        the previous status, mismatches being counted in ack_errors and
+ *        lost. Only one thread may run the transfers.
+ * @param link A pointer to the link.
+ * @return CB_SUCCESS if a valid status was received.
+ */
+int cbMcuLinkExchange(cbMcuLink_t* link) {
+    uint8_t tx[CB_MCU_FRAME_SIZE], rx[CB_MCU_FRAME_SIZE];
+    cbMcuCommand_t cmd;
+    cbMcuStatus_t status;
+    cbMcuFetch(&link->command_seq, link->command, &cmd, sizeof(cmd));
+    cmd.seq = link->seq;
+    cbMcuPackCommand(&cmd, tx);
+    int rc = cbHal->spi_xfer(link->handle, tx, rx, CB_MCU_FRAME_SIZE);
+    if (rc != CB_MCU_FRAME_SIZE) return CB_FAILURE;
+    atomic_fetch_add_explicit(&link->transfers, 1, memory_order_relaxed);
+    link->seq++;
+    if (cbMcuUnpackStatus(rx, &status) != CB_SUCCESS) {
+        atomic_fetch_add_explicit(&link->crc_errors, 1, memory_order_relaxed);
+        // It still took a seq, which must not be counted as lost as well
+        link->status_seq++;
+        return CB_FAILURE;
+    }
+    cbMcuState_t state;
+    cbMcuFetch(&link->state_seq, link->state, &state, sizeof(state));
+    if (link->synced) {
+        if (status.ack != (uint8_t)(cmd.seq - 1)) {
+            atomic_fetch_add_explicit(&link->ack_errors, 1,
+                                      memory_order_relaxed);
+        }
+        uint8_t gap = (uint8_t)(status.seq - link->status_seq - 1);
+        atomic_fetch_add_explicit(&link->lost, gap, memory_order_relaxed);
+        for (int i = 0; i < 2; i++) {  // The differences survive wrapping
+            state.ticks[i] +=
+                (int32_t)((uint32_t)status.count[i] - (uint32_t)link->count[i]);
+        }
+    } else {
+        state.ticks[0] = status.count[0];
+        state.ticks[1] = status.count[1];
+        link->synced = true;
+    }
+    link->status_seq = status.seq;
+    link->count[0] = status.count[0];
+    link->count[1] = status.count[1];
+    state.time_us = cbTimeNowUs();
+    state.frames++;
+    state.flags = status.flags;
+    cbMcuPublish(&link->state_seq, link->state, &state, sizeof(state));
+    return CB_SUCCESS;
+}
+
+/**
+ * @brief The body of the link's thread.
+ * @param arg A pointer to the link.
+ * @return NULL.
+ */
+static void* cbMcuLinkEntry(void* arg) {
+    cbMcuLink_t* link = arg;
+    cbPeriodic_t timer;
+    cbPeriodicInit(&timer, link->period_ns, 0);
+    while (!atomic_load_explicit(&link->stop, memory_order_relaxed)) {
+        cbMcuLinkExchange(link);
+        cbPeriodicWait(&timer);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Runs the transfers on a new thread, every period_ns. Not to be used
+ *        with the simulation backend, which is driven by a single thread:
+ *        call cbMcuLinkExchange() after each cbSimStep() instead.
+ * @param link A pointer to the link, which must outlive the thread.
+ * @return A condition code: CB_ERANGE if the period is 0 or the CPU is not
+ *         online, CB_FAILURE if the thread could not be created.
+ */
+int cbMcuLinkStart(cbMcuLink_t* link) {
+    pthread_attr_t attr;
+    if (!link->period_ns || link->cpu >= CPU_SETSIZE ||
+        link->cpu >= sysconf(_SC_NPROCESSORS_ONLN)) {
+        return CB_ERANGE;
+    }
+    pthread_attr_init(&attr);
+    if (link->cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(link->cpu, &cpus);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+    }
+    atomic_init(&link->stop, false);
+    int err = pthread_create(&link->tid, &attr, cbMcuLinkEntry, link);
+    pthread_attr_destroy(&attr);
+    return err ? CB_FAILURE : CB_SUCCESS;
+}
+
+/**
+ * @brief Stops the link's thread and waits for it to end.
+ * @param link A pointer to the link.
+ * @return A condition code.
+ */
+int cbMcuLinkStop(cbMcuLink_t* link) {
+    atomic_store_explicit(&link->stop, true, memory_order_relaxed);
+    return pthread_join(link->tid, NULL) ? CB_FAILURE : CB_SUCCESS;
+}
@@ -21,35 +21,142 @@
  * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
  */
 
-#include <pigpio.h>
-
+#include "hal.h"
 #include "motor.h"
 
 /**
- * The frequency of the soft-PWM thread. 
+ * The default frequency of the PWM signal.
  * @link https://abyz.me.uk/rpi/pigpio/cif.html#gpioSetPWMfrequency
  */
 #define PWM_FREQ 100 
 
 /**
- * The scaled range of the PWM's Duty Cycle.
+ * The default scaled range of the soft PWM's Duty Cycle.
  * @link https://abyz.me.uk/rpi/pigpio/cif.html#gpioSetPWMrange
  */
 #define MAX_DUTY_CYC 255
 
 /**
- * @brief Initializes the GPIO pins used for driving a motor.
+ * The range of the hardware PWM's Duty Cycle, fixed by PiGPIO.
+ * @link https://abyz.me.uk/rpi/pigpio/cif.html#gpioHardwarePWM
+ */
+#define HW_MAX_DUTY_CYC 1000000
+
+/**
+ * The pin driven by each of the two hardware PWM channels, GPIO_PIN_NC while
+ * a channel is free.
+ */
+static cbGPIO_t cbMotorHwPWMOwner[2] = {GPIO_PIN_NC, GPIO_PIN_NC};
+
+/**
+ * @brief Returns the hardware PWM channel of a pin on the 40-pin header of
+ *        the BCM2837: pins 12 and 18 share PWM0, pins 13 and 19 share PWM1.
+ * @param pin The GPIO pin.
+ * @return The channel, or -1 if the pin does not support hardware PWM.
+ */
+static inline int cbMotorHwPWMChannel(cbGPIO_t pin) {
+    switch ((int)pin) {
+        case 12:
+        case 18:
+            return 0;
+        case 13:
+        case 19:
+            return 1;
+        default:
+            return -1;
+    }
+}
+
+/**
+ * @brief Initializes one of the pins of a motor, choosing the PWM generator.
+ *        A pin whose hardware PWM channel already drives another pin falls
+ *        back to soft PWM, as both pins would output the same signal.
  * @param motor A pointer to the handle of the motor.
+ * @param pin The GPIO pin.
+ * @param hw Set to whether the pin is driven by hardware PWM.
+ * @param steps Set to the real number of steps of the duty cycle.
  */
-void cbMotorGPIOinit(const cbMotor_t* motor) {
+static void cbMotorPinInit(const cbMotor_t* motor, cbGPIO_t pin, bool* hw,
+                           unsigned int* steps) {
+    int channel = cbMotorHwPWMChannel(pin);
+    cbHal->set_mode(pin, CB_GPIO_OUTPUT);
+    // Reinitializing a pin gives up the channel it held
+    if (channel >= 0 && cbMotorHwPWMOwner[channel] == pin) {
+        cbMotorHwPWMOwner[channel] = GPIO_PIN_NC;
+    }
+    *hw = motor->pwm_mode == CB_PWM_AUTO && channel >= 0 &&
+          cbMotorHwPWMOwner[channel] == GPIO_PIN_NC &&
+          cbHal->hw_pwm(pin, motor->pwm_freq, 0) == 0;
+    if (*hw) {
+        cbMotorHwPWMOwner[channel] = pin;
+        // About 250M / frequency, the duty cycle has at most 1M steps
+        int real = cbHal->get_pwm_real_range(pin);
+        *steps = (real > 0 && real < HW_MAX_DUTY_CYC) ? (unsigned int)real
+                                                      : HW_MAX_DUTY_CYC;
+    } else {
+        cbHal->set_pwm_range(pin, motor->pwm_range);
+        cbHal->set_pwm_freq(pin, motor->pwm_freq);
+        // The real range depends on the frequency and PiGPIO's sample rate
+        int real = cbHal->get_pwm_real_range(pin);
+        *steps = (real > 0 && (unsigned int)real < motor->pwm_range)
+                     ? (unsigned int)real
+                     : motor->pwm_range;
+    }
+}
+
+/**
+ * @brief Scales a duty cycle to the range of the PWM generator of a pin.
+ * @param motor A pointer to the handle of the motor.
+ * @param hw Whether the pin is driven by hardware PWM.
+ * @param duty_cycle The duty cycle in the range [0,1].
+ * @return The raw duty cycle.
+ */
+static inline unsigned int cbMotorRawDuty(const cbMotor_t* motor, bool hw,
+                                          float duty_cycle) {
+    return (unsigned int)((hw ? HW_MAX_DUTY_CYC : motor->pwm_range) *
+                          duty_cycle);
+}
+
+/**
+ * @brief Applies a raw duty cycle to one of the pins of a motor.
+ * @param motor A pointer to the handle of the motor.
+ * @param pin The GPIO pin.
+ * @param hw Whether the pin is driven by hardware PWM.
+ * @param raw The duty cycle, scaled with cbMotorRawDuty().
+ */
+static inline void cbMotorPinRawPWM(const cbMotor_t* motor, cbGPIO_t pin,
+                                    bool hw, unsigned int raw) {
+    if (hw) {
+        cbHal->hw_pwm(pin, motor->pwm_freq, raw);
+    } else {
+        cbHal->pwm(pin, raw);
+    }
+}
+
+/**
+ * @brief Applies a duty cycle to one of the pins of a motor.
+ * @param motor A pointer to the handle of the motor.
+ * @param pin The GPIO pin.
+ * @param hw Whether the pin is driven by hardware PWM.
+ * @param duty_cycle The duty cycle in the range [0,1].
+ */
+static inline void cbMotorPinPWM(const cbMotor_t* motor, cbGPIO_t pin, bool hw,
+                                 float duty_cycle) {
+    cbMotorPinRawPWM(motor, pin, hw, cbMotorRawDuty(motor, hw, duty_cycle));
+}
+
+/**
+ * @brief Initializes the GPIO pins used for driving a motor. A zero PWM
+ *        frequency or range in the handle is replaced with the default.
+ * @param motor A pointer to the handle of the motor.
+ */
+void cbMotorGPIOinit(cbMotor_t* motor) {
+    if (!motor->pwm_freq) motor->pwm_freq = PWM_FREQ;
+    if (!motor->pwm_range) motor->pwm_range = MAX_DUTY_CYC;
     // Fw
-    gpioSetMode(motor->pin_fw, PI_OUTPUT);
-    gpioSetPWMrange(motor->pin_fw, MAX_DUTY_CYC);
-    gpioSetPWMfrequency(motor->pin_fw, PWM_FREQ);
+    cbMotorPinInit(motor, motor->pin_fw, &motor->hw_fw, &motor->steps_fw);
     // Bw
-    gpioSetMode(motor->pin_bw, PI_OUTPUT);
-    gpioSetPWMrange(motor->pin_bw, MAX_DUTY_CYC);
-    gpioSetPWMfrequency(motor->pin_bw, PWM_FREQ);
+    cbMotorPinInit(motor, motor->pin_bw, &motor->hw_bw, &motor->steps_bw);
 }
 
 /**
@@ -63,19 +170,27 @@ void cbMotorGPIOinit(const cbMotor_t* motor) {
 int cbMotorMove(cbMotor_t* motor, cbDir_t direction, float duty_cycle) {
     // Check for the range of the Duty Cycle
     if(duty_cycle <= .0f || duty_cycle > 1.0f) return CB_ERANGE;
-    int pwm = (int) (MAX_DUTY_CYC * duty_cycle);
+    cbDir_t previous = motor->direction;
     if(direction) motor->direction = direction;
     switch(motor->direction) {
         /* In order to move the motor you need to set one pin to 0 (Ground) and
-         * apply a certain PWM signal to the other pin. 
+         * apply a certain PWM signal to the other pin. When the direction
+         * changes the PWM of the other pin is stopped first, as a plain write
+         * does not stop it on every backend.
          */
         case forward:
-            gpioPWM(motor->pin_fw, pwm);
-            gpioWrite(motor->pin_bw, 0);
+            if(previous != forward) {
+                cbMotorPinPWM(motor, motor->pin_bw, motor->hw_bw, 0.f);
+            }
+            cbMotorPinPWM(motor, motor->pin_fw, motor->hw_fw, duty_cycle);
+            cbHal->write(motor->pin_bw, 0);
             break;
         case backward:
-            gpioWrite(motor->pin_fw, 0);
-            gpioPWM(motor->pin_bw, pwm);
+            if(previous != backward) {
+                cbMotorPinPWM(motor, motor->pin_fw, motor->hw_fw, 0.f);
+            }
+            cbHal->write(motor->pin_fw, 0);
+            cbMotorPinPWM(motor, motor->pin_bw, motor->hw_bw, duty_cycle);
             break;
         default:
             /* - The specified direction is wrong;
@@ -87,7 +202,137 @@ int cbMotorMove(cbMotor_t* motor, cbDir_t direction, float duty_cycle) {
     return CB_SUCCESS;
 }
 
+/**
+ * @brief Stops a motor, driving both of its pins low.
+ * @param motor A pointer to the handle of the motor.
+ */
 void cbMotorReset(cbMotor_t* motor) {
-    gpioWrite(motor->pin_fw, 0);
-    gpioWrite(motor->pin_bw, 0);
+    cbMotorPinPWM(motor, motor->pin_fw, motor->hw_fw, 0.f);
+    cbMotorPinPWM(motor, motor->pin_bw, motor->hw_bw, 0.f);
+    cbHal->write(motor->pin_fw, 0);
+    cbHal->write(motor->pin_bw, 0);
+}
+
+/**
+ * @brief Returns the number of distinct duty cycle steps the motor can be
+ *        driven with in a direction, after the PWM generator's quantisation.
+ * @param motor A pointer to the handle of the motor.
+ * @param direction The direction of motion.
+ * @return The number of steps between off and fully on.
+ */
+unsigned int cbMotorResolution(const cbMotor_t* motor, cbDir_t direction) {
+    return direction == backward ? motor->steps_bw : motor->steps_fw;
+}
+
+/**
+ * @brief Quantises a duty cycle to the value the PWM generator will actually
+ *        output, so that controllers can account for the quantisation error.
+ * @param motor A pointer to the handle of the motor.
+ * @param direction The direction of motion.
+ * @param duty_cycle The duty cycle in the range [0,1].
+ * @return The duty cycle that would be applied by cbMotorMove().
+ */
+float cbMotorQuantize(const cbMotor_t* motor, cbDir_t direction,
+                      float duty_cycle) {
+    unsigned int steps = cbMotorResolution(motor, direction);
+    if (!steps) return duty_cycle;
+    return (float)(unsigned int)(duty_cycle * steps) / steps;
+}
+
+/**
+ * @brief Initializes a pair of motors driven together. Both motors must have
+ *        been initialized with cbMotorGPIOinit(); they are stopped so that
+ *        the shadow state matches the pins.
+ * @param pair A pointer to the handle of the pair.
+ * @param left A pointer to the handle of the left motor.
+ * @param right A pointer to the handle of the right motor.
+ * @return A condition code.
+ */
+int cbDrivePairInit(cbDrivePair_t* pair, cbMotor_t* left, cbMotor_t* right) {
+    const cbMotor_t* motors[2] = {left, right};
+    for (int i = 0; i < 2; i++) {
+        // The pins must be in the first bank to be cleared with a mask
+        if (motors[i]->pin_fw < 0 || motors[i]->pin_fw > 31 ||
+            motors[i]->pin_bw < 0 || motors[i]->pin_bw > 31) {
+            return CB_ERANGE;
+        }
+    }
+    pair->left = left;
+    pair->right = right;
+    cbDrivePairReset(pair);
+    return CB_SUCCESS;
+}
+
+/**
+ * @brief Moves both motors of a pair with a single command. The new outputs
+ *        are computed for the four pins first and compared with the shadow
+ *        state, then only the pins that change are written: the pins that
+ *        are no longer driven have their PWM stopped and are cleared together
+ *        with one mask write, then the new duty cycles are applied back to
+ *        back, left then right.
+ * @param pair A pointer to the handle of the pair.
+ * @param dir_left The direction of the left motor, zero for unchanged.
+ * @param duty_left The duty cycle of the left motor in the range [0,1]. A
+ *                  duty cycle of 0 stops the motor.
+ * @param dir_right The direction of the right motor, zero for unchanged.
+ * @param duty_right The duty cycle of the right motor in the range [0,1].
+ * @return A condition code. If it is not CB_SUCCESS, nothing is written.
+ */
+int cbDrivePairMove(cbDrivePair_t* pair, cbDir_t dir_left, float duty_left,
+                    cbDir_t dir_right, float duty_right) {
+    cbMotor_t* motors[2] = {pair->left, pair->right};
+    const cbDir_t dirs[2] = {dir_left, dir_right};
+    const float duties[2] = {duty_left, duty_right};
+    cbDir_t next[2];
+    unsigned int target[4];
+    uint32_t clear = 0;
+    for (int i = 0; i < 2; i++) {
+        if (duties[i] < .0f || duties[i] > 1.0f) return CB_ERANGE;
+        next[i] = dirs[i] ? dirs[i] : motors[i]->direction;
+        if (next[i] != forward && next[i] != backward) return CB_ENOMODE;
+        const cbMotor_t* m = motors[i];
+        target[2 * i] = next[i] == forward
+                            ? cbMotorRawDuty(m, m->hw_fw, duties[i])
+                            : 0;
+        target[2 * i + 1] = next[i] == backward
+                                ? cbMotorRawDuty(m, m->hw_bw, duties[i])
+                                : 0;
+    }
+    // Pins going low: stop their PWM, then clear all of them at once
+    for (int p = 0; p < 4; p++) {
+        if (target[p] || !pair->duty[p]) continue;
+        const cbMotor_t* m = motors[p / 2];
+        cbGPIO_t pin = (p & 1) ? m->pin_bw : m->pin_fw;
+        cbMotorPinRawPWM(m, pin, (p & 1) ? m->hw_bw : m->hw_fw, 0);
+        clear |= 1u << pin;
+        pair->duty[p] = 0;
+    }
+    if (clear) cbHal->clear_bank(clear);
+    // Pins being driven: only the ones whose duty cycle changed
+    for (int p = 0; p < 4; p++) {
+        if (!target[p] || target[p] == pair->duty[p]) continue;
+        const cbMotor_t* m = motors[p / 2];
+        cbGPIO_t pin = (p & 1) ? m->pin_bw : m->pin_fw;
+        cbMotorPinRawPWM(m, pin, (p & 1) ? m->hw_bw : m->hw_fw, target[p]);
+        pair->duty[p] = target[p];
+    }
+    motors[0]->direction = next[0];
+    motors[1]->direction = next[1];
+    return CB_SUCCESS;
+}
+
+/**
+ * @brief Stops both motors of a pair and resynchronizes the shadow state.
+ * @param pair A pointer to the handle of the pair.
+ */
+void cbDrivePairReset(cbDrivePair_t* pair) {
+    cbMotor_t* motors[2] = {pair->left, pair->right};
+    uint32_t clear = 0;
+    for (int i = 0; i < 2; i++) {
+        cbMotorPinRawPWM(motors[i], motors[i]->pin_fw, motors[i]->hw_fw, 0);
+        cbMotorPinRawPWM(motors[i], motors[i]->pin_bw, motors[i]->hw_bw, 0);
+        clear |= (1u << motors[i]->pin_fw) | (1u << motors[i]->pin_bw);
+    }
+    cbHal->clear_bank(clear);
+    for (int p = 0; p < 4; p++) pair->duty[p] = 0;
 }
@@ -0,0 +1,203 @@
+/**
+ * @file odometry.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "odometry.h"
+
+#include <math.h>
+#include <pthread.h>
+
+#define ODO_PI 3.14159265358979323846
+#define ODO_Q30 (1 << 30)
+#define ODO_PI_2_Q30 1686629713  //< pi/2 in Q30: BAM * pi/2 is rad in Q30
+#define ODO_SINC_POLY_MAX (ODO_Q30 / 2)  //< Half-angles below .5 rad
+#define ODO_SIN_BITS 10
+#define ODO_SIN_SIZE (1 << ODO_SIN_BITS)
+
+/**
+ * A full period of sin() in Q30. Linear interpolation between the entries
+ * keeps the error below 5e-6.
+ */
+static int32_t cbOdoSinTable[ODO_SIN_SIZE + 1];
+static pthread_once_t cbOdoSinOnce = PTHREAD_ONCE_INIT;
+
+static void cbOdoSinInit(void) {
+    for (int i = 0; i <= ODO_SIN_SIZE; i++) {
+        cbOdoSinTable[i] = (int32_t)lround(sin(2. * ODO_PI * i / ODO_SIN_SIZE) *
+                                           ODO_Q30);
+    }
+}
+
+static inline int32_t cbOdoSin(uint32_t theta) {
+    uint32_t i = theta >> (32 - ODO_SIN_BITS);
+    int64_t frac = (theta >> (32 - ODO_SIN_BITS - 16)) & 0xFFFF;
+    int32_t a = cbOdoSinTable[i], b = cbOdoSinTable[i + 1];
+    return a + (int32_t)(((b - a) * frac) >> 16);
+}
+
+static inline int32_t cbOdoCos(uint32_t theta) {
+    return cbOdoSin(theta + CB_ODO_BAM_QUARTER);
+}
+
+/**
+ * @brief Computes sin(h)/h, the ratio between the chord and the arc.
+ * @param half The half-angle h in BAM.
+ * @return The ratio in Q30.
+ */
+static inline int64_t cbOdoSinc(int32_t half) {
+    int64_t h = ((int64_t)half * ODO_PI_2_Q30) >> 30;  // rad in Q30
+    if (h > -ODO_SINC_POLY_MAX && h < ODO_SINC_POLY_MAX) {
+        // Taylor series up to h^4, the error is below 4e-6
+        int64_t h2 = (h * h) >> 30;
+        return ODO_Q30 - h2 / 6 + ((h2 * h2) >> 30) / 120;
+    }
+    return ((int64_t)cbOdoSin((uint32_t)half) << 30) / h;
+}
+
+static inline void cbOdoWriteBegin(cbOdometry_t* odo) {
+    unsigned int seq = atomic_load_explicit(&odo->seq, memory_order_relaxed);
+    atomic_store_explicit(&odo->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static inline void cbOdoWriteEnd(cbOdometry_t* odo) {
+    unsigned int seq = atomic_load_explicit(&odo->seq, memory_order_relaxed);
+    atomic_store_explicit(&odo->seq, seq + 1, memory_order_release);
+}
+
+/**
+ * @brief Computes the distance traveled by a wheel per tick.
+ * @param wheel_radius_mm The radius of the wheel.
+ * @param ticks_per_rev The ticks counted per revolution of the motor.
+ * @param gear_ratio Motor revolutions per wheel revolution.
+ * @return The distance in mm.
+ */
+double cbOdoMmPerTick(double wheel_radius_mm, unsigned int ticks_per_rev,
+                      double gear_ratio) {
+    return 2. * ODO_PI * wheel_radius_mm / (ticks_per_rev * gear_ratio);
+}
+
+/**
+ * @brief Initializes an odometry engine at the origin.
+ * @param odo A pointer to the engine.
+ * @param mm_per_tick_l The distance traveled by the left wheel per tick.
+ * @param mm_per_tick_r The distance traveled by the right wheel per tick.
+ * @param track_mm The distance between the contact points of the wheels.
+ */
+void cbOdoInit(cbOdometry_t* odo, double mm_per_tick_l, double mm_per_tick_r,
+               double track_mm) {
+    pthread_once(&cbOdoSinOnce, cbOdoSinInit);
+    odo->nm_per_tick_l = llround(mm_per_tick_l * 1e6 * 65536.);
+    odo->nm_per_tick_r = llround(mm_per_tick_r * 1e6 * 65536.);
+    odo->bam_per_nm = llround(ldexp(1., 64) / (2. * ODO_PI * track_mm * 1e6));
+    odo->rem_l = odo->rem_r = 0;
+    odo->ticks_l = odo->ticks_r = 0;
+    odo->primed = false;
+    odo->pose = (cbPose_t){0, 0, 0};
+    atomic_init(&odo->seq, 0);
+}
+
+/**
+ * @brief Moves the robot to a pose, e.g. after a fix from another sensor.
+ *        Must be called from the thread updating the engine.
+ * @param odo A pointer to the engine.
+ * @param pose A pointer to the new pose.
+ */
+void cbOdoSetPose(cbOdometry_t* odo, const cbPose_t* pose) {
+    cbOdoWriteBegin(odo);
+    odo->pose = *pose;
+    cbOdoWriteEnd(odo);
+}
+
+/**
+ * @brief Integrates the motion of the wheels since the last update, assuming
+ *        it was an arc of circle, which includes straight lines and turns on
+ *        the spot. The chord of the arc is ds * sin(h) / h in the direction
+ *        theta + h, h being half of the heading change: this is exact for
+ *        any arc, and reduces to ds along theta when going straight.
+ * @param odo A pointer to the engine.
+ * @param ticks_l The ticks counted by the left encoder since the last update.
+ * @param ticks_r The ticks counted by the right encoder since the last
+ *        update. The wheels must differ by less than ~30 cm per update.
+ */
+void cbOdoIntegrate(cbOdometry_t* odo, int32_t ticks_l, int32_t ticks_r) {
+    // Carry the fractions of nm over, or the error would add up at every update
+    int64_t dl = ticks_l * odo->nm_per_tick_l + odo->rem_l;
+    int64_t dr = ticks_r * odo->nm_per_tick_r + odo->rem_r;
+    odo->rem_l = dl & 0xFFFF;
+    odo->rem_r = dr & 0xFFFF;
+    dl >>= 16;
+    dr >>= 16;
+    int64_t ds = (dl + dr) / 2;
+    int32_t dtheta =
+        (int32_t)(((dr - dl) * odo->bam_per_nm + (INT64_C(1) << 31)) >> 32);
+    uint32_t mid = odo->pose.theta + (uint32_t)(dtheta / 2);
+    int64_t chord = (ds * cbOdoSinc(dtheta / 2)) >> 30;
+    cbOdoWriteBegin(odo);
+    odo->pose.x_nm += (chord * cbOdoCos(mid)) >> 30;
+    odo->pose.y_nm += (chord * cbOdoSin(mid)) >> 30;
+    odo->pose.theta += (uint32_t)dtheta;
+    cbOdoWriteEnd(odo);
+}
+
+/**
+ * @brief Integrates the motion of the wheels since the last snapshots. The
+ *        first call only records the ticks.
+ * @param odo A pointer to the engine.
+ * @param left A snapshot of the left encoder.
+ * @param right A snapshot of the right encoder.
+ */
+void cbOdoUpdate(cbOdometry_t* odo, const cbEncoderSnapshot_t* left,
+                 const cbEncoderSnapshot_t* right) {
+    if (odo->primed) {
+        cbOdoIntegrate(odo, (int32_t)(left->ticks - odo->ticks_l),
+                       (int32_t)(right->ticks - odo->ticks_r));
+    }
+    odo->ticks_l = left->ticks;
+    odo->ticks_r = right->ticks;
+    odo->primed = true;
+}
+
+/**
+ * @brief Reads a consistent copy of the pose. Can be called from any thread
+ *        while the engine is being updated.
+ * @param odo A pointer to the engine.
+ * @param pose A pointer to the copy.
+ */
+void cbOdoPose(const cbOdometry_t* odo, cbPose_t* pose) {
+    unsigned int seq0, seq1;
+    do {
+        seq0 = atomic_load_explicit(&odo->seq, memory_order_acquire);
+        *pose = odo->pose;
+        atomic_thread_fence(memory_order_acquire);
+        seq1 = atomic_load_explicit(&odo->seq, memory_order_relaxed);
+    } while ((seq0 & 1) || seq0 != seq1);
+}
+
+/**
+ * @brief Converts a heading to radians.
+ * @param theta The heading in BAM.
+ * @return The heading in radians, between -pi and pi.
+ */
+double cbOdoBamToRad(uint32_t theta) {
+    return (int32_t)theta * (2. * ODO_PI / 4294967296.);
+}
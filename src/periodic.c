@@ -0,0 +1,90 @@
+/**
+ * @file periodic.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L  // clock_nanosleep()
+#include "periodic.h"
+
+#include <errno.h>
+#include <time.h>
+
+#define NSEC_PER_SEC 1000000000ULL
+
+/**
+ * @brief Returns the current time of the clock used by the periodic timers.
+ * @return The time in ns of CLOCK_MONOTONIC.
+ */
+uint64_t cbPeriodicNowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NSEC_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+static void cbPeriodicSleepUntil(uint64_t time_ns) {
+    struct timespec ts = {.tv_sec = time_ns / NSEC_PER_SEC,
+                          .tv_nsec = time_ns % NSEC_PER_SEC};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) ==
+           EINTR) {
+    }
+}
+
+/**
+ * @brief Initializes a periodic timer. The current time is the first release,
+ *        the first wait returns one period later.
+ * @param timer A pointer to the timer.
+ * @param period_ns The period in ns, must not be 0.
+ * @param spin_ns How long to busy-wait at the end of each wait instead of
+ *        sleeping, to hide the wakeup latency of the kernel. 0 never spins.
+ */
+void cbPeriodicInit(cbPeriodic_t* timer, uint64_t period_ns, uint64_t spin_ns) {
+    timer->period_ns = period_ns;
+    timer->spin_ns = spin_ns;
+    timer->release_ns = cbPeriodicNowNs();
+    timer->late = timer->skipped = 0;
+}
+
+/**
+ * @brief Waits for the next release. If it has already passed, returns
+ *        immediately for the latest release that has, so that the caller can
+ *        catch up without drifting.
+ * @param timer A pointer to the timer.
+ * @return 0 if the caller was on time, otherwise the number of releases that
+ *         had already passed: the ones before the latest are skipped.
+ */
+unsigned int cbPeriodicWait(cbPeriodic_t* timer) {
+    uint64_t target = timer->release_ns + timer->period_ns;
+    uint64_t now = cbPeriodicNowNs();
+    if (now >= target) {
+        uint64_t passed = (now - target) / timer->period_ns + 1;
+        timer->release_ns = target + (passed - 1) * timer->period_ns;
+        timer->late++;
+        timer->skipped += passed - 1;
+        return (unsigned int)passed;
+    }
+    if (target - now > timer->spin_ns) {
+        cbPeriodicSleepUntil(target - timer->spin_ns);
+    }
+    while (cbPeriodicNowNs() < target) {
+    }
+    timer->release_ns = target;
+    return 0;
+}
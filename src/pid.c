@@ -0,0 +1,171 @@
+/**
+ * @file pid.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "pid.h"
+
+#include <string.h>
+
+#include "cbdef.h"
+
+/**
+ * @brief Initializes a bank of controllers with all the gains and limits at
+ *        zero, i.e. every lane disabled.
+ * @param pid A pointer to the bank.
+ * @param period_us The period at which cbPidUpdate() will be called.
+ */
+void cbPidInit(cbPid_t* pid, uint32_t period_us) {
+    memset(pid, 0, sizeof(*pid));
+    pid->period_us = period_us;
+}
+
+/**
+ * @brief Converts a gain to fixed point, rounding to the nearest step.
+ * @param x The gain.
+ * @param frac_bits The number of fractional bits.
+ * @param q Where to store the converted gain.
+ * @return A condition code: CB_ERANGE if the gain does not fit 32 bits, or if
+ *         it is not zero but too small to be represented.
+ */
+static int cbPidQuantize(float x, int frac_bits, int32_t* q) {
+    double scaled = (double)x * (double)(1LL << frac_bits);
+    double rounded = scaled < 0 ? scaled - .5 : scaled + .5;
+    if (!(rounded > INT32_MIN - 1. && rounded < INT32_MAX + 1.))
+        return CB_ERANGE;
+    *q = (int32_t)rounded;
+    if (*q == 0 && x != 0.f) return CB_ERANGE;
+    return CB_SUCCESS;
+}
+
+/**
+ * @brief Sets the gains of a lane. Nothing is changed if any of them cannot
+ *        be represented at the period of the bank.
+ * @param pid A pointer to the bank.
+ * @param lane The lane.
+ * @param kp The proportional gain.
+ * @param ki The integral gain, per second.
+ * @param kd The derivative gain, in seconds.
+ * @param kb The back-calculation gain, per second. Usually about ki / kp, 0
+ *        to only use clamping.
+ * @return A condition code.
+ */
+int cbPidSetGains(cbPid_t* pid, unsigned int lane, float kp, float ki,
+                  float kd, float kb) {
+    if (lane >= CB_PID_LANES) return CB_ERANGE;
+    float dt = pid->period_us / 1e6f;
+    int32_t q[4];
+    if (cbPidQuantize(kp, CB_PID_FRAC_BITS, &q[0]) ||
+        cbPidQuantize(ki * dt, CB_PID_GAIN_BITS, &q[1]) ||
+        cbPidQuantize(kd / dt, CB_PID_FRAC_BITS, &q[2]) ||
+        cbPidQuantize(kb * dt, CB_PID_GAIN_BITS, &q[3]))
+        return CB_ERANGE;
+    pid->kp[lane] = q[0];
+    pid->ki[lane] = q[1];
+    pid->kd[lane] = q[2];
+    pid->kb[lane] = q[3];
+    return CB_SUCCESS;
+}
+
+/**
+ * @brief Sets the range of the output of a lane. A negative minimum allows
+ *        the output to change sign, e.g. to drive a motor in both directions.
+ * @param pid A pointer to the bank.
+ * @param lane The lane.
+ * @param out_min The minimum output.
+ * @param out_max The maximum output.
+ * @return A condition code.
+ */
+int cbPidSetLimits(cbPid_t* pid, unsigned int lane, float out_min,
+                   float out_max) {
+    if (lane >= CB_PID_LANES || out_min > out_max) return CB_ERANGE;
+    pid->out_min[lane] = CB_PID_FIX(out_min);
+    pid->out_max[lane] = CB_PID_FIX(out_max);
+    return CB_SUCCESS;
+}
+
+/**
+ * @brief Loads the integral of a lane so that the controller starts from a
+ *        given output instead of jumping to zero (bumpless start).
+ * @param pid A pointer to the bank.
+ * @param lane The lane.
+ * @param output The initial output.
+ * @return A condition code.
+ */
+int cbPidPreload(cbPid_t* pid, unsigned int lane, float output) {
+    if (lane >= CB_PID_LANES) return CB_ERANGE;
+    pid->output[lane] = CB_PID_FIX(output);
+    pid->integral[lane] = pid->output[lane] * (1LL << CB_PID_GAIN_BITS);
+    return CB_SUCCESS;
+}
+
+/**
+ * @brief Clears the state of all the lanes, keeping gains and limits.
+ * @param pid A pointer to the bank.
+ */
+void cbPidReset(cbPid_t* pid) {
+    memset(pid->integral, 0, sizeof(pid->integral));
+    memset(pid->output, 0, sizeof(pid->output));
+    memset(pid->saturated, 0, sizeof(pid->saturated));
+    pid->primed = 0;
+}
+
+static inline int64_t cbPidClamp(int64_t x, int64_t lo, int64_t hi) {
+    return x < lo ? lo : x > hi ? hi : x;
+}
+
+/**
+ * @brief Updates all the lanes with a new measurement. The loop has a fixed
+ *        trip count and no data-dependent branches, so the compiler can map
+ *        the lanes onto SIMD registers.
+ * @param pid A pointer to the bank.
+ * @param measurement The measurement of each lane.
+ */
+void cbPidUpdate(cbPid_t* pid, const int32_t measurement[CB_PID_LANES]) {
+    const int64_t primed = pid->primed;
+    const int64_t one = 1LL << CB_PID_GAIN_BITS, half = one >> 1;
+    for (int i = 0; i < CB_PID_LANES; i++) {
+        int64_t meas = measurement[i];
+        int64_t error = (int64_t)pid->setpoint[i] - meas;
+        int64_t delta = (meas - pid->prev_meas[i]) * primed;
+        int64_t p = (pid->kp[i] * error) >> CB_PID_FRAC_BITS;
+        int64_t d = -((pid->kd[i] * delta) >> CB_PID_FRAC_BITS);
+        // The integral terms stay in Q24.40 and are rounded once
+        int64_t di = pid->ki[i] * error;
+        int64_t i_out = (pid->integral[i] + di + half) >> CB_PID_GAIN_BITS;
+        int64_t ideal = p + i_out + d;
+        int64_t out = cbPidClamp(ideal, pid->out_min[i], pid->out_max[i]);
+        // Clamping: do not integrate further into saturation
+        int64_t windup =
+            (ideal > out && error > 0) || (ideal < out && error < 0);
+        // Back-calculation: bleed the integral by the excess, which is
+        // bounded first so that the product cannot overflow
+        int64_t excess = cbPidClamp(out - ideal, INT32_MIN, INT32_MAX);
+        int64_t back = pid->kb[i] * excess;
+        int64_t integral = pid->integral[i] + di * !windup + back;
+        pid->integral[i] = cbPidClamp(integral, pid->out_min[i] * one,
+                                      pid->out_max[i] * one);
+        pid->output[i] = (int32_t)out;
+        pid->saturated[i] = (pid->saturated[i] + 1) * (ideal != out);
+        pid->prev_meas[i] = (int32_t)meas;
+    }
+    pid->primed = 1;
+}
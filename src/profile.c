@@ -0,0 +1,130 @@
+/**
+ * @file profile.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "profile.h"
+
+#include <math.h>
+
+#include "cbdef.h"
+#include "pid.h"
+
+/**
+ * Largest distance in mm that fits a Q16.16 setpoint.
+ */
+#define CB_PROFILE_MAX_MM 32767.
+
+/**
+ * @brief A phase of the move, in which the jerk is constant.
+ */
+typedef struct {
+    double duration, jerk, acc;  //< acc is the acceleration at the start.
+} cbProfilePhase_t;
+
+static inline int32_t cbProfileFix(double x) {
+    return (int32_t)lround(x * CB_PID_ONE);
+}
+
+/**
+ * @brief Plans a move from rest to rest and samples it at the end of each
+ *        period. The peak velocity, and with a jerk limit the peak
+ *        acceleration, are lowered when the move is too short to reach them.
+ *        All the computation happens here, so following the profile costs
+ *        a table lookup per period.
+ * @param prof A pointer to the profile.
+ * @param dist_mm The distance of the move, negative to move backwards.
+ * @param max_vel The maximum velocity in mm/s.
+ * @param max_acc The maximum acceleration in mm/s^2.
+ * @param max_jerk The maximum jerk in mm/s^3, 0 for a trapezoidal profile.
+ * @param period_us The control period.
+ * @return CB_ERANGE if a limit is not positive, or if the move does not fit
+ *         in CB_PROFILE_STEPS periods or in a Q16.16 setpoint, CB_SUCCESS
+ *         otherwise.
+ */
+int cbProfileInit(cbProfile_t* prof, float dist_mm, float max_vel,
+                  float max_acc, float max_jerk, uint32_t period_us) {
+    double d = fabs(dist_mm), v = max_vel, a = max_acc, j = max_jerk;
+    double sign = dist_mm < 0 ? -1. : 1.;
+    if (!(v > 0.) || !(a > 0.) || !(j >= 0.) || !(d <= CB_PROFILE_MAX_MM) ||
+        period_us == 0) {
+        return CB_ERANGE;
+    }
+    prof->next = 0;
+    if (d == 0.) {
+        prof->pos[0] = prof->vel[0] = 0;
+        prof->steps = 1;
+        prof->peak_vel = prof->peak_acc = 0.f;
+        return CB_SUCCESS;
+    }
+    // With a jerk limit the acceleration ramps for tj, which makes the peak
+    // acceleration unreachable below a velocity of a^2/j
+    if (j > 0. && v * j < a * a) a = sqrt(v * j);
+    double tj = j > 0. ? a / j : 0.;
+    // Accelerating to v takes v / a + tj and covers half of v times that
+    if (v * (v / a + tj) > d) {
+        v = (sqrt(a * a * tj * tj + 4. * a * d) - a * tj) / 2.;
+        if (j > 0. && v * j < a * a) {  // Too short to reach a either
+            v = cbrt(d * d * j / 4.);
+            a = sqrt(v * j);
+            tj = a / j;
+        }
+    }
+    double ta = fmax(v / a - tj, 0.);
+    double tv = fmax(d / v - v / a - tj, 0.);
+    const cbProfilePhase_t phases[] = {
+        {tj, j, 0.}, {ta, 0., a},  {tj, -j, a},  {tv, 0., 0.},
+        {tj, -j, 0.}, {ta, 0., -a}, {tj, j, -a},
+    };
+    const unsigned int count = sizeof(phases) / sizeof(phases[0]);
+    double total = 2. * (2. * tj + ta) + tv, period = period_us / 1e6;
+    double steps = ceil(total / period - 1e-9);
+    if (steps > CB_PROFILE_STEPS) return CB_ERANGE;
+    prof->steps = steps < 1. ? 1 : (unsigned int)steps;
+    prof->peak_vel = (float)v;
+    prof->peak_acc = (float)a;
+    // Walk the phases, integrating the position and velocity at their start
+    unsigned int phase = 0;
+    double start = 0., p0 = 0., v0 = 0., last = 0.;
+    for (unsigned int k = 0; k < prof->steps; k++) {
+        double t = (k + 1) * period, p = d, vel = 0.;
+        while (phase < count && t > start + phases[phase].duration) {
+            double dt = phases[phase].duration, a0 = phases[phase].acc;
+            p0 += dt * (v0 + dt * (a0 / 2. + dt * phases[phase].jerk / 6.));
+            v0 += dt * (a0 + dt * phases[phase].jerk / 2.);
+            start += dt;
+            phase++;
+        }
+        if (phase < count) {
+            double dt = t - start, a0 = phases[phase].acc;
+            p = p0 + dt * (v0 + dt * (a0 / 2. + dt * phases[phase].jerk / 6.));
+            vel = v0 + dt * (a0 + dt * phases[phase].jerk / 2.);
+        }
+        // Rounding must not move the setpoint backwards or past the end
+        p = fmin(fmax(p, last), d);
+        vel = fmax(vel, 0.);
+        if (k == prof->steps - 1) p = d, vel = 0.;
+        last = p;
+        prof->pos[k] = cbProfileFix(sign * p);
+        prof->vel[k] = cbProfileFix(sign * vel);
+    }
+    return CB_SUCCESS;
+}
@@ -0,0 +1,245 @@
+/**
+ * @file rt.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE  // syscall(), SCHED_FIFO
+#include "rt.h"
+
+#include <linux/sched.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cbdef.h"
+#include "periodic.h"
+
+#ifndef SCHED_FLAG_DL_OVERRUN
+#define SCHED_FLAG_DL_OVERRUN 0x04
+#endif
+
+#define NSEC_PER_SEC 1000000000ULL
+
+/**
+ * @brief Parameters of the sched_setattr system call, which the C library
+ *        may not wrap.
+ * @see https://man7.org/linux/man-pages/man2/sched_setattr.2.html
+ */
+struct cbRtSchedAttr {
+    uint32_t size;
+    uint32_t sched_policy;
+    uint64_t sched_flags;
+    int32_t sched_nice;
+    uint32_t sched_priority;
+    uint64_t sched_runtime;
+    uint64_t sched_deadline;
+    uint64_t sched_period;
+};
+
+/**
+ * The overrun counter of the task running on this thread, if any. SIGXCPU is
+ * sent to the thread that overran, so the handler only has to follow it.
+ */
+static _Thread_local atomic_uint_fast64_t* cbRtOverrunCounter;
+static pthread_once_t cbRtHandlerOnce = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Counts a runtime overrun reported by SCHED_DEADLINE. Only does a
+ *        lock-free atomic increment, which is async-signal-safe.
+ */
+static void cbRtOverrunHandler(int sig) {
+    (void)sig;
+    atomic_uint_fast64_t* counter = cbRtOverrunCounter;
+    if (counter) atomic_fetch_add_explicit(counter, 1, memory_order_relaxed);
+}
+
+static void cbRtInstallHandler(void) {
+    struct sigaction sa = {.sa_handler = cbRtOverrunHandler,
+                           .sa_flags = SA_RESTART};
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGXCPU, &sa, NULL);
+}
+
+static inline uint64_t cbRtCpuNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * NSEC_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Switches the calling thread to the best policy available:
+ *        SCHED_DEADLINE, then SCHED_FIFO, then whatever it already has.
+ * @return The policy obtained.
+ */
+static cbRtPolicy_t cbRtSetPolicy(const cbRtTask_t* task) {
+    struct cbRtSchedAttr attr = {.size = sizeof(attr),
+                                 .sched_policy = SCHED_DEADLINE,
+                                 .sched_flags = SCHED_FLAG_DL_OVERRUN,
+                                 .sched_runtime = task->runtime_ns,
+                                 .sched_deadline = task->deadline_ns,
+                                 .sched_period = task->period_ns};
+    if (syscall(SYS_sched_setattr, 0, &attr, 0) == 0) return CB_RT_DEADLINE;
+    struct sched_param param = {.sched_priority = task->priority
+                                                      ? task->priority
+                                                      : CB_RT_FIFO_PRIORITY};
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0) {
+        return CB_RT_FIFO;
+    }
+    return CB_RT_OTHER;
+}
+
+static void* cbRtTaskEntry(void* arg) {
+    cbRtTask_t* task = arg;
+    cbRtStats_t* stats = task->stats;
+    cbRtOverrunCounter = &stats->overruns;
+    cbRtPolicy_t policy = cbRtSetPolicy(task);
+    atomic_store(&task->policy, policy);
+    const uint64_t period = task->period_ns;
+    cbPeriodic_t timer;  // Paces the fallbacks, its first release is now
+    cbPeriodicInit(&timer, period, 0);
+    uint64_t release = timer.release_ns, nominal = 0, prev_begin = 0;
+    while (!atomic_load_explicit(&task->stop, memory_order_relaxed)) {
+        uint64_t cpu = cbRtCpuNs();
+        uint64_t begin = cbPeriodicNowNs();
+        bool more = task->job(task->args);
+        uint64_t end = cbPeriodicNowNs();
+        atomic_fetch_add_explicit(&stats->cycles, 1, memory_order_relaxed);
+        if (policy != CB_RT_DEADLINE &&
+            cbRtCpuNs() - cpu > task->runtime_ns) {
+            atomic_fetch_add_explicit(&stats->overruns, 1,
+                                      memory_order_relaxed);
+        }
+        if (end > release + task->deadline_ns) {
+            atomic_fetch_add_explicit(&stats->misses, 1, memory_order_relaxed);
+        }
+        cbHistRecord(&stats->wakeup, begin > release ? begin - release : 0);
+        cbHistRecord(&stats->exec, end - begin);
+        if (prev_begin) {
+            uint64_t actual = begin - prev_begin;
+            cbHistRecord(&stats->jitter, actual > nominal ? actual - nominal
+                                                          : nominal - actual);
+        }
+        prev_begin = begin;
+        if (!more) break;
+        uint64_t skipped;
+        if (policy == CB_RT_DEADLINE) {
+            // The kernel replenishes the runtime and wakes us up at the
+            // beginning of the next period. Its periods are re-anchored
+            // whenever the task blocks, so the wakeup is the best estimate
+            // of the release we have.
+            sched_yield();
+            uint64_t wake = cbPeriodicNowNs();
+            uint64_t periods = (wake - release + period / 2) / period;
+            if (periods == 0) periods = 1;
+            release = wake;
+            nominal = periods * period;
+            skipped = periods - 1;
+        } else {
+            unsigned int passed = cbPeriodicWait(&timer);
+            nominal = timer.release_ns - release;
+            release = timer.release_ns;
+            skipped = passed ? passed - 1 : 0;
+        }
+        if (skipped) {  // Releases that passed entirely during the job
+            atomic_fetch_add_explicit(&stats->misses, skipped,
+                                      memory_order_relaxed);
+        }
+    }
+    cbRtOverrunCounter = NULL;
+    return NULL;
+}
+
+/**
+ * @brief Empties the statistics of a task. Must not race with the task.
+ * @param stats A pointer to the statistics.
+ */
+void cbRtStatsInit(cbRtStats_t* stats) {
+    atomic_init(&stats->cycles, 0);
+    atomic_init(&stats->overruns, 0);
+    atomic_init(&stats->misses, 0);
+    cbHistInit(&stats->wakeup);
+    cbHistInit(&stats->exec);
+    cbHistInit(&stats->jitter);
+}
+
+/**
+ * @brief Starts a periodic task on a new thread. The policy is chosen before
+ *        the first job runs: SCHED_DEADLINE if the kernel and the privileges
+ *        allow it, otherwise SCHED_FIFO, otherwise the default policy. The
+ *        last two wait for the next period with cbPeriodicWait().
+ *        The statistics are emptied.
+ * @param task A pointer to the task, which must outlive the thread.
+ * @return A condition code: CB_ERANGE if the parameters are not
+ *         0 < runtime <= deadline <= period, CB_FAILURE if the thread could
+ *         not be created.
+ */
+int cbRtTaskStart(cbRtTask_t* task) {
+    if (!task->job || task->runtime_ns == 0 ||
+        task->runtime_ns > task->deadline_ns ||
+        task->deadline_ns > task->period_ns) {
+        return CB_ERANGE;
+    }
+    pthread_once(&cbRtHandlerOnce, cbRtInstallHandler);
+    if (!task->stats) task->stats = &task->own_stats;
+    cbRtStatsInit(task->stats);
+    atomic_init(&task->stop, false);
+    atomic_init(&task->policy, -1);
+    if (pthread_create(&task->tid, NULL, cbRtTaskEntry, task) != 0) {
+        return CB_FAILURE;
+    }
+    while (atomic_load(&task->policy) < 0) sched_yield();
+    return CB_SUCCESS;
+}
+
+/**
+ * @brief Asks a task to end after the job currently running, if any.
+ * @param task A pointer to the task.
+ */
+void cbRtTaskStop(cbRtTask_t* task) {
+    atomic_store_explicit(&task->stop, true, memory_order_relaxed);
+}
+
+/**
+ * @brief Waits for a task to end.
+ * @param task A pointer to the task.
+ * @return A condition code.
+ */
+int cbRtTaskJoin(cbRtTask_t* task) {
+    return pthread_join(task->tid, NULL) ? CB_FAILURE : CB_SUCCESS;
+}
+
+/**
+ * @brief Returns the name of a policy, for diagnostics.
+ * @param policy The policy.
+ * @return A constant string.
+ */
+const char* cbRtPolicyName(cbRtPolicy_t policy) {
+    switch (policy) {
+        case CB_RT_DEADLINE:
+            return "SCHED_DEADLINE";
+        case CB_RT_FIFO:
+            return "SCHED_FIFO";
+        default:
+            return "SCHED_OTHER";
+    }
+}
@@ -0,0 +1,113 @@
+/**
+ * @file sampler.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE  // pthread_attr_setaffinity_np(), SCHED_FIFO
+#include "sampler.h"
+
+#include <sched.h>
+#include <unistd.h>
+
+#include "cbdef.h"
+#include "periodic.h"
+#include "rt.h"
+
+/**
+ * @brief The body of the sampler thread. A sample in which none of the pins
+ *        of the group changed costs one read of the level register and one
+ *        comparison, see cbEncoderGroupPoll().
+ * @param arg A pointer to the sampler.
+ * @return NULL.
+ */
+static void* cbEncoderSamplerEntry(void* arg) {
+    cbEncoderSampler_t* sampler = arg;
+    if (sampler->cpu >= 0) {  // Spinning unpinned could starve the others
+        struct sched_param param = {.sched_priority = CB_RT_FIFO_PRIORITY};
+        pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    }
+    cbPeriodic_t timer;
+    uint64_t samples = 0, moving = 0;
+    cbPeriodicInit(&timer, sampler->period_ns, CB_SAMPLER_SPIN_NS);
+    while (!atomic_load_explicit(&sampler->stop, memory_order_relaxed)) {
+        samples++;
+        moving += cbEncoderGroupPoll(sampler->group);
+        unsigned int passed = cbPeriodicWait(&timer);
+        if (passed > 1) {
+            atomic_fetch_add_explicit(&sampler->missed, passed - 1,
+                                      memory_order_relaxed);
+        }
+        if ((samples & 1023) == 0) {  // Publish the counters now and then
+            atomic_store_explicit(&sampler->samples, samples,
+                                  memory_order_relaxed);
+            atomic_store_explicit(&sampler->moving, moving,
+                                  memory_order_relaxed);
+        }
+    }
+    atomic_store_explicit(&sampler->samples, samples, memory_order_relaxed);
+    atomic_store_explicit(&sampler->moving, moving, memory_order_relaxed);
+    return NULL;
+}
+
+/**
+ * @brief Synchronizes the Encoders of a group and starts polling them on a
+ *        new thread. A sampler pinned to a CPU runs with SCHED_FIFO if the
+ *        privileges allow it, and the CPU should be isolated from the rest of
+ *        the system, as with periods below CB_SAMPLER_SPIN_NS the thread
+ *        never sleeps. The group must not be registered with
+ *        cbEncoderGroupRegister() as well.
+ * @param sampler A pointer to the sampler, which must outlive the thread.
+ * @return A condition code: CB_ERANGE if the period is 0 or the CPU is not
+ *         online, CB_FAILURE if the thread could not be created.
+ */
+int cbEncoderSamplerStart(cbEncoderSampler_t* sampler) {
+    pthread_attr_t attr;
+    if (!sampler->period_ns || sampler->cpu >= CPU_SETSIZE ||
+        sampler->cpu >= sysconf(_SC_NPROCESSORS_ONLN)) {
+        return CB_ERANGE;
+    }
+    pthread_attr_init(&attr);
+    if (sampler->cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(sampler->cpu, &cpus);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+    }
+    atomic_init(&sampler->stop, false);
+    atomic_init(&sampler->samples, 0);
+    atomic_init(&sampler->moving, 0);
+    atomic_init(&sampler->missed, 0);
+    cbEncoderGroupSync(sampler->group);
+    int err = pthread_create(&sampler->tid, &attr, cbEncoderSamplerEntry,
+                             sampler);
+    pthread_attr_destroy(&attr);
+    return err ? CB_FAILURE : CB_SUCCESS;
+}
+
+/**
+ * @brief Stops a sampler and waits for its thread to end.
+ * @param sampler A pointer to the sampler.
+ * @return A condition code.
+ */
+int cbEncoderSamplerStop(cbEncoderSampler_t* sampler) {
+    atomic_store_explicit(&sampler->stop, true, memory_order_relaxed);
+    return pthread_join(sampler->tid, NULL) ? CB_FAILURE : CB_SUCCESS;
+}
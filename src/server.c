@@ -0,0 +1,349 @@
+/**
+ * @file server.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE  // accept4()
+#include "server.h"
+
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "cbdef.h"
+#include "timebase.h"
+
+/* Each epoll event carries what it refers to: the listening socket, or the
+ * socket or subscription timer of a client, in the upper half, and the index
+ * of the client in the lower half.
+ */
+#define CB_EV_LISTEN 0ULL
+#define CB_EV_SOCKET 1ULL
+#define CB_EV_TIMER 2ULL
+#define CB_EV(kind, index) ((kind) << 32 | (index))
+
+/**
+ * @brief Opens the socket of a server. A stale socket left at the same path
+ *        is replaced.
+ * @param srv A pointer to the server.
+ * @param path The path of the socket, NULL for CB_SERVER_PATH.
+ * @param motors The left and right Motors, initialized.
+ * @param encoders The left and right Encoders, registered.
+ * @return CB_ERANGE if the path is too long, CB_FAILURE if the socket could
+ *         not be opened, CB_SUCCESS otherwise.
+ */
+int cbServerOpen(cbServer_t* srv, const char* path, cbMotor_t* motors[2],
+                 cbEncoder_t* encoders[2]) {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    struct epoll_event ev = {.events = EPOLLIN,
+                             .data.u64 = CB_EV(CB_EV_LISTEN, 0)};
+    if (!path) path = CB_SERVER_PATH;
+    if (strlen(path) >= sizeof(addr.sun_path)) return CB_ERANGE;
+    strcpy(addr.sun_path, path);
+    for (unsigned int i = 0; i < 2; i++) {
+        srv->motor[i] = motors[i];
+        srv->encoder[i] = encoders[i];
+    }
+    for (unsigned int i = 0; i < CB_SERVER_CLIENTS; i++) {
+        srv->client[i].fd = srv->client[i].timer = -1;
+    }
+    srv->requests = srv->updates = 0;
+    srv->epoll = epoll_create1(EPOLL_CLOEXEC);
+    srv->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    unlink(path);
+    if (srv->epoll < 0 || srv->fd < 0 ||
+        bind(srv->fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(srv->fd, CB_SERVER_CLIENTS) != 0 ||
+        epoll_ctl(srv->epoll, EPOLL_CTL_ADD, srv->fd, &ev) != 0) {
+        if (srv->fd >= 0) close(srv->fd);
+        if (srv->epoll >= 0) close(srv->epoll);
+        return CB_FAILURE;
+    }
+    return CB_SUCCESS;
+}
+
+static void cbServerDrop(cbServer_t* srv, cbServerClient_t* c) {
+    epoll_ctl(srv->epoll, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    if (c->timer >= 0) {
+        epoll_ctl(srv->epoll, EPOLL_CTL_DEL, c->timer, NULL);
+        close(c->timer);
+    }
+    c->fd = c->timer = -1;
+}
+
+static void cbServerAccept(cbServer_t* srv) {
+    int fd;
+    while ((fd = accept4(srv->fd, NULL, NULL,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        unsigned int i = 0;
+        while (i < CB_SERVER_CLIENTS && srv->client[i].fd >= 0) i++;
+        struct epoll_event ev = {.events = EPOLLIN,
+                                 .data.u64 = CB_EV(CB_EV_SOCKET, i)};
+        if (i == CB_SERVER_CLIENTS ||
+            epoll_ctl(srv->epoll, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            close(fd);  // Full
+            continue;
+        }
+        cbServerClient_t* c = &srv->client[i];
+        c->fd = fd;
+        c->events = EPOLLIN;
+        c->in_len = c->out_len = c->out_pos = 0;
+        c->dropped = 0;
+    }
+}
+
+/**
+ * @brief Writes the pending replies of a client. While some are left, the
+ *        client is only polled for writing, so it cannot send more requests
+ *        than it reads replies.
+ * @return false if the client was dropped.
+ */
+static bool cbServerFlush(cbServer_t* srv, cbServerClient_t* c,
+                          unsigned int i) {
+    while (c->out_pos < c->out_len) {
+        // No SIGPIPE if the client went away
+        ssize_t n = send(c->fd, c->out + c->out_pos, c->out_len - c->out_pos,
+                         MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) break;
+        if (n <= 0) {
+            cbServerDrop(srv, c);
+            return false;
+        }
+        c->out_pos += (size_t)n;
+    }
+    if (c->out_pos == c->out_len) c->out_pos = c->out_len = 0;
+    uint32_t events = c->out_len ? EPOLLOUT : EPOLLIN;
+    if (events != c->events) {
+        struct epoll_event ev = {.events = events,
+                                 .data.u64 = CB_EV(CB_EV_SOCKET, i)};
+        epoll_ctl(srv->epoll, EPOLL_CTL_MOD, c->fd, &ev);
+        c->events = events;
+    }
+    return true;
+}
+
+/**
+ * @brief Fills a reply with the state of the Encoders.
+ */
+static void cbServerState(const cbServer_t* srv, cbReply_t* reply) {
+    cbEncoderSnapshot_t snap_l, snap_r;
+    cbEncoderSnapshot(srv->encoder[0], &snap_l);
+    cbEncoderSnapshot(srv->encoder[1], &snap_r);
+    reply->time_us = cbTimeNowUs();
+    reply->ticks_l = snap_l.ticks;
+    reply->ticks_r = snap_r.ticks;
+}
+
+/**
+ * @brief Moves a motor as requested by a client. The request comes straight
+ *        off the socket, so it is checked before anything reaches the motor:
+ *        a NaN duty cycle would pass the range check of cbMotorMove(), and an
+ *        unknown direction would be stored in the motor before being
+ *        rejected.
+ * @return A condition code.
+ */
+static int cbServerMove(cbServer_t* srv, const cbRequest_t* req) {
+    if (req->arg >= 2 || !isfinite(req->value) ||
+        (req->dir != 0 && req->dir != forward && req->dir != backward)) {
+        return CB_ERANGE;
+    }
+    return cbMotorMove(srv->motor[req->arg], (cbDir_t)req->dir, req->value);
+}
+
+/**
+ * @brief Starts, changes or stops the subscription of a client.
+ * @return A condition code.
+ */
+static int cbServerSubscribe(cbServer_t* srv, cbServerClient_t* c,
+                             unsigned int i, const cbRequest_t* req) {
+    struct itimerspec its = {
+        .it_interval = {req->arg / 1000000, req->arg % 1000000 * 1000}};
+    its.it_value = its.it_interval;
+    if (req->arg == 0) {
+        if (c->timer >= 0) {
+            epoll_ctl(srv->epoll, EPOLL_CTL_DEL, c->timer, NULL);
+            close(c->timer);
+            c->timer = -1;
+        }
+        return CB_SUCCESS;
+    }
+    if (req->arg < CB_SERVER_MIN_PERIOD_US) return CB_ERANGE;
+    if (c->timer < 0) {
+        struct epoll_event ev = {.events = EPOLLIN,
+                                 .data.u64 = CB_EV(CB_EV_TIMER, i)};
+        c->timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (c->timer < 0) return CB_FAILURE;
+        if (epoll_ctl(srv->epoll, EPOLL_CTL_ADD, c->timer, &ev) != 0) {
+            close(c->timer);
+            c->timer = -1;
+            return CB_FAILURE;
+        }
+    }
+    c->sub_tag = req->tag;
+    return timerfd_settime(c->timer, 0, &its, NULL) ? CB_FAILURE : CB_SUCCESS;
+}
+
+/**
+ * @brief Answers the complete requests of a client, as many as there is room
+ *        for in its reply buffer, and writes the replies. The Encoders are
+ *        read once per batch. Requests left over stay in the request buffer
+ *        until the replies have been written.
+ */
+static void cbServerAnswer(cbServer_t* srv, cbServerClient_t* c,
+                           unsigned int i) {
+    size_t count;
+    do {
+        size_t room = (sizeof(c->out) - c->out_len) / sizeof(cbReply_t);
+        count = c->in_len / sizeof(cbRequest_t);
+        if (count > room) count = room;
+        cbReply_t state = {0};
+        cbServerState(srv, &state);
+        for (size_t k = 0; k < count; k++) {
+            cbRequest_t req;
+            cbReply_t reply = state;
+            memcpy(&req, c->in + k * sizeof(req), sizeof(req));
+            reply.op = req.op;
+            reply.tag = req.tag;
+            switch (req.op) {
+                case CB_OP_PING:
+                case CB_OP_READ:
+                    reply.status = CB_SUCCESS;
+                    break;
+                case CB_OP_MOVE:
+                    reply.status = cbServerMove(srv, &req);
+                    break;
+                case CB_OP_RESET:
+                    if (req.arg < 2) cbMotorReset(srv->motor[req.arg]);
+                    reply.status = req.arg < 2 ? CB_SUCCESS : CB_ERANGE;
+                    break;
+                case CB_OP_SUBSCRIBE:
+                    reply.status = cbServerSubscribe(srv, c, i, &req);
+                    break;
+                default:
+                    reply.status = CB_ENOMODE;
+            }
+            memcpy(c->out + c->out_len, &reply, sizeof(reply));
+            c->out_len += sizeof(reply);
+        }
+        srv->requests += count;
+        // Keep the requests not answered yet, and the partial one if any
+        c->in_len -= count * sizeof(cbRequest_t);
+        memmove(c->in, c->in + count * sizeof(cbRequest_t), c->in_len);
+        if (!cbServerFlush(srv, c, i)) return;
+    } while (count && !c->out_len && c->in_len >= sizeof(cbRequest_t));
+}
+
+/**
+ * @brief Reads the requests of a client, as many as fit in its buffer, and
+ *        answers them. Must not be called while replies are pending.
+ */
+static void cbServerServe(cbServer_t* srv, cbServerClient_t* c,
+                          unsigned int i) {
+    if (c->in_len < sizeof(c->in)) {
+        ssize_t n = read(c->fd, c->in + c->in_len, sizeof(c->in) - c->in_len);
+        if (n < 0 && (errno == EINTR || errno == EAGAIN)) return;
+        if (n <= 0) {
+            cbServerDrop(srv, c);
+            return;
+        }
+        c->in_len += (size_t)n;
+    }
+    cbServerAnswer(srv, c, i);
+}
+
+/**
+ * @brief Pushes an update to a subscriber, unless it has not read the
+ *        previous replies yet.
+ */
+static void cbServerUpdate(cbServer_t* srv, cbServerClient_t* c,
+                           unsigned int i) {
+    uint64_t expirations;
+    if (read(c->timer, &expirations, sizeof(expirations)) < 0) return;
+    if (c->out_len + sizeof(cbReply_t) > sizeof(c->out)) {
+        c->dropped += expirations;
+        return;
+    }
+    c->dropped += expirations - 1;
+    cbReply_t reply = {.op = CB_OP_UPDATE, .tag = c->sub_tag};
+    cbServerState(srv, &reply);
+    memcpy(c->out + c->out_len, &reply, sizeof(reply));
+    c->out_len += sizeof(reply);
+    srv->updates++;
+    cbServerFlush(srv, c, i);
+}
+
+/**
+ * @brief Waits for events and handles them: new clients, requests, pending
+ *        replies and subscription updates. Call it in a loop.
+ * @param srv A pointer to the server.
+ * @param timeout_ms The maximum time to wait, -1 to wait forever.
+ * @return The number of events handled, 0 on timeout or when interrupted by
+ *         a signal, -CB_FAILURE on error.
+ */
+int cbServerPoll(cbServer_t* srv, int timeout_ms) {
+    struct epoll_event events[2 * CB_SERVER_CLIENTS + 1];
+    int count = epoll_wait(srv->epoll, events,
+                           sizeof(events) / sizeof(events[0]), timeout_ms);
+    if (count < 0) return errno == EINTR ? 0 : -CB_FAILURE;
+    for (int e = 0; e < count; e++) {
+        uint64_t kind = events[e].data.u64 >> 32;
+        unsigned int i = (unsigned int)events[e].data.u64;
+        cbServerClient_t* c = &srv->client[i];
+        if (kind == CB_EV_LISTEN) {
+            cbServerAccept(srv);
+        } else if (c->fd < 0) {
+            continue;  // Dropped by an earlier event
+        } else if (kind == CB_EV_TIMER) {
+            if (c->timer >= 0) cbServerUpdate(srv, c, i);
+        } else if (events[e].events & EPOLLOUT || c->out_len) {
+            // Replies are pending, possibly queued by an update since the
+            // event came: no requests are read until they are out, then the
+            // ones left over are answered
+            if (cbServerFlush(srv, c, i) && !c->out_len) {
+                cbServerAnswer(srv, c, i);
+            }
+        } else if (events[e].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+            cbServerServe(srv, c, i);
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Disconnects all clients and removes the socket.
+ * @param srv A pointer to the server.
+ * @param path The path given to cbServerOpen().
+ */
+void cbServerClose(cbServer_t* srv, const char* path) {
+    for (unsigned int i = 0; i < CB_SERVER_CLIENTS; i++) {
+        if (srv->client[i].fd >= 0) cbServerDrop(srv, &srv->client[i]);
+    }
+    close(srv->fd);
+    close(srv->epoll);
+    unlink(path ? path : CB_SERVER_PATH);
+}
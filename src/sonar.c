@@ -0,0 +1,161 @@
+/**
+ * @file sonar.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "sonar.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include "cbdef.h"
+#include "hal.h"
+
+/**
+ * @brief Initializes the trigger line as a low output and the echo lines as
+ *        pulled down inputs, so a disconnected Sonar reads no echo.
+ * @param sonar A pointer to the Sonars.
+ */
+void cbSonarGPIOinit(const cbSonar_t* sonar) {
+    cbHal->set_mode(sonar->trigger, CB_GPIO_OUTPUT);
+    cbHal->write(sonar->trigger, 0);
+    for (unsigned int i = 0; i < sonar->count; i++) {
+        cbHal->set_mode(sonar->echo[i], CB_GPIO_INPUT);
+        cbHal->set_pull(sonar->echo[i], CB_GPIO_PUD_DOWN);
+    }
+}
+
+/**
+ * @brief Registers the ISRs of the echo lines and, if period_ms is not 0,
+ *        the timer firing the trigger. The ISRs get a watchdog just longer
+ *        than the timeout, so an echo line stuck high still ends its cycle.
+ *        The period must leave time for the longest echo to end.
+ * @param sonar A pointer to the Sonars.
+ * @return A condition code.
+ */
+int cbSonarStart(cbSonar_t* sonar) {
+    if (!sonar->count || sonar->count > CB_SONAR_MAX || !sonar->timeout_us ||
+        (sonar->period_ms &&
+         sonar->period_ms * 1000ULL <= sonar->timeout_us)) {
+        return CB_ERANGE;
+    }
+    atomic_store(&sonar->cycle, 0);
+    for (unsigned int i = 0; i < sonar->count; i++) {
+        sonar->rise_cycle[i] = 0;
+        atomic_store(&sonar->reading[i], 0);
+    }
+    int watchdog_ms = sonar->timeout_us / 1000 + 1;
+    for (unsigned int i = 0; i < sonar->count; i++) {
+        if (cbHal->set_isr(sonar->echo[i], CB_EDGE_EITHER, watchdog_ms,
+                           cbSonarISR, sonar) < 0) {
+            cbSonarStop(sonar);
+            return CB_FAILURE;
+        }
+    }
+    if (sonar->period_ms &&
+        cbHal->set_timer(CB_SONAR_TIMER, sonar->period_ms, cbSonarFire,
+                         sonar) < 0) {
+        cbSonarStop(sonar);
+        return CB_FAILURE;
+    }
+    return CB_SUCCESS;
+}
+
+/**
+ * @brief Cancels the timer and the ISRs. The latest ranges stay readable.
+ * @param sonar A pointer to the Sonars.
+ */
+void cbSonarStop(cbSonar_t* sonar) {
+    if (sonar->period_ms) {
+        cbHal->set_timer(CB_SONAR_TIMER, sonar->period_ms, NULL, NULL);
+    }
+    for (unsigned int i = 0; i < sonar->count; i++) {
+        cbHal->set_isr(sonar->echo[i], CB_EDGE_EITHER, 0, NULL, NULL);
+    }
+}
+
+/**
+ * @brief Starts a cycle by pulsing the shared trigger line. Called by the
+ *        timer, or by the application when period_ms is 0, e.g. to range
+ *        only when the motors are quiet.
+ * @param sonar_gen A pointer to the Sonars.
+ */
+void cbSonarFire(void* sonar_gen) {
+    cbSonar_t* sonar = (cbSonar_t*)sonar_gen;
+    atomic_fetch_add_explicit(&sonar->cycle, 1, memory_order_relaxed);
+    cbHal->trigger(sonar->trigger, CB_SONAR_PULSE_US, 1);
+}
+
+/**
+ * @brief The ISR of the echo lines. The rising edge is timestamped with the
+ *        cycle it belongs to, and the falling edge (or the watchdog, if the
+ *        echo outlasts the timeout) publishes the range of that cycle.
+ * @param gpio The echo line.
+ * @param level Its new level, or CB_LEVEL_TIMEOUT.
+ * @param tick The tick of the edge.
+ * @param sonar_gen A pointer to the Sonars.
+ */
+void cbSonarISR(int gpio, int level, uint32_t tick, void* sonar_gen) {
+    cbSonar_t* sonar = (cbSonar_t*)sonar_gen;
+    unsigned int i = 0;
+    while (i < sonar->count && (int)sonar->echo[i] != gpio) i++;
+    if (i == sonar->count) return;
+    if (level == 1) {
+        sonar->rise[i] = tick;
+        sonar->rise_cycle[i] =
+            atomic_load_explicit(&sonar->cycle, memory_order_relaxed);
+        return;
+    }
+    if (!sonar->rise_cycle[i]) return;  // No echo in progress
+    uint32_t width = tick - sonar->rise[i];  // Correct across wrap-arounds
+    if (level == CB_LEVEL_TIMEOUT && width <= sonar->timeout_us) return;
+    uint32_t range_um = CB_SONAR_NONE;
+    if (width <= sonar->timeout_us) {
+        range_um = (uint32_t)((uint64_t)width * CB_SONAR_SOUND_SPEED / 2);
+    }
+    atomic_store_explicit(&sonar->reading[i],
+                          (uint64_t)sonar->rise_cycle[i] << 32 | range_um,
+                          memory_order_release);
+    sonar->rise_cycle[i] = 0;
+}
+
+/**
+ * @brief Reads the latest range of a Sonar. A range is fresh if it was
+ *        measured in the current cycle or in the previous one, whose echoes
+ *        have surely ended. Never blocks.
+ * @param sonar A pointer to the Sonars.
+ * @param index The index of the Sonar.
+ * @param range_mm Where to store the range, only written on success.
+ * @return CB_SUCCESS, CB_ERANGE if nothing is in range, or CB_FAILURE if
+ *         there is no fresh range, e.g. because the Sonar is disconnected.
+ */
+int cbSonarRange(const cbSonar_t* sonar, unsigned int index,
+                 float* range_mm) {
+    if (index >= sonar->count) return CB_FAILURE;
+    uint64_t reading =
+        atomic_load_explicit(&sonar->reading[index], memory_order_acquire);
+    uint32_t cycle = (uint32_t)(reading >> 32);
+    uint32_t range_um = (uint32_t)reading;
+    if (!cycle || atomic_load(&sonar->cycle) - cycle > 1) return CB_FAILURE;
+    if (range_um == CB_SONAR_NONE) return CB_ERANGE;
+    *range_mm = range_um / 1000.f;
+    return CB_SUCCESS;
+}
@@ -0,0 +1,141 @@
+/**
+ * @file speed.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "speed.h"
+
+#include <string.h>
+
+#define US_PER_SEC 1000000.f
+
+/**
+ * @brief Initializes a speed estimator.
+ * @param est A pointer to the estimator.
+ * @param mm_per_tick The distance traveled by the wheel per tick in mm.
+ * @param window_us The minimum time span over which ticks are counted. Short
+ *                  windows react faster, longer ones average out the phase
+ *                  error between the two channels of the encoder.
+ * @param timeout_us The time without edges after which the wheel is
+ *                   considered stopped.
+ */
+void cbSpeedInit(cbSpeed_t* est, float mm_per_tick, uint64_t window_us,
+                 uint64_t timeout_us) {
+    memset(est, 0, sizeof(*est));
+    est->mm_per_tick = mm_per_tick;
+    est->window_us = window_us;
+    est->timeout_us = timeout_us;
+}
+
+/**
+ * @brief Enables the alpha-beta filter on top of the M/T estimate. The filter
+ *        tracks the position of the wheel, corrected at the timestamp of each
+ *        new edge.
+ * @param est A pointer to the estimator.
+ * @param alpha The position gain in the range (0,1], 0 disables the filter.
+ * @param beta The speed gain in the range (0,2).
+ */
+void cbSpeedSetFilter(cbSpeed_t* est, float alpha, float beta) {
+    est->alpha = alpha;
+    est->beta = beta;
+}
+
+/**
+ * @brief Runs the alpha-beta filter on a new position measurement. Edges with
+ *        the same timestamp as the previous measurement are skipped: the
+ *        measurement is absolute, so the next correction accounts for them.
+ * @param est A pointer to the estimator.
+ * @param pos_mm The position of the wheel at the time of the last edge.
+ * @param dt_us The time elapsed since the previous measurement.
+ */
+static inline void cbSpeedFilter(cbSpeed_t* est, float pos_mm,
+                                 uint64_t dt_us) {
+    if (dt_us == 0) return;
+    float dt = dt_us / US_PER_SEC;
+    est->pos_mm += est->speed_mm_s * dt;  // Predict
+    float residual = pos_mm - est->pos_mm;
+    est->pos_mm += est->alpha * residual;  // Correct
+    est->speed_mm_s += (est->beta / dt) * residual;
+}
+
+/**
+ * @brief Updates the estimate with the latest state of the encoder. The cost
+ *        is constant regardless of how many edges happened in between, so it
+ *        can be called at any rate.
+ * @param est A pointer to the estimator.
+ * @param snap A snapshot of the encoder, see cbEncoderSnapshot().
+ * @param now_us The current time in the same time base as the edges, i.e.
+ *               cbTimeNowUs().
+ * @return The estimated speed of the wheel in mm/s, negative if backwards.
+ */
+float cbSpeedUpdate(cbSpeed_t* est, const cbEncoderSnapshot_t* snap,
+                    uint64_t now_us) {
+    if (!est->primed || est->stopped) {
+        // Wait for a first edge to start measuring from
+        if (!est->primed || snap->ticks != est->last_ticks) {
+            est->ref_ticks = est->prev_ticks = est->last_ticks = snap->ticks;
+            est->ref_edge_us = est->prev_edge_us = est->last_edge_us =
+                snap->last_edge_us;
+            est->pos_mm = snap->ticks * est->mm_per_tick;
+            est->primed = true;
+            est->stopped = false;
+        }
+        return 0.f;
+    }
+    if (snap->ticks != est->last_ticks) {
+        // New edges: count ticks over the exact time between edges
+        uint64_t span_us = snap->last_edge_us - est->ref_edge_us;
+        if (span_us > 0) {
+            est->raw_mm_s = (snap->ticks - est->ref_ticks) * est->mm_per_tick *
+                            US_PER_SEC / span_us;
+        }
+        if (est->alpha > 0.f) {
+            cbSpeedFilter(est, snap->ticks * est->mm_per_tick,
+                          snap->last_edge_us - est->last_edge_us);
+        } else {
+            est->speed_mm_s = est->raw_mm_s;
+        }
+        est->prev_ticks = est->last_ticks;
+        est->prev_edge_us = est->last_edge_us;
+        est->last_ticks = snap->ticks;
+        est->last_edge_us = snap->last_edge_us;
+        if (span_us >= est->window_us) {
+            // Slide the window, keeping the edges of the last update in it
+            est->ref_ticks = est->prev_ticks;
+            est->ref_edge_us = est->prev_edge_us;
+        }
+        return est->speed_mm_s;
+    }
+    // No new edges: the speed is bounded by one tick since the last edge
+    if (now_us < est->last_edge_us) return est->speed_mm_s;
+    uint64_t idle_us = now_us - est->last_edge_us;
+    if (idle_us >= est->timeout_us) {
+        est->raw_mm_s = est->speed_mm_s = 0.f;
+        est->stopped = true;
+        return 0.f;
+    }
+    if (idle_us > 0) {
+        float bound = est->mm_per_tick * US_PER_SEC / idle_us;
+        if (est->speed_mm_s > bound) est->speed_mm_s = bound;
+        if (est->speed_mm_s < -bound) est->speed_mm_s = -bound;
+    }
+    return est->speed_mm_s;
+}
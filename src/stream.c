@@ -0,0 +1,110 @@
+/**
+ * @file stream.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L  // read()
+#include "stream.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cbdef.h"
+
+#define CB_REPORT_NO_LEVELS (CB_REPORT_WDOG | CB_REPORT_ALIVE | CB_REPORT_EVENT)
+
+/**
+ * @brief Synchronizes the Encoders of a group and opens a notification pipe
+ *        reporting the changes of their pins. The group must not be
+ *        registered with cbEncoderGroupRegister() as well.
+ * @param stream A pointer to the stream.
+ * @param group A pointer to the group, which must outlive the stream.
+ * @return A condition code.
+ * @link  https://abyz.me.uk/rpi/pigpio/cif.html#gpioNotifyOpen
+ */
+int cbEncoderStreamOpen(cbEncoderStream_t* stream, cbEncoderGroup_t* group) {
+    stream->group = group;
+    stream->seqno = 0;
+    stream->primed = false;
+    stream->reports = stream->lost = stream->gaps = stream->other = 0;
+    stream->pending = 0;
+    cbEncoderGroupSync(group);
+    stream->fd = cbHal->open_notify(group->bits);
+    return stream->fd < 0 ? CB_FAILURE : CB_SUCCESS;
+}
+
+/**
+ * @brief Reads the reports available in the pipe, waiting for at least one,
+ *        and decodes them. The sequence numbers are checked for reports lost
+ *        because the pipe was full; the Encoders then see the levels jump,
+ *        which is counted as an illegal transition if both Channels changed.
+ *        If stream->fd was made non-blocking (O_NONBLOCK), it returns right
+ *        away when the pipe is empty, e.g. to be called from a loop that has
+ *        other work to do.
+ * @param stream A pointer to the stream.
+ * @return The number of reports read, 0 if interrupted by a signal or if the
+ *         pipe was empty, or -CB_FAILURE if the pipe was closed or could not
+ *         be read.
+ */
+int cbEncoderStreamPump(cbEncoderStream_t* stream) {
+    char* buf = (char*)stream->buf;
+    ssize_t n = read(stream->fd, buf + stream->pending,
+                     sizeof(stream->buf) - stream->pending);
+    if (n < 0 && (errno == EINTR || errno == EAGAIN)) return 0;
+    if (n <= 0) return -CB_FAILURE;
+    size_t bytes = stream->pending + (size_t)n;
+    size_t count = bytes / sizeof(cbHalReport_t);
+    int samples = 0;
+    uint16_t seqno = stream->primed ? stream->seqno : stream->buf[0].seqno;
+    for (size_t i = 0; i < count; i++) {
+        const cbHalReport_t* report = &stream->buf[i];
+        uint16_t lost = (uint16_t)(report->seqno - seqno);
+        stream->lost += lost;
+        stream->gaps += lost != 0;
+        seqno = (uint16_t)(report->seqno + 1);
+        if (report->flags & CB_REPORT_NO_LEVELS) {
+            stream->other++;
+            continue;
+        }
+        stream->samples[samples++] =
+            (cbHalSample_t){report->tick, report->level};
+    }
+    stream->seqno = seqno;
+    stream->primed = stream->primed || count;
+    stream->reports += count;
+    cbEncoderSamples(stream->samples, samples, stream->group);
+    // Keep the partial report, if any, for the next read
+    stream->pending = bytes - count * sizeof(cbHalReport_t);
+    memmove(buf, buf + count * sizeof(cbHalReport_t), stream->pending);
+    return (int)count;
+}
+
+/**
+ * @brief Closes the notification pipe of a stream. A thread blocked in
+ *        cbEncoderStreamPump() then returns -CB_FAILURE.
+ * @param stream A pointer to the stream.
+ */
+void cbEncoderStreamClose(cbEncoderStream_t* stream) {
+    if (stream->fd < 0) return;
+    cbHal->close_notify(stream->fd);
+    stream->fd = -1;
+}
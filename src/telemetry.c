@@ -0,0 +1,184 @@
+/**
+ * @file telemetry.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L  // ftruncate(), mlock()
+#include "telemetry.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cbdef.h"
+#include "timebase.h"
+
+/**
+ * @brief Creates a telemetry file, or truncates an existing one, and maps it
+ *        in memory. The whole file is written and locked in memory (if the
+ *        limits allow it) here, so that cbTelemetryLog() never page-faults.
+ *        The records reach the file through the page cache, so they survive
+ *        the crash of the process. The HAL must be initialized.
+ * @param tel A pointer to the telemetry file.
+ * @param path The path of the file. Filesystems requiring stable pages may
+ *        block a writer on a page being written back, use a tmpfs (e.g.
+ *        /dev/shm) if that is a concern, and copy the file after the run.
+ * @param capacity The number of records kept, rounded up to a power of two,
+ *        0 for CB_TELEMETRY_CAPACITY.
+ * @return A condition code.
+ */
+int cbTelemetryOpen(cbTelemetry_t* tel, const char* path, uint64_t capacity) {
+    struct timespec ts;
+    if (capacity == 0) capacity = CB_TELEMETRY_CAPACITY;
+    if (capacity > ((SIZE_MAX >> 1) - sizeof(cbTelemetryHeader_t)) /
+                       sizeof(cbTelemetryRecord_t)) {
+        return CB_ERANGE;
+    }
+    uint64_t records = 1;
+    while (records < capacity) records <<= 1;
+    size_t size = sizeof(cbTelemetryHeader_t) +
+                  (size_t)records * sizeof(cbTelemetryRecord_t);
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return CB_FAILURE;
+    if (ftruncate(fd, (off_t)size) != 0) {
+        close(fd);
+        return CB_FAILURE;
+    }
+    void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);  // The mapping stays valid
+    if (map == MAP_FAILED) return CB_FAILURE;
+    memset(map, 0, size);  // Allocates the blocks and faults the pages in
+    mlock(map, size);  // Best effort
+    tel->header = map;
+    tel->ring = (cbTelemetryRecord_t*)(tel->header + 1);
+    tel->mask = records - 1;
+    tel->head = 0;
+    tel->size = size;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    memcpy(tel->header->magic, CB_TELEMETRY_MAGIC, sizeof(tel->header->magic));
+    tel->header->version = CB_TELEMETRY_VERSION;
+    tel->header->record_size = sizeof(cbTelemetryRecord_t);
+    tel->header->capacity = records;
+    tel->header->start_ns = (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    tel->header->start_us = cbTimeNowUs();
+    atomic_store_explicit(&tel->header->head, 0, memory_order_release);
+    return CB_SUCCESS;
+}
+
+/**
+ * @brief Maps an existing telemetry file read-only, e.g. to dump it after a
+ *        run or to follow it while it is written by another process.
+ * @param tel A pointer to the telemetry file.
+ * @param path The path of the file.
+ * @return CB_FAILURE if the file could not be mapped, or is not a telemetry
+ *         file of this version, CB_SUCCESS otherwise.
+ */
+int cbTelemetryAttach(cbTelemetry_t* tel, const char* path) {
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return CB_FAILURE;
+    if (fstat(fd, &st) != 0 ||
+        (uint64_t)st.st_size < sizeof(cbTelemetryHeader_t) ||
+        (uint64_t)st.st_size > SIZE_MAX) {
+        close(fd);
+        return CB_FAILURE;
+    }
+    size_t size = (size_t)st.st_size;
+    void* map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return CB_FAILURE;
+    cbTelemetryHeader_t* header = map;
+    uint64_t records = header->capacity;
+    if (memcmp(header->magic, CB_TELEMETRY_MAGIC, sizeof(header->magic)) ||
+        header->version != CB_TELEMETRY_VERSION ||
+        header->record_size != sizeof(cbTelemetryRecord_t) || records == 0 ||
+        (records & (records - 1)) ||
+        records > (size - sizeof(*header)) / sizeof(cbTelemetryRecord_t)) {
+        munmap(map, size);
+        return CB_FAILURE;
+    }
+    tel->header = header;
+    tel->ring = (cbTelemetryRecord_t*)(header + 1);
+    tel->mask = records - 1;
+    tel->head = 0;
+    tel->size = size;
+    return CB_SUCCESS;
+}
+
+/**
+ * @brief Unmaps a telemetry file. The records written so far stay in the
+ *        file.
+ * @param tel A pointer to the telemetry file.
+ */
+void cbTelemetryClose(cbTelemetry_t* tel) {
+    if (!tel->header) return;
+    munmap(tel->header, tel->size);
+    tel->header = NULL;
+    tel->ring = NULL;
+}
+
+/**
+ * @brief Returns the range of records still in the ring.
+ * @param tel A pointer to the telemetry file.
+ * @param head Where to store the index after the newest record.
+ * @return The index of the oldest record.
+ */
+uint64_t cbTelemetryFirst(const cbTelemetry_t* tel, uint64_t* head) {
+    *head = atomic_load_explicit(&tel->header->head, memory_order_acquire);
+    return *head > tel->mask ? *head - tel->mask - 1 : 0;
+}
+
+/**
+ * @brief Copies a record out of the ring.
+ * @param tel A pointer to the telemetry file.
+ * @param index The index of the record.
+ * @param rec Where to copy the record.
+ * @return false if the record has been overwritten, or if it was being
+ *         written (e.g. when the writer crashed).
+ */
+bool cbTelemetryRead(const cbTelemetry_t* tel, uint64_t index,
+                     cbTelemetryRecord_t* rec) {
+    cbTelemetryRecord_t* slot = &tel->ring[index & tel->mask];
+    unsigned int seq = (unsigned int)(index + 1);
+    if (atomic_load_explicit(&slot->seq, memory_order_acquire) != seq) {
+        return false;
+    }
+    rec->theta = slot->theta;
+    rec->time_us = slot->time_us;
+    rec->ticks_l = slot->ticks_l;
+    rec->ticks_r = slot->ticks_r;
+    rec->x_nm = slot->x_nm;
+    rec->y_nm = slot->y_nm;
+    rec->duty_l = slot->duty_l;
+    rec->duty_r = slot->duty_r;
+    rec->setpoint = slot->setpoint;
+    rec->error = slot->error;
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != seq) {
+        return false;
+    }
+    atomic_store_explicit(&rec->seq, seq, memory_order_relaxed);
+    return true;
+}
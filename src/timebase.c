@@ -0,0 +1,178 @@
+/**
+ * @file timebase.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Library for interfacing with the CoderBot mobile platform.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "timebase.h"
+
+#include <stdatomic.h>
+#include <time.h>
+
+#include "cbdef.h"
+#include "hal.h"
+
+/**
+ * The number of samples taken when calibrating the offset between the
+ * timebase and `CLOCK_MONOTONIC_RAW`. The tightest one is kept.
+ */
+#define CALIBRATION_SAMPLES 8
+
+/**
+ * Where the timeline starts, one wrap-around of the tick past zero: ticks
+ * placed behind the first one seen cannot underflow, and no timestamp is
+ * ever zero.
+ */
+#define EPOCH_US (1ULL << 32)
+
+/**
+ * The latest point of the 64-bit timeline, seeded by cbTimeInit().
+ */
+static _Atomic uint64_t cbTimeLatest = EPOCH_US;
+
+/**
+ * The offset in ns to add to the timebase to obtain `CLOCK_MONOTONIC_RAW`.
+ */
+static _Atomic int64_t cbTimeMonoRawOffset = 0;
+
+/**
+ * @brief Reads `CLOCK_MONOTONIC_RAW` in ns.
+ * @return The current value of the clock in ns.
+ */
+static inline uint64_t cbTimeMonoRawNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief Keeps the timebase alive and in sync with `CLOCK_MONOTONIC_RAW`.
+ * @param userdata Unused.
+ */
+static void cbTimeKeepalive(void* userdata) {
+    (void)userdata;
+    cbTimeCalibrate();
+}
+
+/**
+ * @brief Initializes the timebase. Must be called after initializing the
+ *        backend, e.g. with `gpioInitialise()`.
+ * @return A condition code.
+ */
+int cbTimeInit(void) {
+    // Unless a tick was already extended, start the timeline at this one
+    uint64_t latest = EPOCH_US;
+    atomic_compare_exchange_strong_explicit(&cbTimeLatest, &latest,
+                                            EPOCH_US + cbHal->tick(),
+                                            memory_order_relaxed,
+                                            memory_order_relaxed);
+    cbTimeCalibrate();
+    if (cbHal->set_timer(CB_TIME_TIMER, CB_TIME_KEEPALIVE_MS, cbTimeKeepalive,
+                         NULL) != 0) {
+        return CB_FAILURE;
+    }
+    return CB_SUCCESS;
+}
+
+/**
+ * @brief Cancels the keepalive timer of the timebase.
+ */
+void cbTimeTerminate(void) {
+    cbHal->set_timer(CB_TIME_TIMER, CB_TIME_KEEPALIVE_MS, NULL, NULL);
+}
+
+/**
+ * @brief Measures the offset between the timebase and `CLOCK_MONOTONIC_RAW`.
+ *        The two clocks are driven by different counters, so this should be
+ *        repeated from time to time to compensate drift: the keepalive timer
+ *        takes care of it.
+ */
+void cbTimeCalibrate(void) {
+    uint64_t best_span = UINT64_MAX;
+    int64_t offset = 0;
+    for (int i = 0; i < CALIBRATION_SAMPLES; i++) {
+        uint64_t before = cbTimeMonoRawNs();
+        uint64_t now_us = cbTimeNowUs();
+        uint64_t after = cbTimeMonoRawNs();
+        if (after - before < best_span) {
+            best_span = after - before;
+            offset = (int64_t)(before + (after - before) / 2) -
+                     (int64_t)(now_us * 1000);
+        }
+    }
+    atomic_store_explicit(&cbTimeMonoRawOffset, offset, memory_order_relaxed);
+}
+
+/**
+ * @brief Extends a 32-bit PiGPIO tick to the 64-bit timeline. The timeline is
+ *        shared by every caller and only moves forward: ticks older than the
+ *        latest one are placed behind it rather than past the next
+ *        wrap-around. The timeline starts 2^32us past zero, so timestamps
+ *        are never zero. Lock-free, safe to call from any ISR.
+ * @param tick_us A timestamp in microseconds as reported by PiGPIO. It must
+ *                not be older than ~35 minutes with respect to the latest
+ *                tick seen.
+ * @return The timestamp in microseconds on the 64-bit timeline.
+ */
+uint64_t cbTimeExtend(uint32_t tick_us) {
+    uint64_t latest =
+        atomic_load_explicit(&cbTimeLatest, memory_order_relaxed);
+    for (;;) {
+        int32_t delta = (int32_t)(tick_us - (uint32_t)latest);
+        uint64_t time_us = latest + (int64_t)delta;
+        if (delta <= 0) return time_us;
+        if (atomic_compare_exchange_weak_explicit(&cbTimeLatest, &latest,
+                                                  time_us,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+            return time_us;
+        }
+    }
+}
+
+/**
+ * @brief Returns the current time on the 64-bit timeline.
+ * @return The current time in microseconds.
+ */
+uint64_t cbTimeNowUs(void) { return cbTimeExtend(cbHal->tick()); }
+
+/**
+ * @brief Converts a timestamp on the timeline to `CLOCK_MONOTONIC_RAW`, the
+ *        clock used by `tsSet()` in `examples/timespec.h`. No syscall is made.
+ * @param time_us A timestamp in microseconds on the timeline.
+ * @return The same instant in ns of `CLOCK_MONOTONIC_RAW`.
+ */
+uint64_t cbTimeToMonoRawNs(uint64_t time_us) {
+    return time_us * 1000 +
+           atomic_load_explicit(&cbTimeMonoRawOffset, memory_order_relaxed);
+}
+
+/**
+ * @brief Converts a `CLOCK_MONOTONIC_RAW` time to the timeline.
+ * @param mono_raw_ns A time in ns of `CLOCK_MONOTONIC_RAW`.
+ * @return The same instant in microseconds on the timeline.
+ */
+uint64_t cbTimeFromMonoRawNs(uint64_t mono_raw_ns) {
+    return (mono_raw_ns -
+            atomic_load_explicit(&cbTimeMonoRawOffset, memory_order_relaxed)) /
+           1000;
+}
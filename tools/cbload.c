@@ -0,0 +1,178 @@
+/**
+ * @file cbload.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Load generator for cbserverd: measures the round-trip latency and
+ *        the throughput of pipelined requests.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Usage: cbload [-p SOCKET] [-n REQUESTS] [-d DEPTH] [-o ping|read|move]
+ *               [-r PERIOD_US]
+ *
+ * Keeps DEPTH requests in flight: they are sent with a single write, and a
+ * new one is sent for every reply read. With -r the client also subscribes
+ * to updates every PERIOD_US. The results are printed as CSV, like the
+ * benchmarks in bench/:
+ *
+ *     bench,case,param,value,unit
+ */
+
+#define _POSIX_C_SOURCE 200809L  // getopt()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../include/cbdef.h"
+#include "../include/hist.h"
+#include "../include/server.h"
+#include "../examples/timespec.h"
+
+#define MAX_DEPTH 4096
+#define TAGS (UINT16_MAX + 1)
+
+static nsec_t sent[TAGS]; //< When each tag was sent
+static cbRequest_t batch[MAX_DEPTH];
+static cbReply_t replies[MAX_DEPTH];
+static cbHist_t rtt;
+
+static nsec_t now(void) {
+    timespec_t ts;
+    tsSet(&ts);
+    return tsToNs(&ts);
+}
+
+/**
+ * @brief Sends the next requests, all with a single write.
+ */
+static void sendBatch(int fd, uint16_t op, uint64_t* next, unsigned int n) {
+    nsec_t t = now();
+    for (unsigned int k = 0; k < n; k++, (*next)++) {
+        uint16_t tag = (uint16_t)*next;
+        batch[k] = (cbRequest_t){.op = op,
+                                 .tag = tag,
+                                 .arg = tag & 1,
+                                 .value = (tag & 2) ? .75f : .25f,
+                                 .dir = forward};
+        sent[tag] = t;
+    }
+    size_t len = n * sizeof(cbRequest_t);
+    for (size_t done = 0; done < len;) {
+        ssize_t w = write(fd, (char*)batch + done, len - done);
+        if (w <= 0) {
+            perror("write");
+            exit(EXIT_FAILURE);
+        }
+        done += (size_t)w;
+    }
+}
+
+static void row(const char* name, const char* param, double value,
+                const char* unit) {
+    printf("load,%s,%s,%.3f,%s\n", name, param, value, unit);
+}
+
+int main(int argc, char* argv[]) {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    const char* path = CB_SERVER_PATH;
+    const char* opname = "ping";
+    uint64_t count = 100000, next = 0, done = 0, updates = 0, errors = 0;
+    unsigned int depth = 1, period_us = 0;
+    uint16_t op = CB_OP_PING;
+    int opt;
+    while ((opt = getopt(argc, argv, "p:n:d:o:r:")) != -1) {
+        switch (opt) {
+            case 'p': path = optarg; break;
+            case 'n': count = strtoull(optarg, NULL, 0); break;
+            case 'd': depth = (unsigned int)strtoul(optarg, NULL, 0); break;
+            case 'r': period_us = (unsigned int)strtoul(optarg, NULL, 0); break;
+            case 'o': opname = optarg; break;
+            default: exit(EXIT_FAILURE);
+        }
+    }
+    if (strcmp(opname, "read") == 0) op = CB_OP_READ;
+    else if (strcmp(opname, "move") == 0) op = CB_OP_MOVE;
+    else if (strcmp(opname, "ping") != 0) exit(EXIT_FAILURE);
+    if (depth == 0 || depth > MAX_DEPTH ||
+        strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Invalid arguments.\n");
+        exit(EXIT_FAILURE);
+    }
+    strcpy(addr.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    cbHistInit(&rtt);
+    if (period_us) {
+        cbRequest_t sub = {.op = CB_OP_SUBSCRIBE, .tag = 0, .arg = period_us};
+        if (write(fd, &sub, sizeof(sub)) != sizeof(sub)) exit(EXIT_FAILURE);
+        // Its reply is counted with the others
+        sent[0] = now();
+        next = 1;
+        count++;
+    }
+    timespec_t clock;
+    tsSet(&clock);
+    sendBatch(fd, op, &next, depth < count - next ? depth : count - next);
+    size_t pending = 0;  // Bytes of a partial reply
+    while (done < count) {
+        ssize_t r = read(fd, (char*)replies + pending,
+                         sizeof(replies) - pending);
+        if (r <= 0) {
+            perror("read");
+            exit(EXIT_FAILURE);
+        }
+        nsec_t t = now();
+        size_t bytes = pending + (size_t)r, n = bytes / sizeof(cbReply_t);
+        unsigned int answered = 0;
+        for (size_t k = 0; k < n; k++) {
+            if (replies[k].op == CB_OP_UPDATE) {
+                updates++;
+                continue;
+            }
+            cbHistRecord(&rtt, t - sent[replies[k].tag]);
+            errors += replies[k].status != CB_SUCCESS;
+            answered++;
+        }
+        done += answered;
+        pending = bytes - n * sizeof(cbReply_t);
+        memmove(replies, (char*)replies + n * sizeof(cbReply_t), pending);
+        if (next < count) {
+            uint64_t left = count - next;
+            sendBatch(fd, op, &next, answered < left ? answered : left);
+        }
+    }
+    nsec_t elapsed = tsTickNs(&clock);
+    close(fd);
+    cbHistSummary_t sum;
+    cbHistSummarize(&rtt, &sum);
+    char param[32];
+    snprintf(param, sizeof(param), "depth_%u", depth);
+    row(opname, param, done * 1e9 / elapsed, "req/s");
+    row(opname, "rtt_p50", sum.p50 / 1e3, "us");
+    row(opname, "rtt_p99", sum.p99 / 1e3, "us");
+    row(opname, "rtt_max", sum.max / 1e3, "us");
+    row(opname, "errors", errors, "req");
+    if (period_us) row("subscribe", "updates", updates * 1e9 / elapsed, "Hz");
+    exit(EXIT_SUCCESS);
+}
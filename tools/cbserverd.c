@@ -0,0 +1,133 @@
+/**
+ * @file cbserverd.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Serves the motors and encoders of the robot over a Unix socket.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Usage: cbserverd [-s] [SOCKET]
+ *
+ * The protocol is described in include/server.h. With -s the robot is
+ * simulated, so the server and its clients can run on any Linux machine;
+ * the simulation is advanced in real time. Stop with Ctrl-C.
+ */
+
+#define _POSIX_C_SOURCE 200809L  // sigaction()
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/cbdef.h"
+#include "../include/encoder.h"
+#include "../include/hal.h"
+#include "../include/motor.h"
+#include "../include/server.h"
+#include "../include/sim.h"
+#include "../include/timebase.h"
+#include "../examples/timespec.h"
+
+#define SIM_POLL_MS 1 //< Period of the simulation steps
+
+cbMotor_t cbMotorLeft = {.pin_fw = PIN_LEFT_FORWARD,
+                         .pin_bw = PIN_LEFT_BACKWARD,
+                         .direction = forward};
+cbMotor_t cbMotorRight = {.pin_fw = PIN_RIGHT_FORWARD,
+                          .pin_bw = PIN_RIGHT_BACKWARD,
+                          .direction = forward};
+cbEncoder_t cbEncoderLeft =
+    CB_ENCODER_INIT(PIN_ENCODER_LEFT_A, PIN_ENCODER_LEFT_B);
+cbEncoder_t cbEncoderRight =
+    CB_ENCODER_INIT(PIN_ENCODER_RIGHT_A, PIN_ENCODER_RIGHT_B);
+cbSimWheel_t cbSimLeft, cbSimRight;
+cbServer_t cbServer;
+
+static volatile sig_atomic_t running = 1;
+
+static void stop(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+void init(bool sim) {
+    if (sim) cbHalSelect(&cbHalSim);
+    if (cbHal->init() != 0) exit(EXIT_FAILURE);
+    if (sim) {
+        cbSimWheelInit(&cbSimLeft, PIN_LEFT_FORWARD, PIN_LEFT_BACKWARD,
+                       PIN_ENCODER_LEFT_A, PIN_ENCODER_LEFT_B);
+        cbSimWheelInit(&cbSimRight, PIN_RIGHT_FORWARD, PIN_RIGHT_BACKWARD,
+                       PIN_ENCODER_RIGHT_A, PIN_ENCODER_RIGHT_B);
+        cbSimAttachWheel(&cbSimLeft);
+        cbSimAttachWheel(&cbSimRight);
+    }
+    cbTimeInit();
+    cbMotorGPIOinit(&cbMotorLeft);
+    cbEncoderGPIOinit(&cbEncoderLeft);
+    cbEncoderSync(&cbEncoderLeft);
+    cbEncoderRegisterISRs(&cbEncoderLeft, 50);
+    cbMotorGPIOinit(&cbMotorRight);
+    cbEncoderGPIOinit(&cbEncoderRight);
+    cbEncoderSync(&cbEncoderRight);
+    cbEncoderRegisterISRs(&cbEncoderRight, 50);
+}
+
+void terminate() {
+    cbMotorReset(&cbMotorLeft);
+    cbMotorReset(&cbMotorRight);
+    cbEncoderCancelISRs(&cbEncoderLeft);
+    cbEncoderCancelISRs(&cbEncoderRight);
+    cbTimeTerminate();
+    cbHal->terminate();
+}
+
+int main(int argc, char* argv[]) {
+    cbMotor_t* motors[] = {&cbMotorLeft, &cbMotorRight};
+    cbEncoder_t* encoders[] = {&cbEncoderLeft, &cbEncoderRight};
+    struct sigaction sa = {.sa_handler = stop};  // No SA_RESTART
+    bool sim = argc > 1 && strcmp(argv[1], "-s") == 0;
+    const char* path = argc > 1 + sim ? argv[1 + sim] : CB_SERVER_PATH;
+    timespec_t clock;
+    nsec_t elapsed_ns = 0;
+    init(sim);
+    int rc = cbServerOpen(&cbServer, path, motors, encoders);
+    if (rc != CB_SUCCESS) {
+        fprintf(stderr, "%s: Could not listen (%d).\n", path, rc);
+        terminate();
+        exit(EXIT_FAILURE);
+    }
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    printf("Listening on %s (%s).\n", path, cbHal->name);
+    fflush(stdout);
+    tsSet(&clock);
+    while (running) {
+        if (cbServerPoll(&cbServer, sim ? SIM_POLL_MS : -1) < 0) break;
+        if (!sim) continue;
+        elapsed_ns += tsTickNs(&clock);
+        cbSimStep(elapsed_ns / NSEC_PER_USEC);
+        elapsed_ns %= NSEC_PER_USEC;
+    }
+    printf("%llu requests, %llu updates.\n",
+           (unsigned long long)cbServer.requests,
+           (unsigned long long)cbServer.updates);
+    cbServerClose(&cbServer, path);
+    terminate();
+    exit(EXIT_SUCCESS);
+}
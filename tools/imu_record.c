@@ -0,0 +1,98 @@
+/**
+ * @file imu_record.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Records the FIFO slots of the LSM9DS1, for replaying on the simulator.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * The slots are written raw, CB_IMU_SLOT_SIZE bytes each as read from the
+ * FIFO, which is the format cbSimImuInit() replays, see examples/sim_imu.c.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../include/cbdef.h"
+#include "../include/hal.h"
+#include "../include/imu.h"
+#include "../include/periodic.h"
+#include "../include/timebase.h"
+
+#define POLL_PERIOD_NS 20000000ULL // 50Hz, like the control loop
+
+cbImu_t cbImu = CB_IMU_INIT;
+
+/**
+ * @brief Writes a sample back as the FIFO slot it was read from.
+ * @param sample A pointer to the sample.
+ * @param file The recording.
+ * @return true if the slot was written.
+ */
+bool writeSlot(const cbImuSample_t* sample, FILE* file) {
+    uint8_t slot[CB_IMU_SLOT_SIZE];
+    for (int axis = 0; axis < 3; axis++) {
+        slot[2 * axis] = (uint8_t)(sample->gyro[axis] & 0xFF);
+        slot[2 * axis + 1] = (uint8_t)((sample->gyro[axis] >> 8) & 0xFF);
+        slot[6 + 2 * axis] = (uint8_t)(sample->accel[axis] & 0xFF);
+        slot[7 + 2 * axis] = (uint8_t)((sample->accel[axis] >> 8) & 0xFF);
+    }
+    return fwrite(slot, sizeof(slot), 1, file) == 1;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s FILE [SECONDS]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    unsigned long seconds = argc > 2 ? strtoul(argv[2], NULL, 10) : 10;
+    FILE* file = fopen(argv[1], "wb");
+    if (!file) {
+        perror(argv[1]);
+        exit(EXIT_FAILURE);
+    }
+    if (cbHal->init() != 0) exit(EXIT_FAILURE);
+    cbTimeInit();
+    if (cbImuOpen(&cbImu) != CB_SUCCESS) {
+        fprintf(stderr, "No LSM9DS1 found on I2C bus %u.\n", cbImu.bus);
+        exit(EXIT_FAILURE);
+    }
+    cbPeriodic_t timer;
+    cbPeriodicInit(&timer, POLL_PERIOD_NS, 0);
+    unsigned long slots = 0;
+    for (unsigned long i = 0; i < seconds * 1000000000ULL / POLL_PERIOD_NS;
+         i++) {
+        cbPeriodicWait(&timer);
+        if (cbImuPoll(&cbImu) < 0) break;
+        const cbImuSample_t* batch;
+        size_t count;
+        while ((count = cbImuDrain(&cbImu, &batch)) > 0) {
+            for (size_t k = 0; k < count; k++) {
+                slots += writeSlot(&batch[k], file);
+            }
+            cbImuRelease(&cbImu, count);
+        }
+    }
+    fprintf(stderr, "%s: %lu slots, %u overruns.\n", argv[1], slots,
+            cbImu.overruns);
+    cbImuClose(&cbImu);
+    cbTimeTerminate();
+    cbHal->terminate();
+    fclose(file);
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,71 @@
+/**
+ * @file telemetry_dump.c
+ * @author Jacopo Maltagliati
+ * @date 16 Oct 2026
+ * @brief Decodes a telemetry file written with cbTelemetryLog() into CSV.
+ * @copyright Copyright (c) 2022-26, Jacopo Maltagliati.
+ *
+ * This file is part of libcoderbot.
+ *
+ * libcoderbot is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * libcoderbot is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * libcoderbot. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../include/cbdef.h"
+#include "../include/odometry.h"
+#include "../include/telemetry.h"
+
+int main(int argc, char* argv[]) {
+    cbTelemetry_t tel;
+    cbTelemetryRecord_t rec;
+    uint64_t first, head, skipped = 0;
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s FILE > FILE.csv\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (cbTelemetryAttach(&tel, argv[1]) != CB_SUCCESS) {
+        fprintf(stderr, "%s: Not a telemetry file.\n", argv[1]);
+        exit(EXIT_FAILURE);
+    }
+    time_t start = (time_t)(tel.header->start_ns / 1000000000);
+    char date[32];
+    strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", localtime(&start));
+    first = cbTelemetryFirst(&tel, &head);
+    fprintf(stderr, "%s: Started %s, %llu records (%llu overwritten).\n",
+            argv[1], date, (unsigned long long)(head - first),
+            (unsigned long long)first);
+    puts("index,time_us,ticks_l,ticks_r,duty_l,duty_r,setpoint,error,"
+         "x_mm,y_mm,theta_rad");
+    for (uint64_t i = first; i < head; i++) {
+        if (!cbTelemetryRead(&tel, i, &rec)) {
+            skipped++;
+            continue;
+        }
+        printf("%llu,%llu,%lld,%lld,%.4f,%.4f,%.3f,%.3f,%.3f,%.3f,%.5f\n",
+               (unsigned long long)i,
+               (unsigned long long)(rec.time_us - tel.header->start_us),
+               (long long)rec.ticks_l, (long long)rec.ticks_r, rec.duty_l,
+               rec.duty_r, rec.setpoint, rec.error, rec.x_nm / 1e6,
+               rec.y_nm / 1e6, cbOdoBamToRad(rec.theta));
+    }
+    if (skipped) {
+        fprintf(stderr, "%s: %llu incomplete records skipped.\n", argv[1],
+                (unsigned long long)skipped);
+    }
+    cbTelemetryClose(&tel);
+    exit(EXIT_SUCCESS);
+}